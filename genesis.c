@@ -1,389 +1,3226 @@
 #include "genesis.h"
 #include "genesis_opengl.h"
 #include "genesis_noop.h"
+#include "genesis_capture.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
 
 #ifdef __EMSCRIPTEN__
     #include <emscripten.h>
+#else
+    #define GS_RENDER_THREAD_SUPPORTED
+    #if defined(_WIN32)
+        #define WIN32_LEAN_AND_MEAN
+        #include <windows.h>
+    #else
+        #include <pthread.h>
+    #endif
+#endif
+
+typedef struct GsResourceEntry {
+    void *resource;
+    GsResourceType type;
+} GsResourceEntry;
+
+typedef enum GsBindingSlot {
+    GS_BINDING_PIPELINE,
+    GS_BINDING_VERTEX_BUFFER,
+    GS_BINDING_INDEX_BUFFER,
+    GS_BINDING_INSTANCE_BUFFER,
+    GS_BINDING_VERTEX_STREAM, // first of GS_MAX_VERTEX_STREAMS, stream 0 is GS_BINDING_VERTEX_BUFFER and stays unused
+    GS_BINDING_TEXTURE = GS_BINDING_VERTEX_STREAM + GS_MAX_VERTEX_STREAMS, // first of GS_MAX_TEXTURE_SLOTS
+    GS_BINDING_COUNT = GS_BINDING_TEXTURE + GS_MAX_TEXTURE_SLOTS
+} GsBindingSlot;
+
+typedef struct GsBindingState {
+    GsResourceId slots[GS_BINDING_COUNT]; // GS_INVALID_RESOURCE_ID where unknown
+} GsBindingState;
+
+// Follows the binds a command stream requests, including the save/restore done around render passes.
+typedef struct GsBindingTracker {
+    GsBindingState current;
+    GsBindingState stack[16];
+    int depth;
+} GsBindingTracker;
+
+typedef struct GsSortPacket {
+    uint64_t key;
+    GsBindingState bindings; // state the draw was recorded with
+    const GsCommandHeader *draw;
+    int uniform_first; // uniform commands recorded since the previous draw
+    int uniform_count;
+} GsSortPacket;
+
+typedef struct GsSortEntry {
+    uint64_t key;
+    int packet;
+} GsSortEntry;
+
+struct GsCommandSorter {
+    // recording state
+    int layer;
+    float depth;
+    GsResourceId pipeline;
+    GsResourceId program;
+    GsResourceId texture;
+    GS_BOOL translucent;
+    uint64_t *keys; // one per recorded draw
+    int key_count;
+    int key_capacity;
+
+    // scratch for gs_command_list_end, kept between frames
+    GsSortPacket *packets;
+    int packet_count;
+    int packet_capacity;
+    GsSortEntry *entries;
+    GsSortEntry *entries_temp;
+    int entry_capacity;
+    int entry_temp_capacity;
+    const GsCommandHeader **uniforms;
+    int uniform_count;
+    int uniform_capacity;
+};
+
+static GsConfig *active_config = NULL;
+static GS_BOOL mainloop_active = GS_FALSE;
+
+// lock-free submission queue, any thread may push, gs_frame drains it
+static _Atomic(GsCommandList *) submission_head = NULL;
+static atomic_uint submission_sequence = 0;
+
+// resource registry, commands reference resources by index into this table. Entries live in fixed pages that never
+// move, so the render thread can look ids up while the API thread registers new ones. Writers hold resource_lock.
+#define GS_RESOURCE_PAGE_SIZE 1024
+#define GS_RESOURCE_MAX_PAGES 1024
+static GsResourceEntry *resource_pages[GS_RESOURCE_MAX_PAGES];
+static atomic_int resource_count = 1; // slot 0 is GS_INVALID_RESOURCE_ID
+static GsResourceId *resource_free_ids = NULL;
+static int resource_free_count = 0;
+static int resource_free_capacity = 0;
+static atomic_flag resource_lock = ATOMIC_FLAG_INIT;
+
+#define GS_RESOURCE_ENTRY(id) (&resource_pages[(id) / GS_RESOURCE_PAGE_SIZE][(id) % GS_RESOURCE_PAGE_SIZE])
+
+static void gs_resource_lock() {
+    while (atomic_flag_test_and_set_explicit(&resource_lock, memory_order_acquire)) {
+        // registry updates are a handful of stores, spinning beats a kernel lock here
+    }
+}
+
+static void gs_resource_unlock() {
+    atomic_flag_clear_explicit(&resource_lock, memory_order_release);
+}
+
+GsResourceId gs_register_resource(void *resource, const GsResourceType type) {
+    GS_ASSERT(resource != NULL);
+    GS_ASSERT(type != GS_RESOURCE_TYPE_NONE);
+
+    gs_resource_lock();
+
+    GsResourceId id;
+    if (resource_free_count > 0) {
+        resource_free_count -= 1;
+        id = resource_free_ids[resource_free_count];
+    } else {
+        const int count = atomic_load_explicit(&resource_count, memory_order_relaxed);
+        const int page = count / GS_RESOURCE_PAGE_SIZE;
+        GS_ASSERT(page < GS_RESOURCE_MAX_PAGES);
+
+        if (resource_pages[page] == NULL) {
+            resource_pages[page] = GS_ALLOC_MULTIPLE(GsResourceEntry, GS_RESOURCE_PAGE_SIZE);
+            GS_ASSERT(resource_pages[page] != NULL);
+        }
+
+        id = (GsResourceId) count;
+        atomic_store_explicit(&resource_count, count + 1, memory_order_release);
+    }
+
+    GS_RESOURCE_ENTRY(id)->resource = resource;
+    GS_RESOURCE_ENTRY(id)->type = type;
+
+    gs_resource_unlock();
+    return id;
+}
+
+void gs_unregister_resource(const GsResourceId id) {
+    GS_ASSERT(id != GS_INVALID_RESOURCE_ID);
+    GS_ASSERT((int) id < atomic_load_explicit(&resource_count, memory_order_acquire));
+    GS_ASSERT(GS_RESOURCE_ENTRY(id)->type != GS_RESOURCE_TYPE_NONE);
+
+    gs_resource_lock();
+
+    GS_RESOURCE_ENTRY(id)->resource = NULL;
+    GS_RESOURCE_ENTRY(id)->type = GS_RESOURCE_TYPE_NONE;
+
+    if (resource_free_count == resource_free_capacity) {
+        const int capacity = resource_free_capacity > 0 ? resource_free_capacity * 2 : 256;
+
+        GsResourceId *free_ids = (GsResourceId*)GS_REALLOC(resource_free_ids, sizeof(GsResourceId) * capacity);
+        GS_ASSERT(free_ids != NULL);
+
+        resource_free_ids = free_ids;
+        resource_free_capacity = capacity;
+    }
+
+    resource_free_ids[resource_free_count] = id;
+    resource_free_count += 1;
+
+    gs_resource_unlock();
+}
+
+void *gs_get_resource(const GsResourceId id, const GsResourceType type) {
+    GS_ASSERT(id != GS_INVALID_RESOURCE_ID);
+    GS_ASSERT((int) id < atomic_load_explicit(&resource_count, memory_order_acquire));
+    GS_ASSERT(GS_RESOURCE_ENTRY(id)->type == type);
+
+    return GS_RESOURCE_ENTRY(id)->resource;
+}
+
+GsResourceType gs_get_resource_type(const GsResourceId id) {
+    if (id == GS_INVALID_RESOURCE_ID || (int) id >= atomic_load_explicit(&resource_count, memory_order_acquire)) {
+        return GS_RESOURCE_TYPE_NONE;
+    }
+
+    return GS_RESOURCE_ENTRY(id)->type;
+}
+
+// Render thread. Every backend call is wrapped in a GsRenderOp. Without a render thread ops run at once on the calling
+// thread, with one they are copied into a single-producer/single-consumer ring that the render thread drains in order,
+// so the API thread only waits for ops that return a value, for a full ring or for frames still in flight.
+#define GS_RENDER_RING_SIZE 4096 // ops, power of two
+#define GS_RENDER_MAX_FRAMES_IN_FLIGHT 2
+
+typedef struct GsRenderOp GsRenderOp;
+typedef void (*GsRenderOpFunc)(GsRenderOp *op);
+
+// Arguments of one backend call, every op uses the fields it needs.
+struct GsRenderOp {
+    GsRenderOpFunc func;
+    void *resource;
+    void *target;
+    void *data;
+    void *result;
+    GsResourceId id;
+    int size;
+    int offset;
+    int value;
+    GS_BOOL owned; // data was copied for the op and is freed after it ran
+};
+
+static GS_BOOL render_threaded = GS_FALSE;
+static uint64_t render_frame_fences[GS_RENDER_MAX_FRAMES_IN_FLIGHT];
+static int render_frame_index = 0;
+
+#if defined(GS_RENDER_THREAD_SUPPORTED)
+    static GsRenderOp *render_ring = NULL;
+    static atomic_uint_fast64_t render_head = 0; // ops published, written by the API thread
+    static atomic_uint_fast64_t render_tail = 0; // ops completed, written by the render thread
+    static atomic_bool render_running = GS_FALSE;
+
+    // Either side raises its flag before checking its condition and the other side checks the flag after publishing,
+    // so no wakeup is lost and the mutex is only touched when somebody actually sleeps.
+    static atomic_bool render_consumer_waiting = GS_FALSE;
+    static atomic_bool render_producer_waiting = GS_FALSE;
+
+    #if defined(_WIN32)
+        static HANDLE render_thread;
+        static CRITICAL_SECTION render_mutex;
+        static CONDITION_VARIABLE render_work; // ops were published
+        static CONDITION_VARIABLE render_done; // ops completed
+
+        #define GS_RENDER_LOCK() EnterCriticalSection(&render_mutex)
+        #define GS_RENDER_UNLOCK() LeaveCriticalSection(&render_mutex)
+        #define GS_RENDER_WAIT(cond) SleepConditionVariableCS(&(cond), &render_mutex, INFINITE)
+        #define GS_RENDER_WAKE(cond) WakeAllConditionVariable(&(cond))
+    #else
+        static pthread_t render_thread;
+        static pthread_mutex_t render_mutex = PTHREAD_MUTEX_INITIALIZER;
+        static pthread_cond_t render_work = PTHREAD_COND_INITIALIZER; // ops were published
+        static pthread_cond_t render_done = PTHREAD_COND_INITIALIZER; // ops completed
+
+        #define GS_RENDER_LOCK() pthread_mutex_lock(&render_mutex)
+        #define GS_RENDER_UNLOCK() pthread_mutex_unlock(&render_mutex)
+        #define GS_RENDER_WAIT(cond) pthread_cond_wait(&(cond), &render_mutex)
+        #define GS_RENDER_WAKE(cond) pthread_cond_broadcast(&(cond))
+    #endif
+
+    static void gs_render_thread_run() {
+        uint64_t tail = atomic_load(&render_tail);
+
+        while (atomic_load(&render_running)) {
+            if (atomic_load(&render_head) == tail) {
+                GS_RENDER_LOCK();
+                atomic_store(&render_consumer_waiting, GS_TRUE);
+                while (atomic_load(&render_head) == tail) {
+                    GS_RENDER_WAIT(render_work);
+                }
+                atomic_store(&render_consumer_waiting, GS_FALSE);
+                GS_RENDER_UNLOCK();
+            }
+
+            GsRenderOp *op = &render_ring[tail & (GS_RENDER_RING_SIZE - 1)];
+            op->func(op);
+
+            if (op->owned) {
+                GS_FREE(op->data);
+            }
+
+            tail += 1;
+            atomic_store(&render_tail, tail);
+
+            if (atomic_load(&render_producer_waiting)) {
+                GS_RENDER_LOCK();
+                GS_RENDER_WAKE(render_done);
+                GS_RENDER_UNLOCK();
+            }
+        }
+    }
+
+    #if defined(_WIN32)
+        static DWORD WINAPI gs_render_thread_main(LPVOID param) {
+            (void) param;
+            gs_render_thread_run();
+            return 0;
+        }
+    #else
+        static void *gs_render_thread_main(void *param) {
+            (void) param;
+            gs_render_thread_run();
+            return NULL;
+        }
+    #endif
+
+    static void gs_render_thread_start() {
+        render_ring = GS_ALLOC_MULTIPLE(GsRenderOp, GS_RENDER_RING_SIZE);
+        GS_ASSERT(render_ring != NULL);
+
+        atomic_store(&render_head, 0);
+        atomic_store(&render_tail, 0);
+        atomic_store(&render_running, GS_TRUE);
+        render_threaded = GS_TRUE;
+
+        #if defined(_WIN32)
+            InitializeCriticalSection(&render_mutex);
+            InitializeConditionVariable(&render_work);
+            InitializeConditionVariable(&render_done);
+
+            render_thread = CreateThread(NULL, 0, gs_render_thread_main, NULL, 0, NULL);
+            GS_ASSERT(render_thread != NULL);
+        #else
+            const int result = pthread_create(&render_thread, NULL, gs_render_thread_main, NULL);
+            GS_ASSERT(result == 0);
+            (void) result;
+        #endif
+    }
+
+    // The thread leaves its loop after the op that cleared render_running.
+    static void gs_render_thread_join() {
+        #if defined(_WIN32)
+            WaitForSingleObject(render_thread, INFINITE);
+            CloseHandle(render_thread);
+            DeleteCriticalSection(&render_mutex);
+        #else
+            pthread_join(render_thread, NULL);
+        #endif
+
+        GS_FREE(render_ring);
+        render_ring = NULL;
+        render_threaded = GS_FALSE;
+    }
 #endif
 
-static GsConfig *active_config = NULL;
-static GS_BOOL mainloop_active = GS_FALSE;
+// Tells whether the render thread completed every op up to the one that returned the fence, without waiting.
+static GS_BOOL gs_render_passed(const uint64_t fence) {
+    #if defined(GS_RENDER_THREAD_SUPPORTED)
+        return !render_threaded || atomic_load(&render_tail) >= fence;
+    #else
+        (void) fence;
+        return GS_TRUE;
+    #endif
+}
+
+// Blocks until the render thread completed every op up to the one that returned the fence.
+static void gs_render_wait(const uint64_t fence) {
+    #if defined(GS_RENDER_THREAD_SUPPORTED)
+        if (!render_threaded || atomic_load(&render_tail) >= fence) {
+            return;
+        }
+
+        GS_RENDER_LOCK();
+        atomic_store(&render_producer_waiting, GS_TRUE);
+        while (atomic_load(&render_tail) < fence) {
+            GS_RENDER_WAIT(render_done);
+        }
+        atomic_store(&render_producer_waiting, GS_FALSE);
+        GS_RENDER_UNLOCK();
+    #else
+        (void) fence;
+    #endif
+}
+
+// Runs or queues an op, returns the fence to wait on for its completion.
+static uint64_t gs_render_submit(GsRenderOp *op) {
+    #if defined(GS_RENDER_THREAD_SUPPORTED)
+        if (render_threaded) {
+            const uint64_t head = atomic_load_explicit(&render_head, memory_order_relaxed);
+            if (head >= GS_RENDER_RING_SIZE) {
+                gs_render_wait(head - GS_RENDER_RING_SIZE + 1);
+            }
+
+            render_ring[head & (GS_RENDER_RING_SIZE - 1)] = *op;
+            atomic_store(&render_head, head + 1);
+
+            if (atomic_load(&render_consumer_waiting)) {
+                GS_RENDER_LOCK();
+                GS_RENDER_WAKE(render_work);
+                GS_RENDER_UNLOCK();
+            }
+
+            return head + 1;
+        }
+    #endif
+
+    op->func(op);
+    return 0;
+}
+
+static void gs_render_submit_sync(GsRenderOp *op) {
+    gs_render_wait(gs_render_submit(op));
+}
+
+// Fence covering every op queued so far, 0 without a render thread.
+static uint64_t gs_render_fence() {
+    #if defined(GS_RENDER_THREAD_SUPPORTED)
+        if (render_threaded) {
+            return atomic_load_explicit(&render_head, memory_order_relaxed);
+        }
+    #endif
+
+    return 0;
+}
+
+// Frame allocator. One bump allocated block per frame, with a render thread there is one more block than frames in
+// flight so a block is only reused once the render thread finished the frame that referenced it. Allocations that
+// do not fit get their own memory which is freed when the block comes around again, the block is then resized to
+// the largest frame of the recent history so overflowing stays the exception.
+#define GS_FRAME_ALLOCATOR_SLOTS (GS_RENDER_MAX_FRAMES_IN_FLIGHT + 1)
+
+typedef struct GsFrameAllocatorBlock {
+    struct GsFrameAllocatorBlock *next;
+} GsFrameAllocatorBlock;
+
+typedef struct GsFrameAllocatorSlot {
+    uint8_t *data;
+    int capacity;
+    atomic_int offset;
+    atomic_int allocations;
+    atomic_int overflow; // bytes
+    GsFrameAllocatorBlock *blocks; // overflow allocations
+    uint64_t fence; // render thread work that may still read the slot
+} GsFrameAllocatorSlot;
+
+struct GsFrameAllocator {
+    GsFrameAllocatorSlot slots[GS_FRAME_ALLOCATOR_SLOTS];
+    GsFrameAllocatorSlot *current;
+    atomic_flag lock; // guards the overflow lists
+    int history[GS_FRAME_ALLOCATOR_HISTORY];
+    int history_index;
+    int minimum_size;
+    GsFrameAllocatorStats stats;
+};
+
+static int gs_frame_allocator_round(const int size) {
+    return (size + 4095) & ~4095;
+}
+
+static void gs_frame_allocator_resize(GsFrameAllocator *allocator, GsFrameAllocatorSlot *slot, const int capacity) {
+    if (slot->data != NULL) {
+        allocator->stats.resize_count += 1;
+        GS_FREE(slot->data);
+    }
+
+    slot->data = (uint8_t*)GS_MALLOC(capacity);
+    GS_ASSERT(slot->data != NULL);
+    slot->capacity = capacity;
+}
+
+static GsFrameAllocator *gs_create_frame_allocator(GsConfig *config) {
+    GsFrameAllocator *allocator = GS_ALLOC(GsFrameAllocator);
+    GS_ASSERT(allocator != NULL);
+    GS_MEMSET(allocator, 0, sizeof(GsFrameAllocator));
+
+    atomic_flag_clear(&allocator->lock);
+    allocator->minimum_size = gs_frame_allocator_round(config->frame_allocator_size > 0 ? config->frame_allocator_size : GS_FRAME_ALLOCATOR_SIZE);
+
+    for (int i = 0; i < GS_FRAME_ALLOCATOR_SLOTS; i++) {
+        GsFrameAllocatorSlot *slot = &allocator->slots[i];
+        atomic_init(&slot->offset, 0);
+        atomic_init(&slot->allocations, 0);
+        atomic_init(&slot->overflow, 0);
+    }
+
+    // the remaining slots are allocated when the rotation first reaches them
+    allocator->current = &allocator->slots[0];
+    gs_frame_allocator_resize(allocator, allocator->current, allocator->minimum_size);
+    allocator->stats.capacity = allocator->minimum_size;
+
+    return allocator;
+}
+
+static void gs_frame_allocator_free_blocks(GsFrameAllocatorSlot *slot) {
+    GsFrameAllocatorBlock *block = slot->blocks;
+    while (block != NULL) {
+        GsFrameAllocatorBlock *next = block->next;
+        GS_FREE(block);
+        block = next;
+    }
+
+    slot->blocks = NULL;
+}
+
+static void gs_destroy_frame_allocator(GsFrameAllocator *allocator) {
+    for (int i = 0; i < GS_FRAME_ALLOCATOR_SLOTS; i++) {
+        gs_frame_allocator_free_blocks(&allocator->slots[i]);
+        GS_FREE(allocator->slots[i].data);
+    }
+
+    GS_FREE(allocator);
+}
+
+// Closes the current frame, the fence covers every op that may read its memory.
+static void gs_frame_allocator_advance(GsFrameAllocator *allocator, const uint64_t fence) {
+    GsFrameAllocatorSlot *slot = allocator->current;
+    slot->fence = fence;
+
+    const int offset = atomic_load_explicit(&slot->offset, memory_order_relaxed);
+    const int overflow = atomic_load_explicit(&slot->overflow, memory_order_relaxed);
+    const int used = offset + overflow;
+
+    allocator->stats.bytes_used = used;
+    allocator->stats.bytes_overflow = overflow;
+    allocator->stats.allocation_count = atomic_load_explicit(&slot->allocations, memory_order_relaxed);
+
+    allocator->history[allocator->history_index] = used;
+    allocator->history_index = (allocator->history_index + 1) % GS_FRAME_ALLOCATOR_HISTORY;
+
+    int peak = 0;
+    for (int i = 0; i < GS_FRAME_ALLOCATOR_HISTORY; i++) {
+        if (allocator->history[i] > peak) {
+            peak = allocator->history[i];
+        }
+    }
+
+    allocator->stats.bytes_peak = peak;
+
+    GsFrameAllocatorSlot *next = slot;
+    if (render_threaded) {
+        next = &allocator->slots[(slot - allocator->slots + 1) % GS_FRAME_ALLOCATOR_SLOTS];
+        gs_render_wait(next->fence);
+    }
+
+    gs_frame_allocator_free_blocks(next);
+
+    // a quarter of headroom over the recent peak, shrinking only once the block is more than twice that
+    int target = gs_frame_allocator_round(peak + peak / 4);
+    if (target < allocator->minimum_size) {
+        target = allocator->minimum_size;
+    }
+
+    if (next->capacity < target || next->capacity > target * 2) {
+        gs_frame_allocator_resize(allocator, next, target);
+    }
+
+    atomic_store_explicit(&next->offset, 0, memory_order_relaxed);
+    atomic_store_explicit(&next->allocations, 0, memory_order_relaxed);
+    atomic_store_explicit(&next->overflow, 0, memory_order_relaxed);
+
+    allocator->current = next;
+    allocator->stats.capacity = next->capacity;
+}
+
+static GS_BOOL gs_frame_allocator_contains(const void *data, const int size) {
+    if (active_config == NULL || active_config->frame_allocator == NULL) {
+        return GS_FALSE;
+    }
+
+    const GsFrameAllocatorSlot *slot = active_config->frame_allocator->current;
+    return (const uint8_t*) data >= slot->data && (const uint8_t*) data + size <= slot->data + slot->capacity;
+}
+
+void *gs_frame_alloc_aligned(const int size, const int alignment) {
+    GS_ASSERT(active_config != NULL);
+    GS_ASSERT(size >= 0);
+    GS_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    if (active_config->frame_allocator == NULL) {
+        active_config->frame_allocator = gs_create_frame_allocator(active_config);
+    }
+
+    GsFrameAllocator *allocator = active_config->frame_allocator;
+    GsFrameAllocatorSlot *slot = allocator->current;
+    atomic_fetch_add_explicit(&slot->allocations, 1, memory_order_relaxed);
+
+    const uintptr_t base = (uintptr_t) slot->data;
+    int offset = atomic_load_explicit(&slot->offset, memory_order_relaxed);
+    while (GS_TRUE) {
+        const int start = (int) (((base + offset + alignment - 1) & ~((uintptr_t) alignment - 1)) - base);
+        if (start + size > slot->capacity) {
+            break;
+        }
+
+        if (atomic_compare_exchange_weak_explicit(&slot->offset, &offset, start + size, memory_order_relaxed, memory_order_relaxed)) {
+            return slot->data + start;
+        }
+    }
+
+    // does not fit this frame, the next one is sized to include it
+    const int header = (int) sizeof(GsFrameAllocatorBlock) + alignment - 1;
+    GsFrameAllocatorBlock *block = (GsFrameAllocatorBlock*)GS_MALLOC(header + size);
+    GS_ASSERT(block != NULL);
+
+    while (atomic_flag_test_and_set_explicit(&allocator->lock, memory_order_acquire)) {
+        // only overflowing allocations get here
+    }
+
+    block->next = slot->blocks;
+    slot->blocks = block;
+    atomic_flag_clear_explicit(&allocator->lock, memory_order_release);
+
+    atomic_fetch_add_explicit(&slot->overflow, size, memory_order_relaxed);
+
+    const uintptr_t start = ((uintptr_t) (block + 1) + alignment - 1) & ~((uintptr_t) alignment - 1);
+    return (void*) start;
+}
+
+void *gs_frame_alloc(const int size) {
+    return gs_frame_alloc_aligned(size, GS_FRAME_ALLOCATOR_ALIGNMENT);
+}
+
+GsFrameAllocatorStats gs_get_frame_allocator_stats() {
+    GS_ASSERT(active_config != NULL);
+
+    if (active_config->frame_allocator == NULL) {
+        return (GsFrameAllocatorStats) { 0 };
+    }
+
+    return active_config->frame_allocator->stats;
+}
+
+// Uniform ring. Pushed data is staged in memory and uploaded by gs_frame with a single respecification of the ring
+// buffer before the frame's lists run, which also lets the driver hand out fresh storage instead of waiting on the GPU.
+struct GsUniformRing {
+    GsBuffer *buffer;
+    uint8_t *data;
+    int size;
+    int capacity;
+    uint8_t *flushed; // previous staging memory, swapped with data by the flush so the upload runs outside the lock
+    int flushed_capacity;
+    atomic_flag lock; // lists may be recorded on several threads
+};
+
+GsBuffer *gs_get_uniform_ring() {
+    GS_ASSERT(active_config != NULL);
+
+    if (active_config->uniform_ring == NULL) {
+        GsUniformRing *ring = GS_ALLOC(GsUniformRing);
+        GS_ASSERT(ring != NULL);
+
+        ring->buffer = gs_create_buffer(GS_BUFFER_TYPE_UNIFORM, GS_BUFFER_INTENT_DRAW_STREAM);
+        ring->data = NULL;
+        ring->size = 0;
+        ring->capacity = 0;
+        ring->flushed = NULL;
+        ring->flushed_capacity = 0;
+        atomic_flag_clear(&ring->lock);
+
+        active_config->uniform_ring = ring;
+    }
+
+    return active_config->uniform_ring->buffer;
+}
+
+int gs_push_uniform_data(const void *data, const int size) {
+    GS_ASSERT(data != NULL);
+    GS_ASSERT(size > 0);
+
+    gs_get_uniform_ring();
+    GsUniformRing *ring = active_config->uniform_ring;
+
+    while (atomic_flag_test_and_set_explicit(&ring->lock, memory_order_acquire)) {
+        // a push is a single copy, spinning beats a kernel lock here
+    }
+
+    const int offset = (ring->size + GS_UNIFORM_BUFFER_ALIGNMENT - 1) & ~(GS_UNIFORM_BUFFER_ALIGNMENT - 1);
+    if (offset + size > ring->capacity) {
+        int capacity = ring->capacity > 0 ? ring->capacity * 2 : GS_UNIFORM_BUFFER_ALIGNMENT * 64;
+        while (capacity < offset + size) {
+            capacity *= 2;
+        }
+
+        uint8_t *grown = (uint8_t*)GS_REALLOC(ring->data, capacity);
+        GS_ASSERT(grown != NULL);
+
+        ring->data = grown;
+        ring->capacity = capacity;
+    }
+
+    memcpy(ring->data + offset, data, size);
+    ring->size = offset + size;
+
+    atomic_flag_clear_explicit(&ring->lock, memory_order_release);
+    return offset;
+}
+
+static void gs_flush_uniform_ring(GsConfig *config, const GS_BOOL upload) {
+    GsUniformRing *ring = config->uniform_ring;
+    if (ring == NULL) {
+        return;
+    }
+
+    while (atomic_flag_test_and_set_explicit(&ring->lock, memory_order_acquire)) {
+        // pushes from recording threads finish quickly
+    }
+
+    // take the staged data and hand the pushes the spare memory, later pushes land in the next frame
+    uint8_t *data = ring->data;
+    const int size = ring->size;
+    const int capacity = ring->capacity;
+
+    ring->data = ring->flushed;
+    ring->capacity = ring->flushed_capacity;
+    ring->size = 0;
+    ring->flushed = data;
+    ring->flushed_capacity = capacity;
+
+    atomic_flag_clear_explicit(&ring->lock, memory_order_release);
+
+    if (upload && size > 0) {
+        gs_buffer_set_data(ring->buffer, data, size);
+    }
+}
+
+static void gs_destroy_uniform_ring(GsConfig *config) {
+    GsUniformRing *ring = config->uniform_ring;
+    if (ring == NULL) {
+        return;
+    }
+
+    gs_destroy_buffer(ring->buffer);
+    GS_FREE(ring->data);
+    GS_FREE(ring->flushed);
+    GS_FREE(ring);
+
+    config->uniform_ring = NULL;
+}
+
+// Data handed to a queued op has to outlive the call, ops that run at once keep using the caller's memory and so
+// do ops reading frame allocator memory, which is kept until the render thread is done with the frame.
+static void gs_render_set_data(GsRenderOp *op, const void *data, const int size) {
+    if (!render_threaded || size <= 0 || gs_frame_allocator_contains(data, size)) {
+        op->data = (void*) data;
+        return;
+    }
+
+    op->data = GS_MALLOC(size);
+    GS_ASSERT(op->data != NULL);
+    memcpy(op->data, data, size);
+    op->owned = GS_TRUE;
+}
+
+// Destroy ops end here, the id stays registered until the render thread is done with the resource.
+static void gs_render_release(GsRenderOp *op) {
+    gs_unregister_resource(op->id);
+    GS_FREE(op->resource);
+}
+
+static void gs_release_resource(const GsRenderOpFunc func, void *resource, const GsResourceId id) {
+    gs_capture_forget(id);
+
+    GsRenderOp op = { .func = func, .resource = resource, .id = id };
+    gs_render_submit(&op);
+}
+
+// Stream rings. Allocations move a head through the buffer and gs_frame closes the bytes taken since the previous frame
+// into a fenced frame. gs_frame polls the fences of the frames in flight and hands the bytes of the ones the GPU is
+// done with back to the ring, an allocation that would run into a frame still in flight fails instead of waiting, so
+// recording threads never wait on the GPU. Rings that could not be mapped are staged instead, they start over every
+// frame and the upload in gs_frame orphans the storage the previous frame was drawn from.
+typedef struct GsStreamFrame {
+    int offset;
+    int size; // bytes taken from the ring, alignment and wrapping included
+    void *fence; // written by the render thread
+    GS_BOOL signaled; // written by the render thread, readable once poll_fence passed
+    uint64_t poll_fence; // render op of the last poll
+} GsStreamFrame;
+
+struct GsStreamRing {
+    GsBuffer *buffer;
+    uint8_t *data; // mapped storage, or staging memory
+    GS_BOOL mapped;
+    int capacity;
+    int head; // next free byte
+    int used; // bytes held by the frames in flight and the current one
+    int frame_offset; // head when the current frame began
+    int frame_size;
+    GsStreamFrame frames[GS_STREAM_RING_MAX_FRAMES]; // in flight, oldest at frame_first
+    int frame_first;
+    int frame_count;
+    atomic_flag lock; // lists may be recorded on several threads
+    GsStreamRing *next;
+};
+
+static void gs_op_map_stream_buffer(GsRenderOp *op) {
+    *(void**) op->result = active_config->backend->map_stream_buffer(op->resource, op->size);
+}
+
+static void gs_op_create_fence(GsRenderOp *op) {
+    *(void**) op->target = active_config->backend->create_fence();
+}
+
+static void gs_op_wait_fence(GsRenderOp *op) {
+    void **fence = op->target;
+    active_config->backend->wait_fence(*fence, GS_FENCE_WAIT_FOREVER);
+    active_config->backend->destroy_fence(*fence);
+    *fence = NULL;
+}
+
+static void gs_op_destroy_fence(GsRenderOp *op) {
+    void **fence = op->target;
+    active_config->backend->destroy_fence(*fence);
+    *fence = NULL;
+}
+
+static void gs_op_poll_stream_frame(GsRenderOp *op) {
+    GsStreamFrame *frame = op->target;
+    if (!active_config->backend->wait_fence(frame->fence, 0)) {
+        return;
+    }
+
+    active_config->backend->destroy_fence(frame->fence);
+    frame->fence = NULL;
+    frame->signaled = GS_TRUE;
+}
+
+static void gs_op_upload_stream_ring(GsRenderOp *op) {
+    active_config->backend->set_buffer_data(op->resource, op->data, op->size);
+}
+
+void gs_buffer_set_stream_capacity(GsBuffer *buffer, const int capacity) {
+    GS_ASSERT(buffer != NULL);
+    GS_ASSERT(buffer->intent == GS_BUFFER_INTENT_DRAW_STREAM);
+    GS_ASSERT(buffer->stream == NULL); // mapped storage can't be resized
+    GS_ASSERT(capacity > 0);
+    GS_ASSERT(active_config != NULL);
+
+    GsStreamRing *ring = GS_ALLOC(GsStreamRing);
+    GS_ASSERT(ring != NULL);
+    GS_MEMSET(ring, 0, sizeof(GsStreamRing));
+
+    void *mapped = NULL;
+    GsRenderOp op = { .func = gs_op_map_stream_buffer, .resource = buffer, .size = capacity, .result = &mapped };
+    gs_render_submit_sync(&op);
+
+    if (mapped != NULL) {
+        ring->data = (uint8_t*) mapped;
+        ring->mapped = GS_TRUE;
+    } else {
+        ring->data = (uint8_t*) GS_MALLOC(capacity);
+        GS_ASSERT(ring->data != NULL);
+    }
+
+    ring->buffer = buffer;
+    ring->capacity = capacity;
+    atomic_flag_clear(&ring->lock);
+
+    ring->next = active_config->stream_rings;
+    active_config->stream_rings = ring;
+    buffer->stream = ring;
+}
+
+static void gs_stream_ring_lock(GsStreamRing *ring) {
+    while (atomic_flag_test_and_set_explicit(&ring->lock, memory_order_acquire)) {
+        // an allocation only moves the head
+    }
+}
+
+static void gs_stream_ring_unlock(GsStreamRing *ring) {
+    atomic_flag_clear_explicit(&ring->lock, memory_order_release);
+}
+
+// Hands the bytes of the oldest frame in flight back to the ring, the GPU has to be done with it.
+static void gs_stream_ring_release_frame(GsStreamRing *ring) {
+    const GsStreamFrame *frame = &ring->frames[ring->frame_first];
+
+    gs_stream_ring_lock(ring);
+    ring->used -= frame->size;
+    gs_stream_ring_unlock(ring);
+
+    ring->frame_first = (ring->frame_first + 1) % GS_STREAM_RING_MAX_FRAMES;
+    ring->frame_count -= 1;
+}
+
+// Waits until the GPU is done with the oldest frame in flight and releases it. API thread only, from gs_frame.
+static void gs_stream_ring_retire(GsStreamRing *ring) {
+    GsStreamFrame *frame = &ring->frames[ring->frame_first];
+
+    GsRenderOp op = { .func = gs_op_wait_fence, .target = &frame->fence };
+    gs_render_submit_sync(&op);
+
+    gs_stream_ring_release_frame(ring);
+}
+
+void *gs_buffer_stream_alloc(GsBuffer *buffer, const int size, const int alignment, int *offset) {
+    GS_ASSERT(buffer != NULL);
+    GS_ASSERT(buffer->stream != NULL);
+    GS_ASSERT(size > 0);
+    GS_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    GS_ASSERT(offset != NULL);
+
+    GsStreamRing *ring = buffer->stream;
+    GS_ASSERT(size <= ring->capacity);
+
+    gs_stream_ring_lock(ring);
+
+    int start = (ring->head + alignment - 1) & ~(alignment - 1);
+    int taken = start + size - ring->head;
+
+    // the rest of the ring is skipped when the allocation does not fit before its end
+    if (start + size > ring->capacity) {
+        start = 0;
+        taken = ring->capacity - ring->head + size;
+    }
+
+    // the frames in flight are only released by gs_frame, recording threads don't wait for the GPU
+    if (ring->used + taken > ring->capacity) {
+        gs_stream_ring_unlock(ring);
+        return NULL;
+    }
+
+    ring->head = start + size;
+    ring->used += taken;
+    ring->frame_size += taken;
+
+    gs_stream_ring_unlock(ring);
+
+    *offset = start;
+    return ring->data + start;
+}
+
+// Hands this frame's allocations to the GPU, ahead of the frame's lists and of the capture.
+static void gs_flush_stream_rings(GsConfig *config, const GS_BOOL upload) {
+    for (GsStreamRing *ring = config->stream_rings; ring != NULL; ring = ring->next) {
+        if (ring->frame_size == 0) {
+            continue;
+        }
+
+        if (ring->mapped) {
+            if (ring->frame_offset + ring->frame_size <= ring->capacity) {
+                gs_capture_shadow_buffer(ring->buffer, ring->data + ring->frame_offset, ring->frame_size, ring->frame_offset, GS_TRUE);
+            } else {
+                gs_capture_shadow_buffer(ring->buffer, ring->data + ring->frame_offset, ring->capacity - ring->frame_offset, ring->frame_offset, GS_TRUE);
+                gs_capture_shadow_buffer(ring->buffer, ring->data, ring->head, 0, GS_TRUE);
+            }
+
+            continue;
+        }
+
+        gs_stream_ring_lock(ring);
+
+        if (upload) {
+            GsRenderOp op = { .func = gs_op_upload_stream_ring, .resource = ring->buffer, .size = ring->head };
+            gs_render_set_data(&op, ring->data, ring->head);
+            gs_render_submit(&op);
+
+            gs_capture_shadow_buffer(ring->buffer, ring->data, ring->head, 0, GS_FALSE);
+        }
+
+        ring->head = 0;
+        ring->used = 0;
+        ring->frame_size = 0;
+
+        gs_stream_ring_unlock(ring);
+    }
+}
+
+// Releases the frames in flight the GPU is done with, oldest first. Their fences are polled by render ops, completed
+// is a fence the render thread already passed so the polls behind it can be looked at.
+static void gs_retire_stream_rings(GsConfig *config, const uint64_t completed) {
+    for (GsStreamRing *ring = config->stream_rings; ring != NULL; ring = ring->next) {
+        while (ring->frame_count > 0) {
+            GsStreamFrame *frame = &ring->frames[ring->frame_first];
+            if (frame->poll_fence > completed) {
+                break;
+            }
+
+            if (!frame->signaled) {
+                GsRenderOp op = { .func = gs_op_poll_stream_frame, .target = frame };
+                frame->poll_fence = gs_render_submit(&op);
+
+                // without a render thread the poll already ran
+                if (frame->poll_fence > completed || !frame->signaled) {
+                    break;
+                }
+            }
+
+            gs_stream_ring_release_frame(ring);
+        }
+    }
+}
+
+// Closes the frame of every mapped ring, its fence is queued behind the frame's lists.
+static void gs_fence_stream_rings(GsConfig *config) {
+    for (GsStreamRing *ring = config->stream_rings; ring != NULL; ring = ring->next) {
+        if (!ring->mapped || ring->frame_size == 0) {
+            continue;
+        }
+
+        if (ring->frame_count == GS_STREAM_RING_MAX_FRAMES) {
+            gs_stream_ring_retire(ring);
+        }
+
+        GsStreamFrame *frame = &ring->frames[(ring->frame_first + ring->frame_count) % GS_STREAM_RING_MAX_FRAMES];
+
+        // allocations for the next frame may already be under way on recording threads
+        gs_stream_ring_lock(ring);
+        frame->offset = ring->frame_offset;
+        frame->size = ring->frame_size;
+        ring->frame_offset = ring->head;
+        ring->frame_size = 0;
+        gs_stream_ring_unlock(ring);
+
+        frame->fence = NULL;
+        frame->signaled = GS_FALSE;
+        frame->poll_fence = 0;
+        ring->frame_count += 1;
+
+        GsRenderOp op = { .func = gs_op_create_fence, .target = &frame->fence };
+        gs_render_submit(&op);
+    }
+}
+
+// Nothing waits for the GPU here, a deleted buffer stays alive in the driver until the GPU is done with it.
+static void gs_destroy_stream_ring(GsStreamRing *ring) {
+    for (GsStreamRing **link = &active_config->stream_rings; *link != NULL; link = &(*link)->next) {
+        if (*link == ring) {
+            *link = ring->next;
+            break;
+        }
+    }
+
+    // queued behind the ops that create the fences, so these read them once they are written
+    for (int i = 0; i < ring->frame_count; i++) {
+        GsRenderOp op = { .func = gs_op_destroy_fence, .target = &ring->frames[(ring->frame_first + i) % GS_STREAM_RING_MAX_FRAMES].fence };
+        gs_render_submit_sync(&op);
+    }
+
+    if (!ring->mapped) {
+        GS_FREE(ring->data);
+    }
+
+    GS_FREE(ring);
+}
+
+// Texture reads are polled from gs_frame instead of being waited on. A poll op is only queued once the previous one
+// ran, which the frame fences tell without blocking, so a read costs one non-blocking fence query per frame.
+struct GsTextureRead {
+    GsReadback *readback;
+    int x;
+    int y;
+    int width;
+    int height;
+    void *dst;
+    GsTextureReadCallback callback;
+    void *user;
+    uint64_t poll_fence; // of the last op queued for the read
+    GsTextureRead *next;
+};
+
+static void gs_op_read_texture(GsRenderOp *op) {
+    GsTextureRead *read = op->resource;
+    active_config->backend->create_texture_readback_handle(read->readback, op->target, read->x, read->y, read->width, read->height);
+    read->readback->fence = active_config->backend->create_fence();
+}
+
+void gs_read_texture_async(GsTexture *texture, const int x, const int y, const int width, const int height, void *dst, const GsTextureReadCallback callback, void *user) {
+    GS_ASSERT(texture != NULL);
+    GS_ASSERT(texture->type == GS_TEXTURE_TYPE_2D);
+    GS_ASSERT(x >= 0 && y >= 0 && width > 0 && height > 0);
+    GS_ASSERT(x + width <= texture->width && y + height <= texture->height);
+    GS_ASSERT(active_config != NULL);
+    GS_ASSERT(active_config->backend != NULL);
+
+    GsReadback *readback = GS_ALLOC(GsReadback);
+    GS_ASSERT(readback != NULL);
+    GS_MEMSET(readback, 0, sizeof(GsReadback));
+    readback->size = width * height * gs_get_texture_format_size(texture->format);
+
+    GsTextureRead *read = GS_ALLOC(GsTextureRead);
+    GS_ASSERT(read != NULL);
+    read->readback = readback;
+    read->x = x;
+    read->y = y;
+    read->width = width;
+    read->height = height;
+    read->dst = dst;
+    read->callback = callback;
+    read->user = user;
+
+    GsRenderOp op = { .func = gs_op_read_texture, .resource = read, .target = texture };
+    read->poll_fence = gs_render_submit(&op);
+
+    read->next = active_config->texture_reads;
+    active_config->texture_reads = read;
+}
+
+static void gs_op_poll_readback(GsRenderOp *op) {
+    GsReadback *readback = op->resource;
+    if (active_config->backend->wait_fence(readback->fence, 0)) {
+        active_config->backend->destroy_fence(readback->fence);
+        readback->fence = NULL;
+        readback->data = active_config->backend->map_readback(readback);
+        atomic_store_explicit(&readback->complete, GS_TRUE, memory_order_release);
+    }
+}
+
+static void gs_deliver_texture_read(GsTextureRead *read) {
+    if (read->dst != NULL) {
+        memcpy(read->dst, read->readback->data, read->readback->size);
+    }
+
+    if (read->callback != NULL) {
+        read->callback(read->readback->data, read->width, read->height, read->user);
+    }
+
+    gs_destroy_readback(read->readback);
+    GS_FREE(read);
+}
+
+// completed is a fence the render thread already passed, the reads whose last op is behind it can be looked at
+static void gs_poll_texture_reads(GsConfig *config, const uint64_t completed) {
+    // detached first, callbacks may start new reads
+    GsTextureRead *reads = config->texture_reads;
+    config->texture_reads = NULL;
+
+    while (reads != NULL) {
+        GsTextureRead *read = reads;
+        reads = read->next;
+
+        if (read->poll_fence <= completed && atomic_load_explicit(&read->readback->complete, memory_order_acquire)) {
+            gs_deliver_texture_read(read);
+            continue;
+        }
+
+        if (read->poll_fence <= completed) {
+            GsRenderOp op = { .func = gs_op_poll_readback, .resource = read->readback };
+            read->poll_fence = gs_render_submit(&op);
+        }
+
+        read->next = config->texture_reads;
+        config->texture_reads = read;
+    }
+}
+
+static void gs_finish_texture_reads(GsConfig *config) {
+    while (config->texture_reads != NULL) {
+        GsTextureRead *read = config->texture_reads;
+        config->texture_reads = read->next;
+
+        gs_readback_get_data(read->readback);
+        gs_deliver_texture_read(read);
+    }
+}
+
+// Texture uploads are queued on the API thread and issued from gs_frame against the frame's budget. Issued uploads are
+// polled for completion the same way as texture reads, so the pending count of a texture is only touched here.
+struct GsTextureUpload {
+    GsTexture *texture; // NULL once the texture was destroyed
+    GsCubemapFace face;
+    int level;
+    int x;
+    int y;
+    int width;
+    int height;
+    int size;
+    int priority;
+    void *data; // freed by the render thread once the backend staged it
+    void *fence; // written by the render thread
+    GS_BOOL complete; // written by the render thread
+    uint64_t poll_fence; // of the last op queued for the upload
+    GsTextureUpload *next;
+};
+
+static GsTextureUpload *gs_queue_texture_upload(GsTexture *texture, const GsCubemapFace face, const int level, const int x, const int y, const int width, const int height, const void *data, const int priority) {
+    GsTextureUpload *upload = GS_ALLOC(GsTextureUpload);
+    GS_ASSERT(upload != NULL);
+    GS_MEMSET(upload, 0, sizeof(GsTextureUpload));
+    upload->texture = texture;
+    upload->face = face;
+    upload->level = level;
+    upload->x = x;
+    upload->y = y;
+    upload->width = width;
+    upload->height = height;
+    upload->size = width * height * gs_get_texture_format_size(texture->format);
+    upload->priority = priority;
+    upload->data = GS_MALLOC(upload->size);
+    GS_ASSERT(upload->data != NULL);
+    memcpy(upload->data, data, upload->size);
+
+    GsTextureUpload **link = &active_config->texture_uploads;
+    while (*link != NULL && (*link)->priority >= priority) {
+        link = &(*link)->next;
+    }
+
+    upload->next = *link;
+    *link = upload;
+
+    texture->pending_uploads += 1;
+    return upload;
+}
+
+void gs_texture_upload_async(GsTexture *texture, const GsCubemapFace face, const int x, const int y, const int width, const int height, const void *data, const int priority) {
+    GS_ASSERT(texture != NULL);
+    GS_ASSERT(data != NULL);
+    GS_ASSERT(texture->type == GS_TEXTURE_TYPE_CUBEMAP ? face != GS_CUBEMAP_FACE_NONE : face == GS_CUBEMAP_FACE_NONE);
+    GS_ASSERT(texture->stream == NULL);
+    GS_ASSERT(x >= 0 && y >= 0 && width > 0 && height > 0);
+    GS_ASSERT(x + width <= texture->width && y + height <= texture->height);
+    GS_ASSERT(active_config != NULL);
+    GS_ASSERT(active_config->backend != NULL);
+
+    gs_queue_texture_upload(texture, face, 0, x, y, width, height, data, priority);
+    gs_capture_shadow_texture_rect(texture, face, x, y, width, height, data);
+}
+
+GS_BOOL gs_texture_upload_pending(const GsTexture *texture) {
+    GS_ASSERT(texture != NULL);
+
+    return texture->pending_uploads > 0;
+}
+
+static void gs_op_upload_texture(GsRenderOp *op) {
+    GsTextureUpload *upload = op->resource;
+    active_config->backend->upload_texture(op->target, upload->face, upload->level, upload->x, upload->y, upload->width, upload->height, upload->data);
+    upload->fence = active_config->backend->create_fence();
+
+    // backends without fences upload synchronously, the upload is done once the call returned
+    if (upload->fence == NULL) {
+        upload->complete = GS_TRUE;
+    }
+
+    GS_FREE(upload->data);
+    upload->data = NULL;
+}
+
+static void gs_op_poll_texture_upload(GsRenderOp *op) {
+    GsTextureUpload *upload = op->resource;
+    if (active_config->backend->wait_fence(upload->fence, 0)) {
+        active_config->backend->destroy_fence(upload->fence);
+        upload->fence = NULL;
+        upload->complete = GS_TRUE;
+    }
+}
+
+static void gs_op_release_texture_upload(GsRenderOp *op) {
+    GsTextureUpload *upload = op->resource;
+    active_config->backend->destroy_fence(upload->fence);
+    GS_FREE(upload);
+}
+
+// Streamed textures keep a copy of every level they were given. requested is the finest level queued for upload and
+// resident the finest one sampled, the levels between the two are on their way. Both only move here, on the API
+// thread, the backend follows through set_texture_levels.
+struct GsTextureStream {
+    GsTexture *texture;
+    void *data[GS_TEXTURE_MAX_LEVELS]; // copies given with gs_texture_set_level_data
+    GsTextureUpload *uploads[GS_TEXTURE_MAX_LEVELS]; // latest upload of a requested level, until it completed
+    float screen_size;
+    int priority;
+    int requested;
+    int resident;
+    int arrived; // a bit per requested level whose latest upload completed
+    GsTextureStream *next;
+};
+
+static int gs_get_texture_level_size(const int size, const int level) {
+    const int level_size = size >> level;
+    return level_size > 0 ? level_size : 1;
+}
+
+// Coarser levels go first whatever the texture, the stream priority only orders levels of the same size.
+static int gs_texture_stream_upload_priority(const GsTextureStream *stream, const int level) {
+    const int priority = stream->priority < -32767 ? -32767 : (stream->priority > 32767 ? 32767 : stream->priority);
+    return level * 65536 + priority;
+}
+
+static void gs_op_set_texture_levels(GsRenderOp *op) {
+    active_config->backend->set_texture_levels(op->resource, op->value, op->offset);
+}
+
+static void gs_texture_stream_set_levels(const GsTextureStream *stream) {
+    GsRenderOp op = { .func = gs_op_set_texture_levels, .resource = stream->texture, .value = stream->resident, .offset = stream->requested };
+    gs_render_submit(&op);
+}
+
+static void gs_texture_stream_upload(GsTextureStream *stream, const int level) {
+    GsTexture *texture = stream->texture;
+    const int width = gs_get_texture_level_size(texture->width, level);
+    const int height = gs_get_texture_level_size(texture->height, level);
+
+    stream->uploads[level] = gs_queue_texture_upload(texture, GS_CUBEMAP_FACE_NONE, level, 0, 0, width, height, stream->data[level], gs_texture_stream_upload_priority(stream, level));
+}
+
+// The coarsest level that still has a texel per covered pixel, limited to the levels that have data.
+static int gs_texture_stream_wanted_level(const GsTextureStream *stream) {
+    const GsTexture *texture = stream->texture;
+    const int size = texture->width > texture->height ? texture->width : texture->height;
+
+    int level = texture->levels - 1;
+    while (level > 0 && (float) gs_get_texture_level_size(size, level) < stream->screen_size) {
+        level -= 1;
+    }
+
+    int available = texture->levels;
+    while (available > 0 && stream->data[available - 1] != NULL) {
+        available -= 1;
+    }
+
+    return level > available ? level : available;
+}
+
+static void gs_texture_stream_arrived(GsTextureStream *stream, const GsTextureUpload *upload) {
+    if (stream->uploads[upload->level] != upload) {
+        return; // dropped or replaced since
+    }
+
+    stream->uploads[upload->level] = NULL;
+    stream->arrived |= 1 << upload->level;
+
+    const int resident = stream->resident;
+    while (stream->resident > stream->requested && (stream->arrived & (1 << (stream->resident - 1))) != 0) {
+        stream->resident -= 1;
+    }
+
+    if (stream->resident != resident) {
+        gs_texture_stream_set_levels(stream);
+    }
+}
+
+// Drops the queued uploads of the levels finer than level, the issued ones are told apart by gs_texture_stream_arrived.
+static void gs_texture_stream_drop_uploads(GsConfig *config, GsTextureStream *stream, const int level) {
+    GsTextureUpload **link = &config->texture_uploads;
+    while (*link != NULL) {
+        GsTextureUpload *upload = *link;
+        if (upload->texture == stream->texture && upload->level < level) {
+            *link = upload->next;
+            upload->texture->pending_uploads -= 1;
+            GS_FREE(upload->data);
+            GS_FREE(upload);
+            continue;
+        }
+
+        link = &upload->next;
+    }
+
+    for (int i = 0; i < level; i++) {
+        stream->uploads[i] = NULL;
+    }
+}
+
+static void gs_update_texture_streams(GsConfig *config) {
+    for (GsTextureStream *stream = config->texture_streams; stream != NULL; stream = stream->next) {
+        const int wanted = gs_texture_stream_wanted_level(stream);
+
+        while (stream->requested > wanted) {
+            stream->requested -= 1;
+            gs_texture_stream_upload(stream, stream->requested);
+        }
+
+        if (stream->requested < wanted) {
+            stream->requested = wanted;
+            stream->arrived &= ~((1 << wanted) - 1);
+            gs_texture_stream_drop_uploads(config, stream, wanted);
+
+            if (stream->resident < wanted) {
+                stream->resident = wanted;
+            }
+
+            gs_texture_stream_set_levels(stream);
+        }
+    }
+}
+
+static void gs_destroy_texture_stream(GsConfig *config, GsTextureStream *stream) {
+    for (GsTextureStream **link = &config->texture_streams; *link != NULL; link = &(*link)->next) {
+        if (*link == stream) {
+            *link = stream->next;
+            break;
+        }
+    }
+
+    for (int i = 0; i < GS_TEXTURE_MAX_LEVELS; i++) {
+        GS_FREE(stream->data[i]);
+    }
+
+    GS_FREE(stream);
+}
+
+// completed is a fence the render thread already passed
+static void gs_issue_texture_uploads(GsConfig *config, const uint64_t completed) {
+    GsTextureUpload **link = &config->texture_uploads_issued;
+    while (*link != NULL) {
+        GsTextureUpload *upload = *link;
+
+        if (upload->poll_fence <= completed && upload->complete) {
+            if (upload->texture != NULL) {
+                upload->texture->pending_uploads -= 1;
+
+                if (upload->texture->stream != NULL) {
+                    gs_texture_stream_arrived(upload->texture->stream, upload);
+                }
+            }
+
+            *link = upload->next;
+            GS_FREE(upload);
+            continue;
+        }
+
+        if (upload->poll_fence <= completed) {
+            GsRenderOp op = { .func = gs_op_poll_texture_upload, .resource = upload };
+            upload->poll_fence = gs_render_submit(&op);
+        }
+
+        link = &upload->next;
+    }
+
+    gs_update_texture_streams(config);
+
+    // strictly in priority order, a large upload holds back the smaller ones behind it instead of being starved by them
+    int budget = config->texture_upload_budget;
+    GS_BOOL first = GS_TRUE;
+    while (config->texture_uploads != NULL && (first || config->texture_uploads->size <= budget)) {
+        GsTextureUpload *upload = config->texture_uploads;
+        config->texture_uploads = upload->next;
+        budget -= upload->size;
+        first = GS_FALSE;
+
+        GsRenderOp op = { .func = gs_op_upload_texture, .resource = upload, .target = upload->texture };
+        upload->poll_fence = gs_render_submit(&op);
+
+        upload->next = config->texture_uploads_issued;
+        config->texture_uploads_issued = upload;
+    }
+}
+
+// Queued uploads of a destroyed texture are dropped, the issued ones run before its destroy op.
+static void gs_forget_texture_uploads(GsConfig *config, const GsTexture *texture) {
+    GsTextureUpload **link = &config->texture_uploads;
+    while (*link != NULL) {
+        GsTextureUpload *upload = *link;
+        if (upload->texture == texture) {
+            *link = upload->next;
+            GS_FREE(upload->data);
+            GS_FREE(upload);
+            continue;
+        }
+
+        link = &upload->next;
+    }
+
+    for (GsTextureUpload *upload = config->texture_uploads_issued; upload != NULL; upload = upload->next) {
+        if (upload->texture == texture) {
+            upload->texture = NULL;
+        }
+    }
+}
+
+static void gs_finish_texture_uploads(GsConfig *config) {
+    while (config->texture_uploads != NULL) {
+        GsTextureUpload *upload = config->texture_uploads;
+        config->texture_uploads = upload->next;
+        GS_FREE(upload->data);
+        GS_FREE(upload);
+    }
+
+    // queued behind any poll still pending for them
+    while (config->texture_uploads_issued != NULL) {
+        GsTextureUpload *upload = config->texture_uploads_issued;
+        config->texture_uploads_issued = upload->next;
+
+        GsRenderOp op = { .func = gs_op_release_texture_upload, .resource = upload };
+        gs_render_submit(&op);
+    }
+}
+
+void gs_finish() {
+    gs_render_wait(gs_render_fence());
+}
+
+GsVtxLayout *gs_create_layout() {
+    GsVtxLayout *layout = GS_ALLOC(GsVtxLayout);
+    layout->count = 0;
+    layout->stride = 0;
+    layout->instance_stride = 0;
+    layout->stream_count = 0;
+    layout->components = 0;
+    layout->completed = GS_FALSE;
+    layout->handle = NULL;
+    GS_MEMSET(layout->stream_strides, 0, sizeof(layout->stream_strides));
+    GS_MEMSET(layout->stream_divisors, 0, sizeof(layout->stream_divisors));
+    layout->id = gs_register_resource(layout, GS_RESOURCE_TYPE_LAYOUT);
+
+    return layout;
+}
+
+static GS_BOOL gs_layout_add_item(GsVtxLayout *layout, const int stream, const int index, const GsVtxAttribType type, const int count, const int divisor) {
+    GS_ASSERT(layout != NULL);
+    GS_ASSERT(layout->count < GS_MAX_VERTEX_LAYOUT_ITEMS);
+    GS_ASSERT(stream == GS_VERTEX_STREAM_INSTANCE || (stream >= 0 && stream < GS_MAX_VERTEX_STREAMS));
+    GS_ASSERT(divisor >= 0);
+
+    GsVtxLayoutItem item = layout->items[layout->count];
+    item.index = index;
+    item.type = type;
+    item.size_total = 0;
+    item.size_per_item = 0;
+    item.offset = stream == GS_VERTEX_STREAM_INSTANCE ? layout->instance_stride : layout->stream_strides[stream];
+    item.normalized = GS_FALSE;
+    item.integer = GS_FALSE;
+    item.components = count;
+    item.divisor = divisor;
+    item.stream = stream;
+
+    switch (type) {
+        case GS_ATTRIB_TYPE_UINT8:
+            item.size_per_item = (int) sizeof(uint8_t);
+            break;
+        case GS_ATTRIB_TYPE_INT8:
+            item.size_per_item = (int) sizeof(int8_t);
+            break;
+        case GS_ATTRIB_TYPE_UINT16:
+            item.size_per_item = (int) sizeof(uint16_t);
+            break;
+        case GS_ATTRIB_TYPE_INT16:
+            item.size_per_item = (int) sizeof(int16_t);
+            break;
+        case GS_ATTRIB_TYPE_UINT32:
+            item.size_per_item = (int) sizeof(uint32_t);
+            break;
+        case GS_ATTRIB_TYPE_INT32:
+            item.size_per_item = (int) sizeof(int32_t);
+            break;
+        case GS_ATTRIB_TYPE_FLOAT:
+            item.size_per_item = (int) sizeof(float);
+            break;
+        case GS_ATTRIB_TYPE_DOUBLE:
+            item.size_per_item = (int) sizeof(double);
+            break;
+        case GS_ATTRIB_TYPE_HALF_FLOAT:
+            item.size_per_item = (int) sizeof(uint16_t);
+            break;
+        case GS_ATTRIB_TYPE_INT_2_10_10_10_REV:
+            GS_ASSERT(count == 4);
+            item.size_per_item = (int) sizeof(uint32_t);
+            break;
+        default:
+            return GS_FALSE;
+    }
+
+    item.size_total = type == GS_ATTRIB_TYPE_INT_2_10_10_10_REV ? item.size_per_item : item.size_per_item * count;
+
+    layout->items[layout->count] = item;
+    layout->count += 1;
+
+    if (stream == GS_VERTEX_STREAM_INSTANCE) {
+        layout->instance_stride += item.size_total;
+    } else {
+        layout->stream_strides[stream] += item.size_total;
+        layout->stride = layout->stream_strides[0];
+
+        if (stream >= layout->stream_count) {
+            layout->stream_count = stream + 1;
+        }
+    }
+
+    return GS_TRUE;
+}
+
+GS_BOOL gs_layout_add(GsVtxLayout *layout, const int index, const GsVtxAttribType type, const int count) {
+    return gs_layout_add_stream(layout, 0, index, type, count);
+}
+
+GS_BOOL gs_layout_add_instanced(GsVtxLayout *layout, const int index, const GsVtxAttribType type, const int count, const int divisor) {
+    GS_ASSERT(divisor > 0);
+
+    return gs_layout_add_item(layout, GS_VERTEX_STREAM_INSTANCE, index, type, count, divisor);
+}
+
+GS_BOOL gs_layout_add_stream(GsVtxLayout *layout, const int stream, const int index, const GsVtxAttribType type, const int count) {
+    GS_ASSERT(layout != NULL);
+    GS_ASSERT(stream >= 0 && stream < GS_MAX_VERTEX_STREAMS);
+
+    return gs_layout_add_item(layout, stream, index, type, count, layout->stream_divisors[stream]);
+}
+
+// Applies to the items already in the stream as well as the ones added later.
+void gs_layout_set_stream_divisor(GsVtxLayout *layout, const int stream, const int divisor) {
+    GS_ASSERT(layout != NULL);
+    GS_ASSERT(stream >= 0 && stream < GS_MAX_VERTEX_STREAMS);
+    GS_ASSERT(divisor >= 0);
+
+    layout->stream_divisors[stream] = divisor;
+
+    for (int i = 0; i < layout->count; i++) {
+        if (layout->items[i].stream == stream) {
+            layout->items[i].divisor = divisor;
+        }
+    }
+}
+
+const GsVtxLayoutItem *gs_layout_find_item(const GsVtxLayout *layout, const int index) {
+    GS_ASSERT(layout != NULL);
+
+    for (int i = 0; i < layout->count; i++) {
+        if (layout->items[i].index == index) {
+            return &layout->items[i];
+        }
+    }
+
+    return NULL;
+}
+
+void gs_layout_set_normalized(GsVtxLayout *layout, const int index, const GS_BOOL normalized) {
+    GsVtxLayoutItem *item = (GsVtxLayoutItem*) gs_layout_find_item(layout, index);
+    GS_ASSERT(item != NULL);
+    GS_ASSERT(!normalized || (item->type != GS_ATTRIB_TYPE_FLOAT && item->type != GS_ATTRIB_TYPE_DOUBLE && item->type != GS_ATTRIB_TYPE_HALF_FLOAT));
+    GS_ASSERT(!normalized || !item->integer);
+
+    item->normalized = normalized;
+}
+
+// Integer attributes are read with ivec/uvec inputs in the shader instead of being converted to floats.
+void gs_layout_set_integer(GsVtxLayout *layout, const int index, const GS_BOOL integer) {
+    GsVtxLayoutItem *item = (GsVtxLayoutItem*) gs_layout_find_item(layout, index);
+    GS_ASSERT(item != NULL);
+    GS_ASSERT(!integer || (item->type != GS_ATTRIB_TYPE_FLOAT && item->type != GS_ATTRIB_TYPE_DOUBLE && item->type != GS_ATTRIB_TYPE_HALF_FLOAT && item->type != GS_ATTRIB_TYPE_INT_2_10_10_10_REV));
+    GS_ASSERT(!integer || !item->normalized);
+
+    item->integer = integer;
+}
+
+static void gs_op_destroy_layout(GsRenderOp *op) {
+    GsVtxLayout *layout = op->resource;
+    if (layout->completed) {
+        active_config->backend->destroy_layout_handle(layout);
+    }
+
+    gs_render_release(op);
+}
+
+void gs_destroy_layout(GsVtxLayout *layout) {
+    GS_ASSERT(layout != NULL);
+    GS_ASSERT(layout->completed == GS_FALSE || active_config != NULL);
+    GS_ASSERT(layout->completed == GS_FALSE || active_config->backend != NULL);
+
+    gs_release_resource(gs_op_destroy_layout, layout, layout->id);
+}
+
+static void gs_op_init(GsRenderOp *op) {
+    GsConfig *config = op->resource;
+    GS_BOOL *result = op->result;
+
+    if (render_threaded && config->render_thread_start != NULL) {
+        config->render_thread_start(config);
+    }
+
+    GS_MEMSET(&config->backend->stats, 0, sizeof(GsBackendStats));
+    *result = config->backend->init(config->backend, config);
+
+    #if defined(GS_RENDER_THREAD_SUPPORTED)
+        if (render_threaded && !*result) {
+            if (config->render_thread_stop != NULL) {
+                config->render_thread_stop(config);
+            }
+
+            atomic_store(&render_running, GS_FALSE);
+        }
+    #endif
+}
+
+static void gs_op_shutdown(GsRenderOp *op) {
+    GsConfig *config = op->resource;
+    config->backend->shutdown(config->backend);
+
+    #if defined(GS_RENDER_THREAD_SUPPORTED)
+        if (render_threaded) {
+            if (config->render_thread_stop != NULL) {
+                config->render_thread_stop(config);
+            }
+
+            atomic_store(&render_running, GS_FALSE);
+        }
+    #endif
+}
+
+// With config->render_thread set the backend is initialized on, and afterwards only called from, a dedicated render
+// thread. The host hands the GL context over through config->render_thread_start. The API stays single threaded:
+// calls return once their work is queued, data passed to them is copied, and command lists are kept until the
+// frame that executes them completed. Resources used by frames still in flight must not be changed from elsewhere.
+GS_BOOL gs_init(GsConfig *config) {
+    GS_ASSERT(config != NULL);
+    GS_ASSERT(config->backend != NULL);
+    GS_ASSERT(active_config == NULL);
+
+    if (config->render_thread) {
+        #if defined(GS_RENDER_THREAD_SUPPORTED)
+            gs_render_thread_start();
+        #else
+            GS_LOG("Genesis render thread is not supported on this platform, continuing without one\n");
+        #endif
+    }
+
+    GS_MEMSET(render_frame_fences, 0, sizeof(render_frame_fences));
+    render_frame_index = 0;
+
+    GS_BOOL result = GS_FALSE;
+    GsRenderOp op = { .func = gs_op_init, .resource = config, .result = &result };
+    gs_render_submit_sync(&op);
+
+    if (!result) {
+        #if defined(GS_RENDER_THREAD_SUPPORTED)
+            if (render_threaded) {
+                gs_render_thread_join();
+            }
+        #endif
+
+        return GS_FALSE;
+    }
+
+    active_config = config;
+    return GS_TRUE;
+}
+
+static void gs_op_build_layout(GsRenderOp *op) {
+    active_config->backend->create_layout_handle(op->resource);
+}
+
+void gs_layout_build(GsVtxLayout *layout) {
+    GS_ASSERT(layout != NULL);
+    GS_ASSERT(layout->count > 0);
+    GS_ASSERT(layout->completed == GS_FALSE);
+    GS_ASSERT(active_config != NULL);
+    GS_ASSERT(active_config->backend != NULL);
+
+    GsRenderOp op = { .func = gs_op_build_layout, .resource = layout };
+    gs_render_submit(&op);
+
+    layout->completed = GS_TRUE;
+}
+
+GsConfig *gs_get_active_config() {
+    return active_config;
+}
+
+GsConfig *gs_create_config() {
+    GsConfig *config = GS_ALLOC(GsConfig);
+    config->backend = NULL;
+    config->window = NULL;
+    config->frame_lists = NULL;
+    config->frame_list_capacity = 0;
+    config->render_thread = GS_FALSE;
+    config->render_thread_start = NULL;
+    config->render_thread_stop = NULL;
+    config->frame_allocator_size = GS_FRAME_ALLOCATOR_SIZE;
+    config->frame_allocator = NULL;
+    config->uniform_ring = NULL;
+    config->stream_rings = NULL;
+    config->texture_reads = NULL;
+    config->texture_upload_budget = GS_TEXTURE_UPLOAD_BUDGET;
+    config->texture_uploads = NULL;
+    config->texture_uploads_issued = NULL;
+    config->texture_streams = NULL;
+
+    return config;
+}
+
+void gs_destroy_config(GsConfig *config) {
+    GS_ASSERT(config != NULL);
+    GS_ASSERT(active_config == NULL || active_config != config);
+
+    if (config->frame_allocator != NULL) {
+        gs_destroy_frame_allocator(config->frame_allocator);
+    }
+
+    GS_FREE(config->frame_lists);
+    GS_FREE(config);
+}
+
+GsBackend *gs_create_backend(const GsBackendType type) {
+    switch (type) {
+        case GS_BACKEND_OPENGL:
+            return gs_opengl_create();
+        case GS_BACKEND_NOOP:
+            return gs_noop_create();
+        default:
+            return NULL;
+            printf("Unknown backend type: %d\n", type);
+    }
+}
+
+void gs_destroy_backend(GsBackend *backend) {
+    GS_ASSERT(backend != NULL);
+    GS_ASSERT(active_config == NULL || active_config->backend != backend);
+
+    GS_FREE(backend);
+}
+
+GsBackendType gs_get_optimal_backend_type() {
+    return GS_BACKEND_OPENGL;
+}
+
+void gs_shutdown() {
+    GS_ASSERT(active_config != NULL);
+    GS_ASSERT(active_config->backend != NULL);
+
+    gs_finish_texture_reads(active_config);
+    gs_finish_texture_uploads(active_config);
+    gs_destroy_uniform_ring(active_config);
+
+    GsRenderOp op = { .func = gs_op_shutdown, .resource = active_config };
+    gs_render_submit_sync(&op);
+
+    #if defined(GS_RENDER_THREAD_SUPPORTED)
+        if (render_threaded) {
+            gs_render_thread_join();
+        }
+    #endif
+
+    active_config = NULL;
+}
+
+GsPipeline *gs_create_pipeline() {
+    GsPipeline *pipeline = GS_ALLOC(GsPipeline);
+    pipeline->layout = NULL;
+    pipeline->program = NULL;
+    pipeline->blend_dst = GS_BLEND_FACTOR_ONE;
+    pipeline->blend_src = GS_BLEND_FACTOR_ZERO;
+    pipeline->blend_op = GS_BLEND_OP_ADD;
+    pipeline->blend_dst_alpha = GS_BLEND_FACTOR_ONE;
+    pipeline->blend_src_alpha = GS_BLEND_FACTOR_ZERO;
+    pipeline->blend_op_alpha = GS_BLEND_OP_ADD;
+    pipeline->blend_enabled = GS_FALSE;
+    pipeline->depth_test = GS_FALSE;
+    pipeline->depth_write = GS_TRUE;
+    pipeline->depth_func = GS_DEPTH_FUNC_LESS;
+    pipeline->stencil_test = GS_FALSE;
+    pipeline->msaa_samples = 0; // disabled
+    pipeline->cull_face = GS_FALSE;
+    pipeline->cull_front = GS_WINDING_DIRECTION_CCW;
+    pipeline->primitive_type = GS_PRIMITIVE_TRIANGLES;
+    pipeline->id = gs_register_resource(pipeline, GS_RESOURCE_TYPE_PIPELINE);
+
+    return pipeline;
+}
+
+void gs_pipeline_set_layout(GsPipeline *pipeline, GsVtxLayout *layout) {
+    GS_ASSERT(pipeline != NULL);
+    GS_ASSERT(layout != NULL);
+
+    pipeline->layout = layout;
+}
+
+void gs_destroy_pipeline(GsPipeline *pipeline) {
+    GS_ASSERT(pipeline != NULL);
+
+    gs_release_resource(gs_render_release, pipeline, pipeline->id);
+}
+
+static void gs_op_create_buffer(GsRenderOp *op) {
+    active_config->backend->create_buffer_handle(op->resource);
+}
+
+GsBuffer *gs_create_buffer(const GsBufferType type, const GsBufferIntent intent) {
+    GS_ASSERT(active_config != NULL);
+    GS_ASSERT(active_config->backend != NULL);
+
+    GsBuffer *buffer = GS_ALLOC(GsBuffer);
+    buffer->type = type;
+    buffer->intent = intent;
+    buffer->index_type = GS_INDEX_TYPE_UINT32;
+    buffer->handle = NULL;
+    buffer->stream = NULL;
+    buffer->size = 0;
+    buffer->id = gs_register_resource(buffer, GS_RESOURCE_TYPE_BUFFER);
+
+    GsRenderOp op = { .func = gs_op_create_buffer, .resource = buffer };
+    gs_render_submit(&op);
+
+    return buffer;
+}
+
+static void gs_op_destroy_buffer(GsRenderOp *op) {
+    active_config->backend->destroy_buffer_handle(op->resource);
+    gs_render_release(op);
+}
+
+void gs_destroy_buffer(GsBuffer *buffer) {
+    GS_ASSERT(buffer != NULL);
+    GS_ASSERT(active_config != NULL);
+    GS_ASSERT(active_config->backend != NULL);
+
+    if (buffer->stream != NULL) {
+        gs_destroy_stream_ring(buffer->stream);
+        buffer->stream = NULL;
+    }
+
+    gs_release_resource(gs_op_destroy_buffer, buffer, buffer->id);
+}
+
+static void gs_op_set_buffer_data(GsRenderOp *op) {
+    active_config->backend->set_buffer_data(op->resource, op->data, op->size);
+}
+
+void gs_buffer_set_data(GsBuffer *buffer, void *data, int size) {
+    GS_ASSERT(buffer != NULL);
+    GS_ASSERT(buffer->stream == NULL);
+    GS_ASSERT(data != NULL);
+    GS_ASSERT(size > 0);
+    GS_ASSERT(active_config != NULL);
+    GS_ASSERT(active_config->backend != NULL);
+
+    GsRenderOp op = { .func = gs_op_set_buffer_data, .resource = buffer, .size = size };
+    gs_render_set_data(&op, data, size);
+    gs_render_submit(&op);
+
+    gs_capture_shadow_buffer(buffer, data, size, 0, GS_FALSE);
+}
+
+static void gs_op_set_buffer_partial_data(GsRenderOp *op) {
+    active_config->backend->set_buffer_partial_data(op->resource, op->data, op->size, op->offset);
+}
+
+void gs_buffer_set_partial_data(GsBuffer *buffer, void *data, int size, int offset) {
+    GS_ASSERT(buffer != NULL);
+    GS_ASSERT(buffer->stream == NULL);
+    GS_ASSERT(data != NULL);
+    GS_ASSERT(size > 0);
+    GS_ASSERT(offset >= 0);
+    GS_ASSERT(active_config != NULL);
+    GS_ASSERT(active_config->backend != NULL);
+
+    GsRenderOp op = { .func = gs_op_set_buffer_partial_data, .resource = buffer, .size = size, .offset = offset };
+    gs_render_set_data(&op, data, size);
+    gs_render_submit(&op);
+
+    gs_capture_shadow_buffer(buffer, data, size, offset, GS_TRUE);
+}
+
+// Read by the backend when it draws, so change it before the buffer is used by a submitted frame.
+void gs_buffer_set_index_type(GsBuffer *buffer, const GsIndexType type) {
+    GS_ASSERT(buffer != NULL);
+    GS_ASSERT(buffer->type == GS_BUFFER_TYPE_INDEX);
+
+    buffer->index_type = type;
+}
+
+GsUnmanagedBufferData *gs_buffer_get_data(GsBuffer *buffer, const int offset, const int size) {
+    GsReadback *readback = gs_buffer_read_async(buffer, offset, size);
+
+    GsUnmanagedBufferData *data = GS_ALLOC(GsUnmanagedBufferData);
+    GS_ASSERT(data != NULL);
+
+    data->data = GS_MALLOC(size);
+    GS_ASSERT(data->data != NULL);
+    data->size = size;
+
+    memcpy(data->data, gs_readback_get_data(readback), size);
+    gs_destroy_readback(readback);
+
+    return data;
+}
+
+void gs_destroy_unmanaged_buffer_data(GsUnmanagedBufferData *data) {
+    GS_ASSERT(data != NULL);
+    GS_FREE(data->data);
+    GS_FREE(data);
+}
+
+// Readback. The copy and its fence are queued together. Polling and mapping go through the render thread, the only
+// one allowed to touch the backend, but never wait for more than the copy.
+static void gs_op_read_buffer(GsRenderOp *op) {
+    GsReadback *readback = op->resource;
+    active_config->backend->create_readback_handle(readback, op->target, op->offset);
+    readback->fence = active_config->backend->create_fence();
+}
+
+GsReadback *gs_buffer_read_async(GsBuffer *buffer, const int offset, const int size) {
+    GS_ASSERT(buffer != NULL);
+    GS_ASSERT(offset >= 0);
+    GS_ASSERT(size > 0);
+    GS_ASSERT(active_config != NULL);
+    GS_ASSERT(active_config->backend != NULL);
+
+    GsReadback *readback = GS_ALLOC(GsReadback);
+    GS_ASSERT(readback != NULL);
+    GS_MEMSET(readback, 0, sizeof(GsReadback));
+    readback->size = size;
+    atomic_init(&readback->complete, GS_FALSE);
+
+    GsRenderOp op = { .func = gs_op_read_buffer, .resource = readback, .target = buffer, .offset = offset };
+    gs_render_submit(&op);
+
+    return readback;
+}
+
+static void gs_op_wait_readback(GsRenderOp *op) {
+    GsReadback *readback = op->resource;
+    if (active_config->backend->wait_fence(readback->fence, op->value ? GS_FENCE_WAIT_FOREVER : 0)) {
+        active_config->backend->destroy_fence(readback->fence);
+        readback->fence = NULL;
+        atomic_store_explicit(&readback->complete, GS_TRUE, memory_order_release);
+    }
+}
+
+// Never waits for the render thread, a poll is queued behind the ops already submitted and a later call sees its
+// result. Only one poll is in flight at a time.
+GS_BOOL gs_readback_poll(GsReadback *readback) {
+    GS_ASSERT(readback != NULL);
 
-GsVtxLayout *gs_create_layout() {
-    GsVtxLayout *layout = GS_ALLOC(GsVtxLayout);
-    layout->count = 0;
-    layout->stride = 0;
-    layout->components = 0;
-    layout->completed = GS_FALSE;
-    layout->handle = NULL;
+    if (atomic_load_explicit(&readback->complete, memory_order_acquire)) {
+        return GS_TRUE;
+    }
 
-    return layout;
+    if (gs_render_passed(readback->poll_fence)) {
+        GsRenderOp op = { .func = gs_op_wait_readback, .resource = readback, .value = GS_FALSE };
+        readback->poll_fence = gs_render_submit(&op);
+    }
+
+    // without a render thread the poll already ran
+    return atomic_load_explicit(&readback->complete, memory_order_acquire);
 }
 
-GS_BOOL gs_layout_add(GsVtxLayout *layout, const int index, const GsVtxAttribType type, const int count) {
-    GS_ASSERT(layout != NULL);
-    GS_ASSERT(layout->count < GS_MAX_VERTEX_LAYOUT_ITEMS);
+void gs_readback_wait(GsReadback *readback) {
+    GS_ASSERT(readback != NULL);
 
-    GsVtxLayoutItem item = layout->items[layout->count];
-    item.index = index;
-    item.type = type;
-    item.size_total = 0;
-    item.size_per_item = 0;
-    item.offset = layout->stride;
-    item.normalized = GS_FALSE;
-    item.components = count;
+    if (!atomic_load_explicit(&readback->complete, memory_order_acquire)) {
+        GsRenderOp op = { .func = gs_op_wait_readback, .resource = readback, .value = GS_TRUE };
+        gs_render_submit_sync(&op);
+    }
+}
 
-    switch (type) {
-        case GS_ATTRIB_TYPE_UINT8:
-            item.size_per_item = (int) sizeof(uint8_t);
-            break;
-        case GS_ATTRIB_TYPE_INT8:
-            item.size_per_item = (int) sizeof(int8_t);
+static void gs_op_map_readback(GsRenderOp *op) {
+    GsReadback *readback = op->resource;
+    readback->data = active_config->backend->map_readback(readback);
+}
+
+const void *gs_readback_get_data(GsReadback *readback) {
+    GS_ASSERT(readback != NULL);
+
+    gs_readback_wait(readback);
+
+    if (readback->data == NULL) {
+        GsRenderOp op = { .func = gs_op_map_readback, .resource = readback };
+        gs_render_submit_sync(&op);
+        GS_ASSERT(readback->data != NULL);
+    }
+
+    return readback->data;
+}
+
+static void gs_op_destroy_readback(GsRenderOp *op) {
+    GsReadback *readback = op->resource;
+    active_config->backend->destroy_fence(readback->fence);
+    active_config->backend->destroy_readback_handle(readback);
+    GS_FREE(readback);
+}
+
+void gs_destroy_readback(GsReadback *readback) {
+    GS_ASSERT(readback != NULL);
+
+    GsRenderOp op = { .func = gs_op_destroy_readback, .resource = readback };
+    gs_render_submit(&op);
+}
+
+static void gs_reserve(void **data, int *capacity, const int needed, const int element_size) {
+    if (needed <= *capacity) {
+        return;
+    }
+
+    int capacity_new = *capacity > 0 ? *capacity : 64;
+    while (capacity_new < needed) {
+        capacity_new *= 2;
+    }
+
+    void *grown = GS_REALLOC(*data, (size_t) capacity_new * element_size);
+    GS_ASSERT(grown != NULL);
+
+    *data = grown;
+    *capacity = capacity_new;
+}
+
+static void gs_command_arena_init(GsCommandArena *arena, const int chunk_size, const int alignment) {
+    arena->head = NULL;
+    arena->current = NULL;
+    arena->free_chunks = NULL;
+    arena->chunk_size = chunk_size;
+    arena->alignment = alignment;
+    arena->used = 0;
+    arena->reserved = 0;
+    arena->chunk_count = 0;
+}
+
+static GsCommandListChunk *gs_command_arena_next_chunk(GsCommandArena *arena, const int size) {
+    GsCommandListChunk *chunk = NULL;
+    GsCommandListChunk **link = &arena->free_chunks;
+
+    // reuse the first recycled chunk that is large enough
+    while (*link != NULL) {
+        if ((*link)->size >= size) {
+            chunk = *link;
+            *link = chunk->next;
             break;
-        case GS_ATTRIB_TYPE_UINT16:
-            item.size_per_item = (int) sizeof(uint16_t);
+        }
+
+        link = &(*link)->next;
+    }
+
+    if (chunk == NULL) {
+        const int chunk_size = size > arena->chunk_size ? size : arena->chunk_size;
+
+        chunk = (GsCommandListChunk*)GS_MALLOC(sizeof(GsCommandListChunk) + chunk_size);
+        GS_ASSERT(chunk != NULL);
+        chunk->size = chunk_size;
+
+        arena->reserved += chunk_size;
+        arena->chunk_count += 1;
+    }
+
+    chunk->next = NULL;
+    chunk->offset = 0;
+
+    if (arena->current != NULL) {
+        arena->current->next = chunk;
+    } else {
+        arena->head = chunk;
+    }
+
+    arena->current = chunk;
+    return chunk;
+}
+
+static void *gs_command_arena_alloc(GsCommandArena *arena, const int size) {
+    const int aligned = (size + arena->alignment - 1) & ~(arena->alignment - 1);
+
+    GsCommandListChunk *chunk = arena->current;
+    if (chunk == NULL || chunk->offset + aligned > chunk->size) {
+        chunk = gs_command_arena_next_chunk(arena, aligned);
+    }
+
+    void *data = chunk->data + chunk->offset;
+    chunk->offset += aligned;
+    arena->used += aligned;
+
+    return data;
+}
+
+static GS_BOOL gs_command_arena_contains(const GsCommandArena *arena, const void *data, const int size) {
+    for (const GsCommandListChunk *chunk = arena->head; chunk != NULL; chunk = chunk->next) {
+        if ((const char*) data >= chunk->data && (const char*) data + size <= chunk->data + chunk->offset) {
+            return GS_TRUE;
+        }
+    }
+
+    return GS_FALSE;
+}
+
+static void gs_command_arena_reset(GsCommandArena *arena) {
+    if (arena->head != NULL) {
+        // keep the first chunk in place, everything after it goes back to the free list
+        GsCommandListChunk *chunk = arena->head->next;
+        while (chunk != NULL) {
+            GsCommandListChunk *next = chunk->next;
+            chunk->next = arena->free_chunks;
+            arena->free_chunks = chunk;
+            chunk = next;
+        }
+
+        arena->head->next = NULL;
+        arena->head->offset = 0;
+    }
+
+    arena->current = arena->head;
+    arena->used = 0;
+}
+
+static void gs_command_arena_free_chunks(GsCommandArena *arena, GsCommandListChunk *chunk) {
+    while (chunk != NULL) {
+        GsCommandListChunk *next = chunk->next;
+        arena->reserved -= chunk->size;
+        arena->chunk_count -= 1;
+        GS_FREE(chunk);
+        chunk = next;
+    }
+}
+
+static void gs_command_arena_trim(GsCommandArena *arena) {
+    gs_command_arena_free_chunks(arena, arena->free_chunks);
+    arena->free_chunks = NULL;
+}
+
+// Moves every chunk owned by src onto the free list of dst, leaving src empty.
+static void gs_command_arena_recycle(GsCommandArena *dst, GsCommandArena *src) {
+    GsCommandListChunk *lists[2] = { src->head, src->free_chunks };
+
+    for (int i = 0; i < 2; i++) {
+        GsCommandListChunk *chunk = lists[i];
+        while (chunk != NULL) {
+            GsCommandListChunk *next = chunk->next;
+            chunk->next = dst->free_chunks;
+            dst->free_chunks = chunk;
+            chunk = next;
+        }
+    }
+
+    dst->reserved += src->reserved;
+    dst->chunk_count += src->chunk_count;
+
+    src->head = NULL;
+    src->current = NULL;
+    src->free_chunks = NULL;
+    src->used = 0;
+    src->reserved = 0;
+    src->chunk_count = 0;
+}
+
+static void *gs_command_arena_push(GsCommandArena *arena, const GsCommandType type, const int size) {
+    GS_ASSERT(size >= 0 && size <= GS_COMMAND_MAX_PAYLOAD);
+
+    // header and payload are allocated together so a command never straddles two chunks
+    GsCommandHeader *header = (GsCommandHeader*)gs_command_arena_alloc(arena, (int) sizeof(GsCommandHeader) + size);
+    header->type = (uint16_t) type;
+    header->size = (uint16_t) size;
+
+    return header + 1;
+}
+
+static void gs_command_arena_destroy(GsCommandArena *arena) {
+    gs_command_arena_free_chunks(arena, arena->head);
+    gs_command_arena_trim(arena);
+
+    arena->head = NULL;
+    arena->current = NULL;
+    arena->used = 0;
+}
+
+GsCommandList *gs_create_command_list() {
+    GsCommandList *list = GS_ALLOC(GsCommandList);
+    list->count = 0;
+    list->pipeline = NULL;
+    list->high_water_bytes = 0;
+    list->high_water_commands = 0;
+    list->order_key = 0;
+    list->submit_sequence = 0;
+    list->next_submission = NULL;
+    atomic_init(&list->queued, GS_FALSE);
+    list->fence = 0;
+    list->bundle = GS_FALSE;
+    list->sealed = GS_FALSE;
+    list->handle = NULL;
+    list->id = GS_INVALID_RESOURCE_ID;
+    list->sorter = NULL;
+    list->eliminated = 0;
+
+    // chunks are allocated lazily, an empty list costs nothing
+    gs_command_arena_init(&list->stream, GS_COMMAND_LIST_CHUNK_SIZE, GS_COMMAND_ALIGNMENT);
+    gs_command_arena_init(&list->data, GS_COMMAND_LIST_CHUNK_SIZE, GS_COMMAND_LIST_ALIGNMENT);
+
+    return list;
+}
+
+void gs_command_list_alloc_reset(GsCommandList *list) {
+    GS_ASSERT(list != NULL);
+    gs_command_arena_reset(&list->data);
+}
+
+void* gs_command_list_alloc(GsCommandList *list, int size) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(size > 0);
+
+    return gs_command_arena_alloc(&list->data, size);
+}
+
+void* gs_command_list_push(GsCommandList *list, const GsCommandType type, const int size) {
+    GS_ASSERT(list != NULL);
+
+    list->count += 1;
+    return gs_command_arena_push(&list->stream, type, size);
+}
+
+void gs_command_list_iter_begin(const GsCommandList *list, GsCommandIterator *iterator) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(iterator != NULL);
+
+    iterator->chunk = list->stream.head;
+    iterator->offset = 0;
+}
+
+const GsCommandHeader *gs_command_list_iter_next(GsCommandIterator *iterator) {
+    while (iterator->chunk != NULL) {
+        if (iterator->offset >= iterator->chunk->offset) {
+            iterator->chunk = iterator->chunk->next;
+            iterator->offset = 0;
+            continue;
+        }
+
+        const GsCommandHeader *header = (const GsCommandHeader*)(iterator->chunk->data + iterator->offset);
+        iterator->offset += GS_COMMAND_STRIDE(header);
+
+        // GS_COMMAND_NONE marks commands that were removed after recording
+        if (header->type != GS_COMMAND_NONE) {
+            return header;
+        }
+    }
+
+    return NULL;
+}
+
+void gs_command_list_trim(GsCommandList *list) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(!atomic_load_explicit(&list->queued, memory_order_acquire));
+
+    gs_render_wait(list->fence);
+    gs_command_arena_trim(&list->stream);
+    gs_command_arena_trim(&list->data);
+}
+
+GsCommandListStats gs_command_list_get_stats(GsCommandList *list) {
+    GS_ASSERT(list != NULL);
+
+    const int used = list->stream.used + list->data.used;
+
+    GsCommandListStats stats;
+    stats.bytes_used = used;
+    stats.bytes_reserved = list->stream.reserved + list->data.reserved;
+    stats.chunk_count = list->stream.chunk_count + list->data.chunk_count;
+    stats.command_count = list->count;
+    stats.eliminated_commands = list->eliminated;
+    stats.high_water_bytes = used > list->high_water_bytes ? used : list->high_water_bytes;
+    stats.high_water_commands = list->count > list->high_water_commands ? list->count : list->high_water_commands;
+
+    return stats;
+}
+
+GsCommandList *gs_create_bundle() {
+    GsCommandList *bundle = gs_create_command_list();
+    bundle->bundle = GS_TRUE;
+    bundle->id = gs_register_resource(bundle, GS_RESOURCE_TYPE_BUNDLE);
+
+    return bundle;
+}
+
+static void gs_free_command_list(GsCommandList *list) {
+    gs_command_arena_destroy(&list->stream);
+    gs_command_arena_destroy(&list->data);
+    GS_FREE(list);
+}
+
+// Bundles may still be executed by frames in flight, so they go away in order with the rest of the render work.
+static void gs_op_destroy_bundle(GsRenderOp *op) {
+    GsCommandList *bundle = op->resource;
+    if (bundle->sealed) {
+        active_config->backend->destroy_bundle_handle(bundle);
+    }
+
+    gs_unregister_resource(op->id);
+    gs_free_command_list(bundle);
+}
+
+void gs_destroy_command_list(GsCommandList *list) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(!atomic_load_explicit(&list->queued, memory_order_acquire));
+
+    gs_command_list_set_sorting(list, GS_FALSE);
+
+    if (list->bundle) {
+        GS_ASSERT(list->sealed == GS_FALSE || active_config != NULL);
+        GS_ASSERT(list->sealed == GS_FALSE || active_config->backend != NULL);
+
+        gs_release_resource(gs_op_destroy_bundle, list, list->id);
+        return;
+    }
+
+    gs_render_wait(list->fence);
+    gs_free_command_list(list);
+}
+
+// Returns the binding slot a bind command writes, or -1 for any other command.
+static int gs_binding_slot(const GsCommandHeader *header, GsResourceId *id) {
+    switch (header->type) {
+        case GS_COMMAND_USE_PIPELINE:
+            *id = GS_COMMAND_DATA(header, GsPipelineCommand)->pipeline;
+            return GS_BINDING_PIPELINE;
+        case GS_COMMAND_USE_BUFFER: {
+            *id = GS_COMMAND_DATA(header, GsUseBufferCommand)->buffer;
+            const GsBuffer *buffer = gs_get_resource(*id, GS_RESOURCE_TYPE_BUFFER);
+            return buffer->type == GS_BUFFER_TYPE_VERTEX ? GS_BINDING_VERTEX_BUFFER : GS_BINDING_INDEX_BUFFER;
+        }
+        case GS_COMMAND_USE_INSTANCE_BUFFER:
+            *id = GS_COMMAND_DATA(header, GsUseBufferCommand)->buffer;
+            return GS_BINDING_INSTANCE_BUFFER;
+        case GS_COMMAND_USE_VERTEX_STREAM: {
+            const GsUseVertexStreamCommand *cmd = GS_COMMAND_DATA(header, GsUseVertexStreamCommand);
+            GS_ASSERT(cmd->stream > 0 && cmd->stream < GS_MAX_VERTEX_STREAMS);
+            *id = cmd->buffer;
+            return GS_BINDING_VERTEX_STREAM + cmd->stream;
+        }
+        case GS_COMMAND_USE_TEXTURE: {
+            const GsTextureCommand *cmd = GS_COMMAND_DATA(header, GsTextureCommand);
+            GS_ASSERT(cmd->slot >= 0 && cmd->slot < GS_MAX_TEXTURE_SLOTS);
+            *id = cmd->texture;
+            return GS_BINDING_TEXTURE + cmd->slot;
+        }
+        default:
+            return -1;
+    }
+}
+
+// Updates the tracked state for a command that is neither a bind nor a draw.
+static void gs_binding_tracker_barrier(GsBindingTracker *tracker, const GsCommandHeader *header) {
+    GsResourceId *slots = tracker->current.slots;
+
+    switch (header->type) {
+        case GS_COMMAND_GEN_MIPMAPS:
+            slots[GS_BINDING_TEXTURE] = GS_COMMAND_DATA(header, GsGenMipmapsCommand)->texture;
             break;
-        case GS_ATTRIB_TYPE_INT16:
-            item.size_per_item = (int) sizeof(int16_t);
+        case GS_COMMAND_COPY_TEXTURE_PARTIAL:
+            // the backend binds src to slot 0 and dst to slot 1
+            slots[GS_BINDING_TEXTURE] = GS_COMMAND_DATA(header, GsCopyTexturePartialCommand)->src;
+            slots[GS_BINDING_TEXTURE + 1] = GS_COMMAND_DATA(header, GsCopyTexturePartialCommand)->dst;
             break;
-        case GS_ATTRIB_TYPE_UINT32:
-            item.size_per_item = (int) sizeof(uint32_t);
+        case GS_COMMAND_RESOLVE_TEXTURE:
+            slots[GS_BINDING_TEXTURE] = GS_COMMAND_DATA(header, GsResolveTextureCommand)->src;
+            slots[GS_BINDING_TEXTURE + 1] = GS_COMMAND_DATA(header, GsResolveTextureCommand)->dst;
             break;
-        case GS_ATTRIB_TYPE_INT32:
-            item.size_per_item = (int) sizeof(int32_t);
+        case GS_COMMAND_BEGIN_PASS:
+            GS_ASSERT(tracker->depth < GS_TABLE_SIZE(tracker->stack));
+            tracker->stack[tracker->depth] = tracker->current;
+            tracker->depth += 1;
             break;
-        case GS_ATTRIB_TYPE_FLOAT:
-            item.size_per_item = (int) sizeof(float);
+        case GS_COMMAND_END_PASS:
+            // the pass restores whatever was requested when it began, anything bound before this list is unknown
+            if (tracker->depth > 0) {
+                tracker->depth -= 1;
+                tracker->current = tracker->stack[tracker->depth];
+            } else {
+                GS_MEMSET(&tracker->current, 0, sizeof(GsBindingState));
+            }
             break;
-        case GS_ATTRIB_TYPE_DOUBLE:
-            item.size_per_item = (int) sizeof(double);
+        case GS_COMMAND_EXECUTE_BUNDLE:
+            GS_MEMSET(&tracker->current, 0, sizeof(GsBindingState));
             break;
         default:
-            return GS_FALSE;
+            break;
+    }
+}
+
+static GS_BOOL gs_is_draw_command(const GsCommandType type) {
+    return type == GS_COMMAND_DRAW_ARRAYS || type == GS_COMMAND_DRAW_INDEXED ||
+        type == GS_COMMAND_DRAW_ARRAYS_INSTANCED || type == GS_COMMAND_DRAW_INDEXED_INSTANCED ||
+        type == GS_COMMAND_DRAW_INDIRECT || type == GS_COMMAND_MULTI_DRAW_INDIRECT;
+}
+
+static GS_BOOL gs_is_uniform_array_command(const GsCommandType type) {
+    return type >= GS_COMMAND_SET_UNIFORM_FLOAT_ARRAY && type <= GS_COMMAND_SET_UNIFORM_MAT4_ARRAY;
+}
+
+// Uniform block binds count as uniform commands, they are per-draw state applied right away as well.
+static GS_BOOL gs_is_uniform_command(const GsCommandType type) {
+    return (type >= GS_COMMAND_SET_UNIFORM_INT && type <= GS_COMMAND_SET_UNIFORM_MAT4) || gs_is_uniform_array_command(type) ||
+        type == GS_COMMAND_USE_UNIFORM_BLOCK;
+}
+
+// Whether a uniform write leaves nothing of an earlier one to the same location, a single value counts as an array of
+// one element of the matching array command.
+static GS_BOOL gs_uniform_replaces(const GsCommandHeader *uniform, const GsCommandHeader *earlier) {
+    static const GsCommandType element_types[GS_COMMAND_COUNT] = {
+        [GS_COMMAND_SET_UNIFORM_FLOAT] = GS_COMMAND_SET_UNIFORM_FLOAT_ARRAY,
+        [GS_COMMAND_SET_UNIFORM_VEC2]  = GS_COMMAND_SET_UNIFORM_VEC2_ARRAY,
+        [GS_COMMAND_SET_UNIFORM_VEC3]  = GS_COMMAND_SET_UNIFORM_VEC3_ARRAY,
+        [GS_COMMAND_SET_UNIFORM_VEC4]  = GS_COMMAND_SET_UNIFORM_VEC4_ARRAY,
+        [GS_COMMAND_SET_UNIFORM_MAT4]  = GS_COMMAND_SET_UNIFORM_MAT4_ARRAY,
+    };
+
+    const GsCommandType type = element_types[uniform->type] != GS_COMMAND_NONE ? element_types[uniform->type] : uniform->type;
+    const GsCommandType earlier_type = element_types[earlier->type] != GS_COMMAND_NONE ? element_types[earlier->type] : earlier->type;
+    if (type != earlier_type || *GS_COMMAND_DATA(uniform, GsUniformLocation) != *GS_COMMAND_DATA(earlier, GsUniformLocation)) {
+        return GS_FALSE;
     }
 
-    item.size_total = item.size_per_item * count;
+    const int count = gs_is_uniform_array_command(uniform->type) ? GS_COMMAND_DATA(uniform, GsUniformArrayCommand)->count : 1;
+    const int earlier_count = gs_is_uniform_array_command(earlier->type) ? GS_COMMAND_DATA(earlier, GsUniformArrayCommand)->count : 1;
+    return count >= earlier_count;
+}
 
-    layout->items[layout->count] = item;
-    layout->count += 1;
-    layout->stride += item.size_total;
+void gs_command_list_set_sorting(GsCommandList *list, const GS_BOOL enabled) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(!atomic_load_explicit(&list->queued, memory_order_acquire));
 
-    return GS_TRUE;
+    if (enabled && list->sorter == NULL) {
+        GsCommandSorter *sorter = GS_ALLOC(GsCommandSorter);
+        GS_MEMSET(sorter, 0, sizeof(GsCommandSorter));
+        list->sorter = sorter;
+    }
+
+    if (!enabled && list->sorter != NULL) {
+        GsCommandSorter *sorter = list->sorter;
+        GS_FREE(sorter->keys);
+        GS_FREE(sorter->packets);
+        GS_FREE(sorter->entries);
+        GS_FREE(sorter->entries_temp);
+        GS_FREE(sorter->uniforms);
+        GS_FREE(sorter);
+        list->sorter = NULL;
+    }
 }
 
-void gs_destroy_layout(GsVtxLayout *layout) {
-    GS_ASSERT(layout != NULL);
+void gs_set_sort_layer(GsCommandList *list, const int layer) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(list->sorter != NULL);
+    GS_ASSERT(layer >= 0 && layer <= 0xFF);
 
-    if (layout->completed) {
-        GS_ASSERT(active_config != NULL);
-        GS_ASSERT(active_config->backend != NULL);
+    list->sorter->layer = layer;
+}
+
+void gs_set_sort_depth(GsCommandList *list, const float depth) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(list->sorter != NULL);
+
+    list->sorter->depth = depth;
+}
+
+uint64_t gs_make_sort_key(const int layer, const GS_BOOL translucent, const GsResourceId pipeline, const GsResourceId program, const GsResourceId texture, const float depth) {
+    const float clamped = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+    uint64_t key = ((uint64_t) (layer & 0xFF)) << 56;
+
+    if (translucent) {
+        // [layer:8][1][far to near depth:24][pipeline:16][texture:15]
+        key |= 1ull << 55;
+        key |= ((uint64_t) ((1.0f - clamped) * 0xFFFFFF)) << 31;
+        key |= ((uint64_t) (pipeline & 0xFFFF)) << 15;
+        key |= (uint64_t) (texture & 0x7FFF);
+    } else {
+        // [layer:8][0][pipeline:16][program:12][texture:16][near to far depth:11]
+        key |= ((uint64_t) (pipeline & 0xFFFF)) << 39;
+        key |= ((uint64_t) (program & 0xFFF)) << 27;
+        key |= ((uint64_t) (texture & 0xFFFF)) << 11;
+        key |= (uint64_t) (clamped * 0x7FF);
+    }
+
+    return key;
+}
+
+static void gs_sort_record_draw(GsCommandList *list) {
+    GsCommandSorter *sorter = list->sorter;
+
+    gs_reserve((void**) &sorter->keys, &sorter->key_capacity, sorter->key_count + 1, sizeof(uint64_t));
+    sorter->keys[sorter->key_count] = gs_make_sort_key(sorter->layer, sorter->translucent, sorter->pipeline, sorter->program, sorter->texture, sorter->depth);
+    sorter->key_count += 1;
+}
+
+// Stable LSD radix sort, passes where every key shares the same byte are skipped.
+static GsSortEntry *gs_radix_sort(GsSortEntry *entries, GsSortEntry *temp, const int count) {
+    for (int shift = 0; shift < 64; shift += 8) {
+        int offsets[256] = { 0 };
+
+        for (int i = 0; i < count; i++) {
+            offsets[(entries[i].key >> shift) & 0xFF] += 1;
+        }
+
+        if (offsets[(entries[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        int total = 0;
+        for (int i = 0; i < 256; i++) {
+            const int bucket = offsets[i];
+            offsets[i] = total;
+            total += bucket;
+        }
+
+        for (int i = 0; i < count; i++) {
+            temp[offsets[(entries[i].key >> shift) & 0xFF]++] = entries[i];
+        }
+
+        GsSortEntry *swap = entries;
+        entries = temp;
+        temp = swap;
+    }
+
+    return entries;
+}
+
+typedef struct GsSortWriter {
+    GsCommandArena *arena;
+    int count;
+    GsBindingState emitted; // what the rewritten stream has bound so far
+} GsSortWriter;
+
+static void gs_sort_emit_copy(GsSortWriter *writer, const GsCommandHeader *header) {
+    void *payload = gs_command_arena_push(writer->arena, (GsCommandType) header->type, header->size);
+    memcpy(payload, header + 1, header->size);
+    writer->count += 1;
+}
+
+static void gs_sort_emit_id(GsSortWriter *writer, const GsCommandType type, const GsResourceId id) {
+    GsResourceId *payload = (GsResourceId*)gs_command_arena_push(writer->arena, type, sizeof(GsResourceId));
+    *payload = id;
+    writer->count += 1;
+}
+
+static void gs_sort_emit_bindings(GsSortWriter *writer, const GsBindingState *bindings) {
+    for (int i = 0; i < GS_BINDING_COUNT; i++) {
+        const GsResourceId id = bindings->slots[i];
+        if (id == GS_INVALID_RESOURCE_ID || id == writer->emitted.slots[i]) {
+            continue;
+        }
+
+        if (i == GS_BINDING_PIPELINE) {
+            gs_sort_emit_id(writer, GS_COMMAND_USE_PIPELINE, id);
+        } else if (i == GS_BINDING_VERTEX_BUFFER || i == GS_BINDING_INDEX_BUFFER) {
+            gs_sort_emit_id(writer, GS_COMMAND_USE_BUFFER, id);
+        } else if (i == GS_BINDING_INSTANCE_BUFFER) {
+            gs_sort_emit_id(writer, GS_COMMAND_USE_INSTANCE_BUFFER, id);
+        } else if (i < GS_BINDING_TEXTURE) {
+            GsUseVertexStreamCommand *cmd = (GsUseVertexStreamCommand*)gs_command_arena_push(writer->arena, GS_COMMAND_USE_VERTEX_STREAM, sizeof(GsUseVertexStreamCommand));
+            cmd->buffer = id;
+            cmd->stream = i - GS_BINDING_VERTEX_STREAM;
+            writer->count += 1;
+        } else {
+            GsTextureCommand *cmd = (GsTextureCommand*)gs_command_arena_push(writer->arena, GS_COMMAND_USE_TEXTURE, sizeof(GsTextureCommand));
+            cmd->texture = id;
+            cmd->slot = i - GS_BINDING_TEXTURE;
+            writer->count += 1;
+        }
+
+        writer->emitted.slots[i] = id;
+    }
+}
+
+// Emits the draws of the current segment in key order, then restores the state the segment ended with.
+static void gs_sort_flush(GsCommandSorter *sorter, GsSortWriter *writer, const GsBindingState *current, const int trailing_uniforms) {
+    const int count = sorter->packet_count;
+
+    if (count > 0) {
+        gs_reserve((void**) &sorter->entries, &sorter->entry_capacity, count, sizeof(GsSortEntry));
+        gs_reserve((void**) &sorter->entries_temp, &sorter->entry_temp_capacity, count, sizeof(GsSortEntry));
+
+        for (int i = 0; i < count; i++) {
+            sorter->entries[i].key = sorter->packets[i].key;
+            sorter->entries[i].packet = i;
+        }
 
-        active_config->backend->destroy_layout_handle(layout);
-    }
+        const GsSortEntry *sorted = gs_radix_sort(sorter->entries, sorter->entries_temp, count);
 
-    GS_FREE(layout);
-}
+        for (int i = 0; i < count; i++) {
+            const GsSortPacket *packet = &sorter->packets[sorted[i].packet];
 
-GS_BOOL gs_init(GsConfig *config) {
-    GS_ASSERT(config != NULL);
-    GS_ASSERT(config->backend != NULL);
-    GS_ASSERT(active_config == NULL);
+            gs_sort_emit_bindings(writer, &packet->bindings);
+            for (int u = 0; u < packet->uniform_count; u++) {
+                gs_sort_emit_copy(writer, sorter->uniforms[packet->uniform_first + u]);
+            }
 
-    if (!config->backend->init(config->backend, config)) {
-        return GS_FALSE;
+            gs_sort_emit_copy(writer, packet->draw);
+        }
     }
 
-    active_config = config;
-    return GS_TRUE;
+    gs_sort_emit_bindings(writer, current);
+    for (int u = trailing_uniforms; u < sorter->uniform_count; u++) {
+        gs_sort_emit_copy(writer, sorter->uniforms[u]);
+    }
+
+    sorter->packet_count = 0;
+    sorter->uniform_count = 0;
 }
 
-void gs_layout_build(GsVtxLayout *layout) {
-    GS_ASSERT(layout != NULL);
-    GS_ASSERT(layout->count > 0);
-    GS_ASSERT(layout->completed == GS_FALSE);
-    GS_ASSERT(active_config != NULL);
-    GS_ASSERT(active_config->backend != NULL);
+static void gs_sort_command_list(GsCommandList *list) {
+    GsCommandSorter *sorter = list->sorter;
+
+    // the sorted stream is written into a new arena that reuses the list's recycled chunks
+    GsCommandArena sorted;
+    gs_command_arena_init(&sorted, list->stream.chunk_size, list->stream.alignment);
+    sorted.free_chunks = list->stream.free_chunks;
+    list->stream.free_chunks = NULL;
+
+    GsSortWriter writer;
+    GS_MEMSET(&writer, 0, sizeof(GsSortWriter));
+    writer.arena = &sorted;
+
+    GsBindingTracker tracker;
+    GS_MEMSET(&tracker, 0, sizeof(GsBindingTracker));
+
+    int draw_index = 0;
+    int segment_uniforms = 0; // first uniform recorded after the last draw
+    sorter->packet_count = 0;
+    sorter->uniform_count = 0;
+
+    GsCommandIterator iterator;
+    gs_command_list_iter_begin(list, &iterator);
+
+    const GsCommandHeader *header;
+    while ((header = gs_command_list_iter_next(&iterator)) != NULL) {
+        const GsCommandType type = (GsCommandType) header->type;
+
+        GsResourceId id;
+        const int slot = gs_binding_slot(header, &id);
+
+        if (slot >= 0) {
+            tracker.current.slots[slot] = id;
+        } else if (gs_is_uniform_command(type)) {
+            gs_reserve((void**) &sorter->uniforms, &sorter->uniform_capacity, sorter->uniform_count + 1, sizeof(GsCommandHeader*));
+            sorter->uniforms[sorter->uniform_count] = header;
+            sorter->uniform_count += 1;
+        } else if (gs_is_draw_command(type)) {
+            GS_ASSERT(draw_index < sorter->key_count);
+            GS_ASSERT(tracker.current.slots[GS_BINDING_PIPELINE] != GS_INVALID_RESOURCE_ID); // sorted draws must bind their own state
+
+            gs_reserve((void**) &sorter->packets, &sorter->packet_capacity, sorter->packet_count + 1, sizeof(GsSortPacket));
+            GsSortPacket *packet = &sorter->packets[sorter->packet_count];
+            packet->key = sorter->keys[draw_index];
+            packet->bindings = tracker.current;
+            packet->draw = header;
+            packet->uniform_first = segment_uniforms;
+            packet->uniform_count = sorter->uniform_count - segment_uniforms;
+
+            sorter->packet_count += 1;
+            segment_uniforms = sorter->uniform_count;
+            draw_index += 1;
+        } else {
+            // anything else is a barrier that draws cannot be moved across
+            gs_sort_flush(sorter, &writer, &tracker.current, segment_uniforms);
+            segment_uniforms = 0;
+
+            gs_sort_emit_copy(&writer, header);
+
+            // the flush left the emitted state equal to the tracked one, so it follows the barrier the same way
+            gs_binding_tracker_barrier(&tracker, header);
+            writer.emitted = tracker.current;
+        }
+    }
 
-    active_config->backend->create_layout_handle(layout);
+    gs_sort_flush(sorter, &writer, &tracker.current, segment_uniforms);
 
-    layout->completed = GS_TRUE;
+    gs_command_arena_recycle(&sorted, &list->stream);
+    list->stream = sorted;
+    list->count = writer.count;
 }
 
-GsConfig *gs_create_config() {
-    GsConfig *config = GS_ALLOC(GsConfig);
-    config->backend = NULL;
-    config->window = NULL;
-    config->command_list_count = 0;
-    
-    return config;
+static void gs_command_list_remove(GsCommandList *list, const GsCommandHeader *header) {
+    // removed commands stay in the stream as padding that the iterator skips
+    ((GsCommandHeader*) header)->type = GS_COMMAND_NONE;
+    list->count -= 1;
+    list->eliminated += 1;
 }
 
-void gs_destroy_config(GsConfig *config) {
-    GS_ASSERT(config != NULL);
-    GS_ASSERT(active_config == NULL || active_config != config);
+static GsResourceId gs_pipeline_program_id(const GsResourceId pipeline_id) {
+    if (pipeline_id == GS_INVALID_RESOURCE_ID) {
+        return GS_INVALID_RESOURCE_ID;
+    }
 
-    GS_FREE(config);
+    const GsPipeline *pipeline = gs_get_resource(pipeline_id, GS_RESOURCE_TYPE_PIPELINE);
+    return pipeline->program != NULL ? pipeline->program->id : GS_INVALID_RESOURCE_ID;
 }
 
-GsBackend *gs_create_backend(const GsBackendType type) {
-    switch (type) {
-        case GS_BACKEND_OPENGL:
-            return gs_opengl_create();
-        case GS_BACKEND_NOOP:
-            return gs_noop_create();
-        default:
-            return NULL;
-            printf("Unknown backend type: %d\n", type);
+// Returns GS_TRUE when update overwrites everything earlier wrote, both being updates of the same buffer or texture face.
+static GS_BOOL gs_update_replaces(const GsCommandHeader *update, const GsCommandHeader *earlier) {
+    if (update->type != earlier->type) {
+        return GS_FALSE;
     }
-}
 
-void gs_destroy_backend(GsBackend *backend) {
-    GS_ASSERT(backend != NULL);
-    GS_ASSERT(active_config == NULL || active_config->backend != backend);
+    if (update->type == GS_COMMAND_UPDATE_BUFFER) {
+        const GsUpdateBufferCommand *cmd = GS_COMMAND_DATA(update, GsUpdateBufferCommand);
+        return !cmd->partial && cmd->buffer == GS_COMMAND_DATA(earlier, GsUpdateBufferCommand)->buffer;
+    }
 
-    GS_FREE(backend);
+    const GsUpdateTextureCommand *cmd = GS_COMMAND_DATA(update, GsUpdateTextureCommand);
+    const GsUpdateTextureCommand *other = GS_COMMAND_DATA(earlier, GsUpdateTextureCommand);
+    return cmd->texture == other->texture && cmd->face == other->face;
 }
 
-GsBackendType gs_get_optimal_backend_type() {
-    return GS_BACKEND_OPENGL;
-}
+// Drops binds that repeat the current state or are replaced before anything uses them, and uniform writes that
+// are overwritten before the next draw. Binds still pending at the end of the list are kept, later lists inherit them.
+static void gs_optimize_command_list(GsCommandList *list) {
+    GsBindingTracker tracker;
+    GS_MEMSET(&tracker, 0, sizeof(GsBindingTracker));
 
-void gs_shutdown() {
-    GS_ASSERT(active_config != NULL);
-    GS_ASSERT(active_config->backend != NULL);
+    GsBindingState consumed; // state as of the last draw or barrier
+    GS_MEMSET(&consumed, 0, sizeof(GsBindingState));
 
-    active_config->backend->shutdown(active_config->backend);
-    active_config = NULL;
-}
+    const GsCommandHeader *pending[GS_BINDING_COUNT] = { NULL }; // binds nothing has used yet
 
-GsPipeline *gs_create_pipeline() {
-    GsPipeline *pipeline = GS_ALLOC(GsPipeline);
-    pipeline->layout = NULL;
-    pipeline->program = NULL;
-    pipeline->blend_dst = GS_BLEND_FACTOR_ONE;
-    pipeline->blend_src = GS_BLEND_FACTOR_ZERO;
-    pipeline->blend_op = GS_BLEND_OP_ADD;
-    pipeline->blend_dst_alpha = GS_BLEND_FACTOR_ONE;
-    pipeline->blend_src_alpha = GS_BLEND_FACTOR_ZERO;
-    pipeline->blend_op_alpha = GS_BLEND_OP_ADD;
-    pipeline->blend_enabled = GS_FALSE;
-    pipeline->depth_test = GS_FALSE;
-    pipeline->depth_write = GS_TRUE;
-    pipeline->depth_func = GS_DEPTH_FUNC_LESS;
-    pipeline->stencil_test = GS_FALSE;
-    pipeline->msaa_samples = 0; // disabled
-    pipeline->cull_face = GS_FALSE;
-    pipeline->cull_front = GS_WINDING_DIRECTION_CCW;
-    pipeline->primitive_type = GS_PRIMITIVE_TRIANGLES;
+    const GsCommandHeader *uniforms[32]; // uniform writes since the last draw, all to uniform_program
+    int uniform_count = 0;
+    GsResourceId uniform_program = GS_INVALID_RESOURCE_ID;
 
-    return pipeline;
-}
+    const GsCommandHeader *updates[32]; // resource updates nothing has read since
+    int update_count = 0;
 
-void gs_pipeline_set_layout(GsPipeline *pipeline, GsVtxLayout *layout) {
-    GS_ASSERT(pipeline != NULL);
-    GS_ASSERT(layout != NULL);
+    GsCommandIterator iterator;
+    gs_command_list_iter_begin(list, &iterator);
 
-    pipeline->layout = layout;
-}
+    const GsCommandHeader *header;
+    while ((header = gs_command_list_iter_next(&iterator)) != NULL) {
+        const GsCommandType type = (GsCommandType) header->type;
 
-void gs_destroy_pipeline(GsPipeline *pipeline) {
-    GS_ASSERT(pipeline != NULL);
-    GS_FREE(pipeline);
-}
+        if (type == GS_COMMAND_UPDATE_BUFFER || type == GS_COMMAND_UPDATE_TEXTURE) {
+            // updates leave the requested bindings alone, so they neither use nor reset pending binds
+            for (int i = 0; i < update_count; i++) {
+                if (gs_update_replaces(header, updates[i])) {
+                    gs_command_list_remove(list, updates[i]);
+                    update_count -= 1;
+                    updates[i] = updates[update_count];
+                    i -= 1;
+                }
+            }
 
-GsBuffer *gs_create_buffer(const GsBufferType type, const GsBufferIntent intent) {
-    GS_ASSERT(active_config != NULL);
-    GS_ASSERT(active_config->backend != NULL);
+            if (update_count < GS_TABLE_SIZE(updates)) {
+                updates[update_count] = header;
+                update_count += 1;
+            }
 
-    GsBuffer *buffer = GS_ALLOC(GsBuffer);
-    buffer->type = type;
-    buffer->intent = intent;
-    buffer->handle = NULL;
-    buffer->size = 0;
+            continue;
+        }
 
-    active_config->backend->create_buffer_handle(buffer);
+        GsResourceId id;
+        const int slot = gs_binding_slot(header, &id);
 
-    return buffer;
-}
+        if (slot >= 0) {
+            if (pending[slot] != NULL && tracker.current.slots[slot] == id) {
+                gs_command_list_remove(list, header);
+                continue;
+            }
 
-void gs_destroy_buffer(GsBuffer *buffer) {
-    GS_ASSERT(buffer != NULL);
-    GS_ASSERT(active_config != NULL);
-    GS_ASSERT(active_config->backend != NULL);
+            if (pending[slot] != NULL) {
+                gs_command_list_remove(list, pending[slot]);
+                pending[slot] = NULL;
+            }
 
-    active_config->backend->destroy_buffer_handle(buffer);
-    GS_FREE(buffer);
-}
+            tracker.current.slots[slot] = id;
 
-void gs_buffer_set_data(GsBuffer *buffer, void *data, int size) {
-    GS_ASSERT(buffer != NULL);
-    GS_ASSERT(data != NULL);
-    GS_ASSERT(size > 0);
-    GS_ASSERT(active_config != NULL);
-    GS_ASSERT(active_config->backend != NULL);
+            if (id == consumed.slots[slot]) {
+                gs_command_list_remove(list, header);
+            } else {
+                pending[slot] = header;
+            }
 
-    active_config->backend->set_buffer_data(buffer, data, size);
-}
+            continue;
+        }
 
-void gs_buffer_set_partial_data(GsBuffer *buffer, void *data, int size, int offset) {
-    GS_ASSERT(buffer != NULL);
-    GS_ASSERT(data != NULL);
-    GS_ASSERT(size > 0);
-    GS_ASSERT(offset >= 0);
-    GS_ASSERT(active_config != NULL);
-    GS_ASSERT(active_config->backend != NULL);
+        if (gs_is_uniform_command(type)) {
+            // uniforms are applied to the program of the current pipeline right away
+            consumed.slots[GS_BINDING_PIPELINE] = tracker.current.slots[GS_BINDING_PIPELINE];
+            pending[GS_BINDING_PIPELINE] = NULL;
+
+            const GsResourceId program = gs_pipeline_program_id(tracker.current.slots[GS_BINDING_PIPELINE]);
+            if (program != uniform_program || program == GS_INVALID_RESOURCE_ID) {
+                uniform_count = 0;
+                uniform_program = program;
+            }
+
+            if (program == GS_INVALID_RESOURCE_ID) {
+                continue;
+            }
+
+            GS_BOOL replaced = GS_FALSE;
+            for (int i = 0; i < uniform_count; i++) {
+                if (gs_uniform_replaces(header, uniforms[i])) {
+                    gs_command_list_remove(list, uniforms[i]);
+                    uniforms[i] = header;
+                    replaced = GS_TRUE;
+                    break;
+                }
+            }
+
+            if (!replaced && uniform_count < GS_TABLE_SIZE(uniforms)) {
+                uniforms[uniform_count] = header;
+                uniform_count += 1;
+            }
+
+            continue;
+        }
 
-    active_config->backend->set_buffer_partial_data(buffer, data, size, offset);
-}
+        if (type == GS_COMMAND_END_PASS && tracker.depth > 0) {
+            // the pass restores textures unconditionally and everything else when it was bound before the pass
+            const GsBindingState *restored = &tracker.stack[tracker.depth - 1];
 
-void gs_destroy_unmanaged_buffer_data(GsUnmanagedBufferData *data) {
-    GS_ASSERT(data != NULL);
-    GS_FREE(data->data);
-    GS_FREE(data);
-}
+            for (int i = 0; i < GS_BINDING_COUNT; i++) {
+                if (pending[i] != NULL && (i >= GS_BINDING_TEXTURE || restored->slots[i] != GS_INVALID_RESOURCE_ID)) {
+                    gs_command_list_remove(list, pending[i]);
+                    pending[i] = NULL;
+                }
+            }
+        }
 
-GsCommandList *gs_create_command_list() {
-    GsCommandList *list = GS_ALLOC(GsCommandList);
-    list->count = 0;
-    list->pipeline = NULL;
-    list->alloc_data = GS_MALLOC(GS_COMMAND_LIST_DATA_SIZE);
-    list->alloc_offset = 0;
+        // draws and barriers use every pending bind
+        for (int i = 0; i < GS_BINDING_COUNT; i++) {
+            pending[i] = NULL;
+        }
 
-    return list;
-}
+        uniform_count = 0;
+        update_count = 0;
 
-void gs_command_list_alloc_reset(GsCommandList *list) {
-    GS_ASSERT(list != NULL);
-    list->alloc_offset = 0;
+        if (!gs_is_draw_command(type)) {
+            gs_binding_tracker_barrier(&tracker, header);
+        }
+
+        consumed = tracker.current;
+    }
 }
 
-void* gs_command_list_alloc(GsCommandList *list, int size) {
+void gs_command_list_begin(GsCommandList *list) {
     GS_ASSERT(list != NULL);
-    GS_ASSERT(size > 0);
-    GS_ASSERT(list->alloc_offset + size <= GS_COMMAND_LIST_DATA_SIZE);
+    GS_ASSERT(!atomic_load_explicit(&list->queued, memory_order_acquire));
+    GS_ASSERT(list->sealed == GS_FALSE); // bundles are immutable once ended
+    gs_command_list_clear(list);
 
-    void *data = list->alloc_data + list->alloc_offset;
-    list->alloc_offset += size;
+    if (list->sorter != NULL) {
+        GsCommandSorter *sorter = list->sorter;
+        sorter->layer = 0;
+        sorter->depth = 0.0f;
+        sorter->pipeline = GS_INVALID_RESOURCE_ID;
+        sorter->program = GS_INVALID_RESOURCE_ID;
+        sorter->texture = GS_INVALID_RESOURCE_ID;
+        sorter->translucent = GS_FALSE;
+        sorter->key_count = 0;
+    }
+}
 
-    return data;
+// Bundles must be self-contained: they may not open or close render passes and every draw
+// needs the pipeline and buffers it uses to be bound inside the bundle itself.
+static void gs_validate_bundle(const GsCommandList *bundle) {
+    GS_BOOL has_pipeline = GS_FALSE;
+    GS_BOOL has_vertex_buffer = GS_FALSE;
+    GS_BOOL has_index_buffer = GS_FALSE;
+    GS_BOOL has_instance_buffer = GS_FALSE;
+
+    GsCommandIterator iterator;
+    gs_command_list_iter_begin(bundle, &iterator);
+
+    const GsCommandHeader *header;
+    while ((header = gs_command_list_iter_next(&iterator)) != NULL) {
+        GS_ASSERT(header->type != GS_COMMAND_BEGIN_PASS && header->type != GS_COMMAND_END_PASS);
+
+        switch (header->type) {
+            case GS_COMMAND_USE_PIPELINE:
+                has_pipeline = GS_TRUE;
+                break;
+            case GS_COMMAND_USE_BUFFER: {
+                const GsBuffer *buffer = gs_get_resource(GS_COMMAND_DATA(header, GsUseBufferCommand)->buffer, GS_RESOURCE_TYPE_BUFFER);
+                if (buffer->type == GS_BUFFER_TYPE_VERTEX) {
+                    has_vertex_buffer = GS_TRUE;
+                } else {
+                    has_index_buffer = GS_TRUE;
+                }
+                break;
+            }
+            case GS_COMMAND_USE_INSTANCE_BUFFER:
+                has_instance_buffer = GS_TRUE;
+                break;
+            case GS_COMMAND_DRAW_ARRAYS:
+                GS_ASSERT(has_pipeline && has_vertex_buffer);
+                break;
+            case GS_COMMAND_DRAW_INDEXED:
+                GS_ASSERT(has_pipeline && has_vertex_buffer && has_index_buffer);
+                break;
+            case GS_COMMAND_DRAW_ARRAYS_INSTANCED:
+                GS_ASSERT(has_pipeline && has_vertex_buffer && has_instance_buffer);
+                break;
+            case GS_COMMAND_DRAW_INDEXED_INSTANCED:
+                GS_ASSERT(has_pipeline && has_vertex_buffer && has_index_buffer && has_instance_buffer);
+                break;
+            case GS_COMMAND_DRAW_INDIRECT:
+            case GS_COMMAND_MULTI_DRAW_INDIRECT:
+                GS_ASSERT(has_pipeline && has_vertex_buffer);
+                GS_ASSERT(has_index_buffer || !GS_COMMAND_DATA(header, GsDrawIndirectCommand)->indexed);
+                break;
+            case GS_COMMAND_EXECUTE_BUNDLE: {
+                const GsCommandList *nested = gs_get_resource(GS_COMMAND_DATA(header, GsExecuteBundleCommand)->bundle, GS_RESOURCE_TYPE_BUNDLE);
+                GS_ASSERT(nested->sealed);
+                break;
+            }
+            default:
+                break;
+        }
+    }
 }
 
-void gs_destroy_command_list(GsCommandList *list) {
-    GS_ASSERT(list != NULL);
-    gs_command_list_clear(list); // Free any remaining data before freeing the list itself.
-    GS_FREE(list->alloc_data);
-    GS_FREE(list);
+static void gs_op_create_bundle(GsRenderOp *op) {
+    active_config->backend->create_bundle_handle(op->resource);
 }
 
-void gs_command_list_begin(GsCommandList *list) {
+void gs_command_list_end(GsCommandList *list) {
     GS_ASSERT(list != NULL);
-    gs_command_list_clear(list);
+
+    if (list->sorter != NULL && list->count > 0) {
+        gs_sort_command_list(list);
+    }
+
+    gs_optimize_command_list(list);
+
+    if (list->bundle) {
+        GS_ASSERT(list->sealed == GS_FALSE);
+        GS_ASSERT(active_config != NULL);
+        GS_ASSERT(active_config->backend != NULL);
+
+        gs_validate_bundle(list);
+
+        // let the backend pre-resolve the bundle once instead of on every execution
+        GsRenderOp op = { .func = gs_op_create_bundle, .resource = list };
+        gs_render_submit(&op);
+        list->sealed = GS_TRUE;
+    }
 }
 
-void gs_command_list_end(GsCommandList *list) {
-    // TODO: Do any validation or processing here.
+void gs_command_list_set_order(GsCommandList *list, const uint32_t key) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(!atomic_load_explicit(&list->queued, memory_order_acquire));
+
+    list->order_key = key;
 }
 
 void gs_command_list_submit(GsCommandList *list) {
     GS_ASSERT(list != NULL);
     GS_ASSERT(active_config != NULL);
-    GS_ASSERT(active_config->command_list_count < GS_MAX_COMMAND_SUBMISSIONS);
+    GS_ASSERT(!atomic_load_explicit(&list->queued, memory_order_acquire));
+    GS_ASSERT(list->bundle == GS_FALSE); // bundles run through gs_execute_bundle
+
+    // safe to call from any thread, the list itself must not be touched again until the frame is done
+    atomic_store_explicit(&list->queued, GS_TRUE, memory_order_release);
+    list->submit_sequence = atomic_fetch_add_explicit(&submission_sequence, 1, memory_order_relaxed);
+
+    GsCommandList *head = atomic_load_explicit(&submission_head, memory_order_relaxed);
+    do {
+        list->next_submission = head;
+    } while (!atomic_compare_exchange_weak_explicit(&submission_head, &head, list, memory_order_release, memory_order_relaxed));
+}
+
+static int gs_compare_submissions(const void *a, const void *b) {
+    const GsCommandList *list_a = *(const GsCommandList**)a;
+    const GsCommandList *list_b = *(const GsCommandList**)b;
+
+    if (list_a->order_key != list_b->order_key) {
+        return list_a->order_key < list_b->order_key ? -1 : 1;
+    }
+
+    if (list_a->submit_sequence != list_b->submit_sequence) {
+        return list_a->submit_sequence < list_b->submit_sequence ? -1 : 1;
+    }
+
+    return 0;
+}
+
+// Takes every list submitted so far and sorts them into execution order.
+static int gs_drain_submissions(GsConfig *config) {
+    GsCommandList *list = atomic_exchange_explicit(&submission_head, NULL, memory_order_acquire);
+
+    int count = 0;
+    while (list != NULL) {
+        if (count == config->frame_list_capacity) {
+            const int capacity = config->frame_list_capacity > 0 ? config->frame_list_capacity * 2 : 64;
+
+            GsCommandList **lists = (GsCommandList**)GS_REALLOC(config->frame_lists, sizeof(GsCommandList*) * capacity);
+            GS_ASSERT(lists != NULL);
 
-    active_config->command_lists[active_config->command_list_count] = list;
-    active_config->command_list_count += 1;
+            config->frame_lists = lists;
+            config->frame_list_capacity = capacity;
+        }
+
+        config->frame_lists[count] = list;
+        count += 1;
+
+        GsCommandList *next = list->next_submission;
+        list->next_submission = NULL;
+        list = next;
+    }
+
+    if (count > 1) {
+        qsort(config->frame_lists, count, sizeof(GsCommandList*), gs_compare_submissions);
+    }
+
+    return count;
+}
+
+// Hands drained lists back to their owners, they may be recorded again after this.
+static void gs_release_submissions(GsConfig *config, const int count) {
+    for (int i = 0; i < count; i++) {
+        atomic_store_explicit(&config->frame_lists[i]->queued, GS_FALSE, memory_order_release);
+    }
 }
 
-void gs_handle_internal_command(const GsCommandListItem item) {
-    GS_LOG("Genesis unhandled command type: %d\n", item.type);
+void gs_handle_internal_command(const GsCommandHeader *header) {
+    GS_LOG("Genesis unhandled command type: %d\n", header->type);
     // TODO: Implement any internal commands here.
 }
 
+static void gs_op_submit_frame(GsRenderOp *op) {
+    GsCommandList **lists = op->data;
+    for (int i = 0; i < op->size; i++) {
+        active_config->backend->submit(active_config->backend, lists[i]);
+    }
+}
+
 void gs_frame() {
     GS_ASSERT(active_config != NULL);
     GS_ASSERT(active_config->backend != NULL);
 
-    for (int i = 0; i < active_config->command_list_count; i++) {
-        active_config->backend->submit(active_config->backend, active_config->command_lists[i]);
+    const int count = gs_drain_submissions(active_config);
+
+    // queued ahead of the frame and of the capture, so both see this frame's uniform and stream data
+    gs_flush_uniform_ring(active_config, GS_TRUE);
+    gs_flush_stream_rings(active_config, GS_TRUE);
+
+    if (gs_capture_pending()) {
+        gs_capture_frame(active_config->frame_lists, count);
+    }
+
+    gs_capture_shadow_updates(active_config->frame_lists, count);
+
+    // keep the API thread a bounded number of frames ahead of the render thread
+    const uint64_t completed = render_frame_fences[render_frame_index];
+    gs_render_wait(completed);
+    gs_poll_texture_reads(active_config, completed);
+    gs_issue_texture_uploads(active_config, completed);
+    gs_retire_stream_rings(active_config, completed);
+
+    GsRenderOp op = { .func = gs_op_submit_frame, .size = count };
+    gs_render_set_data(&op, active_config->frame_lists, (int) sizeof(GsCommandList*) * count);
+    const uint64_t fence = gs_render_submit(&op);
+    gs_fence_stream_rings(active_config);
+
+    render_frame_fences[render_frame_index] = fence;
+    render_frame_index = (render_frame_index + 1) % GS_RENDER_MAX_FRAMES_IN_FLIGHT;
+
+    for (int i = 0; i < count; i++) {
+        active_config->frame_lists[i]->fence = fence;
     }
 
-    active_config->command_list_count = 0;
+    gs_release_submissions(active_config, count);
+
+    if (active_config->frame_allocator != NULL) {
+        gs_frame_allocator_advance(active_config->frame_allocator, fence);
+    }
 }
 
 void gs_discard_frame() {
     GS_ASSERT(active_config != NULL);
-    active_config->command_list_count = 0;
+
+    const int count = gs_drain_submissions(active_config);
+    gs_release_submissions(active_config, count);
+    gs_flush_uniform_ring(active_config, GS_FALSE);
+    gs_flush_stream_rings(active_config, GS_FALSE);
+    gs_fence_stream_rings(active_config);
+
+    if (active_config->frame_allocator != NULL) {
+        gs_frame_allocator_advance(active_config->frame_allocator, gs_render_fence());
+    }
 }
 
 void gs_command_list_add(GsCommandList *list, const GsCommandType type, void *data, const int size) {
     GS_ASSERT(list != NULL);
-    GS_ASSERT(list->count < GS_MAX_COMMAND_LIST_ITEMS);
-
-    GsCommandListItem item;
-    item.data = data;
-    item.size = size;
-    item.type = type;
+    GS_ASSERT(size == 0 || data != NULL);
 
-    list->items[list->count] = item;
-    list->count += 1;
+    void *payload = gs_command_list_push(list, type, size);
+    if (size > 0) {
+        memcpy(payload, data, size);
+    }
 }
 
 void gs_command_list_clear(GsCommandList *list) {
     GS_ASSERT(list != NULL);
+    GS_ASSERT(!atomic_load_explicit(&list->queued, memory_order_acquire));
+
+    gs_render_wait(list->fence);
+
+    const int used = list->stream.used + list->data.used;
+    if (used > list->high_water_bytes) {
+        list->high_water_bytes = used;
+    }
 
-    for (int i = 0; i < list->count; i++) {
-        list->items[i].data = NULL;
+    if (list->count > list->high_water_commands) {
+        list->high_water_commands = list->count;
     }
 
     list->count = 0;
-    list->alloc_offset = 0;
+    list->eliminated = 0;
+    gs_command_arena_reset(&list->stream);
+    gs_command_arena_reset(&list->data);
 }
 
 void gs_clear(GsCommandList *list, const GsClearFlags flags, const float r, const float g, const float b, const float a) {
     GS_ASSERT(list != NULL);
 
-    GsClearCommand *data = GS_CMD_ALLOC(list, GsClearCommand);
+    GsClearCommand *data = GS_CMD_PUSH(list, GS_COMMAND_CLEAR, GsClearCommand);
     data->r = r;
     data->g = g;
     data->b = b;
     data->a = a;
     data->flags = flags;
-
-    gs_command_list_add(list, GS_COMMAND_CLEAR, data, sizeof(GsClearCommand));
 }
 
 void gs_set_viewport(GsCommandList *list, const int x, const int y, const int w, const int h) {
     GS_ASSERT(list != NULL);
 
-    GsViewportCommand *data = GS_CMD_ALLOC(list, GsViewportCommand);
+    GsViewportCommand *data = GS_CMD_PUSH(list, GS_COMMAND_SET_VIEWPORT, GsViewportCommand);
     data->x = x;
     data->y = y;
     data->width = w;
     data->height = h;
-
-    gs_command_list_add(list, GS_COMMAND_SET_VIEWPORT, data, sizeof(GsViewportCommand));
 }
 
 void gs_use_pipeline(GsCommandList *list, GsPipeline *pipeline) {
     GS_ASSERT(list != NULL);
     GS_ASSERT(pipeline != NULL);
 
-    GsPipelineCommand *data = GS_CMD_ALLOC(list, GsPipelineCommand);
-    data->pipeline = pipeline;
+    GsPipelineCommand *data = GS_CMD_PUSH(list, GS_COMMAND_USE_PIPELINE, GsPipelineCommand);
+    data->pipeline = pipeline->id;
 
-    gs_command_list_add(list, GS_COMMAND_USE_PIPELINE, data, sizeof(GsPipelineCommand));
+    if (list->sorter != NULL) {
+        list->sorter->pipeline = pipeline->id;
+        list->sorter->program = pipeline->program != NULL ? pipeline->program->id : GS_INVALID_RESOURCE_ID;
+        list->sorter->translucent = pipeline->blend_enabled;
+    }
 }
 
 void gs_use_buffer(GsCommandList *list, GsBuffer *buffer) {
     GS_ASSERT(list != NULL);
     GS_ASSERT(buffer != NULL);
+    GS_ASSERT(buffer->type != GS_BUFFER_TYPE_UNIFORM); // bound with gs_use_uniform_block
+    GS_ASSERT(buffer->type != GS_BUFFER_TYPE_INDIRECT); // passed to the indirect draws
+
+    GsUseBufferCommand *data = GS_CMD_PUSH(list, GS_COMMAND_USE_BUFFER, GsUseBufferCommand);
+    data->buffer = buffer->id;
+}
+
+void gs_use_instance_buffer(GsCommandList *list, GsBuffer *buffer) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(buffer != NULL);
+    GS_ASSERT(buffer->type == GS_BUFFER_TYPE_VERTEX);
+
+    GsUseBufferCommand *data = GS_CMD_PUSH(list, GS_COMMAND_USE_INSTANCE_BUFFER, GsUseBufferCommand);
+    data->buffer = buffer->id;
+}
 
-    GsUseBufferCommand *data = GS_CMD_ALLOC(list, GsUseBufferCommand);
-    data->buffer = buffer;
+void gs_use_vertex_stream(GsCommandList *list, const int stream, GsBuffer *buffer) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(buffer != NULL);
+    GS_ASSERT(buffer->type == GS_BUFFER_TYPE_VERTEX);
+    GS_ASSERT(stream > 0 && stream < GS_MAX_VERTEX_STREAMS); // stream 0 is bound with gs_use_buffer
 
-    gs_command_list_add(list, GS_COMMAND_USE_BUFFER, data, sizeof(GsUseBufferCommand));
+    GsUseVertexStreamCommand *data = GS_CMD_PUSH(list, GS_COMMAND_USE_VERTEX_STREAM, GsUseVertexStreamCommand);
+    data->buffer = buffer->id;
+    data->stream = stream;
 }
 
 void gs_use_texture(GsCommandList *list, GsTexture *texture, const int slot) {
@@ -391,71 +3228,184 @@ void gs_use_texture(GsCommandList *list, GsTexture *texture, const int slot) {
     GS_ASSERT(texture != NULL);
     GS_ASSERT_WARN(texture->width <= 4096 && texture->height <= 4096, "Texture size exceeds 4096x4096. This may cause issues on some platforms (especially mobile).");
 
-    GsTextureCommand *data = GS_CMD_ALLOC(list, GsTextureCommand);
-    data->texture = texture;
+    GsTextureCommand *data = GS_CMD_PUSH(list, GS_COMMAND_USE_TEXTURE, GsTextureCommand);
+    data->texture = texture->id;
     data->slot = slot;
 
-    gs_command_list_add(list, GS_COMMAND_USE_TEXTURE, data, sizeof(GsTextureCommand));
+    if (list->sorter != NULL && slot == 0) {
+        list->sorter->texture = texture->id;
+    }
+}
+
+void gs_use_uniform_block(GsCommandList *list, const int binding, GsBuffer *buffer, const int offset, const int size) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(buffer != NULL);
+    GS_ASSERT(buffer->type == GS_BUFFER_TYPE_UNIFORM);
+    GS_ASSERT(binding >= 0 && binding < GS_MAX_UNIFORM_BLOCK_BINDINGS);
+    GS_ASSERT(offset >= 0 && offset % GS_UNIFORM_BUFFER_ALIGNMENT == 0);
+    GS_ASSERT(size > 0);
+
+    GsUniformBlockCommand *data = GS_CMD_PUSH(list, GS_COMMAND_USE_UNIFORM_BLOCK, GsUniformBlockCommand);
+    data->binding = binding;
+    data->buffer = buffer->id;
+    data->offset = offset;
+    data->size = size;
+}
+
+void gs_use_uniform_data(GsCommandList *list, const int binding, const void *data, const int size) {
+    const int offset = gs_push_uniform_data(data, size);
+    gs_use_uniform_block(list, binding, active_config->uniform_ring->buffer, offset, size);
+}
+
+void gs_begin_render_pass(GsCommandList *list, GsRenderPass *pass) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(pass != NULL);
+
+    GsBeginRenderPassCommand *data = GS_CMD_PUSH(list, GS_COMMAND_BEGIN_PASS, GsBeginRenderPassCommand);
+    data->pass = pass->id;
+}
+
+void gs_end_render_pass(GsCommandList *list) {
+    GS_ASSERT(list != NULL);
+
+    GsEndRenderPassCommand *data = GS_CMD_PUSH(list, GS_COMMAND_END_PASS, GsEndRenderPassCommand);
+    data->dummy = 0;
+}
+
+void gs_execute_bundle(GsCommandList *list, GsCommandList *bundle) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(bundle != NULL);
+    GS_ASSERT(bundle->bundle && bundle->sealed);
+    GS_ASSERT(list != bundle);
+
+    GsExecuteBundleCommand *data = GS_CMD_PUSH(list, GS_COMMAND_EXECUTE_BUNDLE, GsExecuteBundleCommand);
+    data->bundle = bundle->id;
+}
+
+void gs_draw_arrays(GsCommandList *list, const int start, const int count) {
+    GS_ASSERT(list != NULL);
+
+    GsDrawArraysCommand *data = GS_CMD_PUSH(list, GS_COMMAND_DRAW_ARRAYS, GsDrawArraysCommand);
+    data->start = start;
+    data->count = count;
+
+    if (list->sorter != NULL) {
+        gs_sort_record_draw(list);
+    }
+}
+
+void gs_draw_indexed(GsCommandList *list, const int count) {
+    gs_draw_indexed_base_vertex(list, count, 0, 0);
 }
 
-void gs_begin_render_pass(GsCommandList *list, GsRenderPass *pass) {
+void gs_draw_indexed_base_vertex(GsCommandList *list, const int count, const int first_index, const int base_vertex) {
     GS_ASSERT(list != NULL);
-    GS_ASSERT(pass != NULL);
+    GS_ASSERT(first_index >= 0);
 
-    GsBeginRenderPassCommand *data = GS_CMD_ALLOC(list, GsBeginRenderPassCommand);
-    data->pass = pass;
+    GsDrawIndexedCommand *data = GS_CMD_PUSH(list, GS_COMMAND_DRAW_INDEXED, GsDrawIndexedCommand);
+    data->count = count;
+    data->first_index = first_index;
+    data->base_vertex = base_vertex;
 
-    gs_command_list_add(list, GS_COMMAND_BEGIN_PASS, data, sizeof(GsBeginRenderPassCommand));
+    if (list->sorter != NULL) {
+        gs_sort_record_draw(list);
+    }
 }
 
-void gs_end_render_pass(GsCommandList *list) {
+void gs_draw_arrays_instanced(GsCommandList *list, const int start, const int count, const int instances) {
     GS_ASSERT(list != NULL);
+    GS_ASSERT(instances >= 0);
 
-    GsEndRenderPassCommand *data = GS_CMD_ALLOC(list, GsEndRenderPassCommand);
-    data->dummy = 0;
+    GsDrawArraysInstancedCommand *data = GS_CMD_PUSH(list, GS_COMMAND_DRAW_ARRAYS_INSTANCED, GsDrawArraysInstancedCommand);
+    data->start = start;
+    data->count = count;
+    data->instances = instances;
 
-    gs_command_list_add(list, GS_COMMAND_END_PASS, data, sizeof(GsEndRenderPassCommand));
+    if (list->sorter != NULL) {
+        gs_sort_record_draw(list);
+    }
 }
 
-void gs_draw_arrays(GsCommandList *list, const int start, const int count) {
+void gs_draw_indexed_instanced(GsCommandList *list, const int count, const int instances) {
+    gs_draw_indexed_instanced_base_vertex(list, count, 0, 0, instances);
+}
+
+void gs_draw_indexed_instanced_base_vertex(GsCommandList *list, const int count, const int first_index, const int base_vertex, const int instances) {
     GS_ASSERT(list != NULL);
+    GS_ASSERT(first_index >= 0);
+    GS_ASSERT(instances >= 0);
 
-    GsDrawArraysCommand *data = GS_CMD_ALLOC(list, GsDrawArraysCommand);
-    data->start = start;
+    GsDrawIndexedInstancedCommand *data = GS_CMD_PUSH(list, GS_COMMAND_DRAW_INDEXED_INSTANCED, GsDrawIndexedInstancedCommand);
     data->count = count;
+    data->instances = instances;
+    data->first_index = first_index;
+    data->base_vertex = base_vertex;
 
-    gs_command_list_add(list, GS_COMMAND_DRAW_ARRAYS, data, sizeof(GsDrawArraysCommand));
+    if (list->sorter != NULL) {
+        gs_sort_record_draw(list);
+    }
 }
 
-void gs_draw_indexed(GsCommandList *list, const int count) {
+static void gs_draw_indirect(GsCommandList *list, const GsCommandType type, GsBuffer *buffer, const int offset, const int draw_count, const int stride, const GS_BOOL indexed) {
     GS_ASSERT(list != NULL);
+    GS_ASSERT(buffer != NULL);
+    GS_ASSERT(buffer->type == GS_BUFFER_TYPE_INDIRECT);
+    GS_ASSERT(offset >= 0 && offset % 4 == 0);
+    GS_ASSERT(draw_count >= 0);
+    GS_ASSERT(stride == 0 || (stride % 4 == 0 && stride >= (int)(indexed ? sizeof(GsDrawIndexedIndirectArgs) : sizeof(GsDrawArraysIndirectArgs))));
+
+    GsDrawIndirectCommand *data = GS_CMD_PUSH(list, type, GsDrawIndirectCommand);
+    data->buffer = buffer->id;
+    data->offset = offset;
+    data->draw_count = draw_count;
+    data->stride = stride;
+    data->indexed = indexed;
+
+    if (list->sorter != NULL) {
+        gs_sort_record_draw(list);
+    }
+}
 
-    GsDrawIndexedCommand *data = GS_CMD_ALLOC(list, GsDrawIndexedCommand);
-    data->count = count;
+void gs_draw_arrays_indirect(GsCommandList *list, GsBuffer *buffer, const int offset) {
+    gs_draw_indirect(list, GS_COMMAND_DRAW_INDIRECT, buffer, offset, 1, 0, GS_FALSE);
+}
+
+void gs_draw_indexed_indirect(GsCommandList *list, GsBuffer *buffer, const int offset) {
+    gs_draw_indirect(list, GS_COMMAND_DRAW_INDIRECT, buffer, offset, 1, 0, GS_TRUE);
+}
 
-    gs_command_list_add(list, GS_COMMAND_DRAW_INDEXED, data, sizeof(GsDrawIndexedCommand));
+void gs_multi_draw_arrays_indirect(GsCommandList *list, GsBuffer *buffer, const int offset, const int draw_count, const int stride) {
+    gs_draw_indirect(list, GS_COMMAND_MULTI_DRAW_INDIRECT, buffer, offset, draw_count, stride, GS_FALSE);
+}
+
+void gs_multi_draw_indexed_indirect(GsCommandList *list, GsBuffer *buffer, const int offset, const int draw_count, const int stride) {
+    gs_draw_indirect(list, GS_COMMAND_MULTI_DRAW_INDIRECT, buffer, offset, draw_count, stride, GS_TRUE);
 }
 
 void gs_set_scissor(GsCommandList *list, const int x, const int y, const int w, const int h) {
     GS_ASSERT(list != NULL);
 
-    GsScissorCommand *data = GS_CMD_ALLOC(list, GsScissorCommand);
+    GsScissorCommand *data = GS_CMD_PUSH(list, GS_COMMAND_SET_SCISSOR, GsScissorCommand);
     data->x = x;
     data->y = y;
     data->width = w;
     data->height = h;
     data->enable = GS_TRUE;
-
-    gs_command_list_add(list, GS_COMMAND_SET_SCISSOR, data, sizeof(GsScissorCommand));
 }
 
 void gs_disable_scissor(GsCommandList *list) {
     GS_ASSERT(list != NULL);
 
-    GsScissorCommand *data = GS_CMD_ALLOC(list, GsScissorCommand);
+    GsScissorCommand *data = GS_CMD_PUSH(list, GS_COMMAND_SET_SCISSOR, GsScissorCommand);
+    data->x = 0;
+    data->y = 0;
+    data->width = 0;
+    data->height = 0;
     data->enable = GS_FALSE;
+}
 
-    gs_command_list_add(list, GS_COMMAND_SET_SCISSOR, data, sizeof(GsScissorCommand));
+static void gs_op_create_shader(GsRenderOp *op) {
+    active_config->backend->create_shader_handle(op->resource, op->data);
 }
 
 GsShader *gs_create_shader(const GsShaderType type, const char *source) {
@@ -465,20 +3415,32 @@ GsShader *gs_create_shader(const GsShaderType type, const char *source) {
     GsShader *shader = GS_ALLOC(GsShader);
     shader->type = type;
     shader->handle = NULL;
+    shader->id = gs_register_resource(shader, GS_RESOURCE_TYPE_SHADER);
 
-    active_config->backend->create_shader_handle(shader, source);
+    GsRenderOp op = { .func = gs_op_create_shader, .resource = shader };
+    gs_render_set_data(&op, source, (int) strlen(source) + 1);
+    gs_render_submit(&op);
+
+    gs_capture_shadow_shader(shader, source);
 
     return shader;
 }
 
+static void gs_op_destroy_shader(GsRenderOp *op) {
+    active_config->backend->destroy_shader_handle(op->resource);
+    gs_render_release(op);
+}
+
 void gs_destroy_shader(GsShader *shader) {
     GS_ASSERT(shader != NULL);
     GS_ASSERT(active_config != NULL);
     GS_ASSERT(active_config->backend != NULL);
 
-    active_config->backend->destroy_shader_handle(shader);
+    gs_release_resource(gs_op_destroy_shader, shader, shader->id);
+}
 
-    GS_FREE(shader);
+static void gs_op_create_framebuffer(GsRenderOp *op) {
+    active_config->backend->create_framebuffer(op->resource);
 }
 
 GsFramebuffer* gs_create_framebuffer(int width, int height) {
@@ -489,19 +3451,29 @@ GsFramebuffer* gs_create_framebuffer(int width, int height) {
     framebuffer->width = width;
     framebuffer->height = height;
     framebuffer->handle = NULL;
+    framebuffer->id = gs_register_resource(framebuffer, GS_RESOURCE_TYPE_FRAMEBUFFER);
+
+    GsRenderOp op = { .func = gs_op_create_framebuffer, .resource = framebuffer };
+    gs_render_submit(&op);
 
-    active_config->backend->create_framebuffer(framebuffer);
     return framebuffer;
 }
 
+static void gs_op_destroy_framebuffer(GsRenderOp *op) {
+    active_config->backend->destroy_framebuffer(op->resource);
+    gs_render_release(op);
+}
+
 void gs_destroy_framebuffer(GsFramebuffer *framebuffer) {
     GS_ASSERT(framebuffer != NULL);
     GS_ASSERT(active_config != NULL);
     GS_ASSERT(active_config->backend != NULL);
 
-    active_config->backend->destroy_framebuffer(framebuffer);
+    gs_release_resource(gs_op_destroy_framebuffer, framebuffer, framebuffer->id);
+}
 
-    GS_FREE(framebuffer);
+static void gs_op_framebuffer_attach_texture(GsRenderOp *op) {
+    active_config->backend->framebuffer_attach_texture(op->resource, op->target, (GsFramebufferAttachmentType) op->value);
 }
 
 void gs_framebuffer_attach_texture(GsFramebuffer *framebuffer, GsTexture *texture, GsFramebufferAttachmentType attachment) {
@@ -510,7 +3482,10 @@ void gs_framebuffer_attach_texture(GsFramebuffer *framebuffer, GsTexture *textur
     GS_ASSERT(active_config != NULL);
     GS_ASSERT(active_config->backend != NULL);
 
-    active_config->backend->framebuffer_attach_texture(framebuffer, texture, attachment);
+    GsRenderOp op = { .func = gs_op_framebuffer_attach_texture, .resource = framebuffer, .target = texture, .value = attachment };
+    gs_render_submit(&op);
+
+    gs_capture_shadow_attachment(framebuffer, texture, attachment);
 }
 
 GsProgram *gs_create_program() {
@@ -519,17 +3494,212 @@ GsProgram *gs_create_program() {
     program->fragment = NULL;
     program->completed = GS_FALSE;
     program->handle = NULL;
+    program->id = gs_register_resource(program, GS_RESOURCE_TYPE_PROGRAM);
+    program->uniforms.entries = NULL;
+    program->uniforms.capacity = 0;
+    program->uniforms.count = 0;
+    program->attributes.entries = NULL;
+    program->attributes.capacity = 0;
+    program->attributes.count = 0;
+    program->fence = 0;
 
     return program;
 }
 
+static void gs_op_get_uniform_location(GsRenderOp *op) {
+    *(GsUniformLocation*) op->result = active_config->backend->get_uniform_location(op->resource, op->data);
+}
+
+// FNV-1a, the key of the reflected variable tables. Callers can hash names once and keep the result.
+uint32_t gs_hash_name(const char *name) {
+    GS_ASSERT(name != NULL);
+
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *c = (const unsigned char*) name; *c != '\0'; c++) {
+        hash ^= *c;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static GsProgramVariable *gs_variable_table_slot(GsProgramVariableTable *table, const uint32_t hash) {
+    if (table->capacity == 0) {
+        return NULL;
+    }
+
+    const int mask = table->capacity - 1;
+    for (int i = (int)(hash & (uint32_t) mask);; i = (i + 1) & mask) {
+        GsProgramVariable *slot = &table->entries[i];
+        if (slot->name == NULL || slot->hash == hash) {
+            return slot;
+        }
+    }
+}
+
+static void gs_variable_table_insert(GsProgramVariableTable *table, const char *name, const int location, const GsVariableType type, const int count) {
+    // keep the table at most half full so probes stay short
+    if ((table->count + 1) * 2 > table->capacity) {
+        GsProgramVariableTable grown;
+        grown.capacity = table->capacity > 0 ? table->capacity * 2 : 16;
+        grown.count = table->count;
+        grown.entries = GS_ALLOC_MULTIPLE(GsProgramVariable, grown.capacity);
+        for (int i = 0; i < grown.capacity; i++) {
+            grown.entries[i].name = NULL;
+        }
+
+        for (int i = 0; i < table->capacity; i++) {
+            if (table->entries[i].name != NULL) {
+                *gs_variable_table_slot(&grown, table->entries[i].hash) = table->entries[i];
+            }
+        }
+
+        GS_FREE(table->entries);
+        *table = grown;
+    }
+
+    const uint32_t hash = gs_hash_name(name);
+    GsProgramVariable *slot = gs_variable_table_slot(table, hash);
+    if (slot->name != NULL) {
+        if (strcmp(slot->name, name) != 0) {
+            GS_LOG("Program variable %s collides with %s, looking it up by name falls back to the backend.\n", name, slot->name);
+            slot->collided = GS_TRUE;
+        }
+
+        return;
+    }
+
+    const size_t length = strlen(name) + 1;
+    slot->hash = hash;
+    slot->name = (char*)GS_MALLOC(length);
+    memcpy(slot->name, name, length);
+    slot->location = location;
+    slot->type = type;
+    slot->count = count;
+    slot->collided = GS_FALSE;
+    table->count++;
+}
+
+static void gs_variable_table_free(GsProgramVariableTable *table) {
+    for (int i = 0; i < table->capacity; i++) {
+        GS_FREE(table->entries[i].name);
+    }
+
+    GS_FREE(table->entries);
+    table->entries = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+static const GsProgramVariable *gs_variable_table_find(GsProgramVariableTable *table, const uint32_t hash) {
+    const GsProgramVariable *slot = gs_variable_table_slot(table, hash);
+    if (slot == NULL || slot->name == NULL) {
+        return NULL;
+    }
+
+    return slot;
+}
+
+// Lookup for callers that only have the hash, which cannot tell variables with the same hash apart.
+static const GsProgramVariable *gs_variable_table_find_unique(GsProgramVariableTable *table, const uint32_t hash) {
+    const GsProgramVariable *slot = gs_variable_table_find(table, hash);
+    if (slot == NULL) {
+        return NULL;
+    }
+
+    GS_ASSERT_WARN(!slot->collided, "Program variable hash is shared by several variables, look it up by name instead");
+    return slot->collided ? NULL : slot;
+}
+
+// Called by the backend while it links the program.
+void gs_program_add_uniform(GsProgram *program, const char *name, const int location, const GsVariableType type, const int count) {
+    GS_ASSERT(program != NULL);
+    GS_ASSERT(name != NULL);
+
+    gs_variable_table_insert(&program->uniforms, name, location, type, count);
+}
+
+// Called by the backend while it links the program.
+void gs_program_add_attribute(GsProgram *program, const char *name, const int location, const GsVariableType type, const int count) {
+    GS_ASSERT(program != NULL);
+    GS_ASSERT(name != NULL);
+
+    gs_variable_table_insert(&program->attributes, name, location, type, count);
+}
+
+// Returns the reflected uniform with the given name hash or NULL, never reaches the driver. NULL as well when several
+// uniforms share the hash.
+const GsProgramVariable *gs_program_find_uniform(GsProgram *program, const uint32_t hash) {
+    GS_ASSERT(program != NULL);
+
+    gs_render_wait(program->fence);
+    return gs_variable_table_find_unique(&program->uniforms, hash);
+}
+
+// Returns the reflected attribute with the given name hash or NULL, never reaches the driver. NULL as well when
+// several attributes share the hash.
+const GsProgramVariable *gs_program_find_attribute(GsProgram *program, const uint32_t hash) {
+    GS_ASSERT(program != NULL);
+
+    gs_render_wait(program->fence);
+    return gs_variable_table_find_unique(&program->attributes, hash);
+}
+
+// Location of a reflected uniform, -1 when the program has no active uniform with that name hash or the hash is
+// ambiguous, gs_get_uniform_location resolves those by name.
+GsUniformLocation gs_get_uniform_location_hashed(GsProgram *program, const uint32_t hash) {
+    const GsProgramVariable *uniform = gs_program_find_uniform(program, hash);
+    if (uniform == NULL) {
+        return -1;
+    }
+
+    gs_capture_shadow_uniform(program, uniform->name, uniform->location);
+
+    return uniform->location;
+}
+
 GsUniformLocation gs_get_uniform_location(GsProgram *program, const char *name) {
     GS_ASSERT(program != NULL);
     GS_ASSERT(name != NULL);
     GS_ASSERT(active_config != NULL);
     GS_ASSERT(active_config->backend != NULL);
 
-    return active_config->backend->get_uniform_location(program, name);
+    gs_render_wait(program->fence);
+
+    const GsProgramVariable *uniform = gs_variable_table_find(&program->uniforms, gs_hash_name(name));
+    if (uniform != NULL && strcmp(uniform->name, name) == 0) {
+        gs_capture_shadow_uniform(program, name, uniform->location);
+
+        return uniform->location;
+    }
+
+    // not reflected (array elements, unlinked programs, backends without reflection), so this waits for the render
+    // thread to catch up and asks the backend
+    GsUniformLocation location = 0;
+    GsRenderOp op = { .func = gs_op_get_uniform_location, .resource = program, .data = (void*) name, .result = &location };
+    gs_render_submit_sync(&op);
+
+    gs_capture_shadow_uniform(program, name, location);
+
+    return location;
+}
+
+static void gs_op_set_uniform_block_binding(GsRenderOp *op) {
+    active_config->backend->set_uniform_block_binding(op->resource, op->data, op->value);
+}
+
+void gs_program_set_uniform_block(GsProgram *program, const char *name, const int binding) {
+    GS_ASSERT(program != NULL);
+    GS_ASSERT(name != NULL);
+    GS_ASSERT(binding >= 0 && binding < GS_MAX_UNIFORM_BLOCK_BINDINGS);
+    GS_ASSERT(active_config != NULL);
+    GS_ASSERT(active_config->backend != NULL);
+
+    GsRenderOp op = { .func = gs_op_set_uniform_block_binding, .resource = program, .value = binding };
+    gs_render_set_data(&op, name, (int) strlen(name) + 1);
+    gs_render_submit(&op);
+
+    gs_capture_shadow_uniform_block(program, name, binding);
 }
 
 void gs_program_attach_shader(GsProgram *program, GsShader *shader) {
@@ -548,27 +3718,43 @@ void gs_program_attach_shader(GsProgram *program, GsShader *shader) {
     }
 }
 
+static void gs_op_build_program(GsRenderOp *op) {
+    active_config->backend->create_program_handle(op->resource);
+}
+
 void gs_program_build(GsProgram *program) {
     GS_ASSERT(program != NULL);
     GS_ASSERT(program->completed == GS_FALSE);
     GS_ASSERT(active_config != NULL);
     GS_ASSERT(active_config->backend != NULL);
 
-    active_config->backend->create_program_handle(program);
+    GsRenderOp op = { .func = gs_op_build_program, .resource = program };
+    program->fence = gs_render_submit(&op);
 
     program->completed = GS_TRUE;
 }
 
+static void gs_op_destroy_program(GsRenderOp *op) {
+    GsProgram *program = op->resource;
+    if (program->completed) {
+        active_config->backend->destroy_program_handle(program);
+    }
+
+    gs_variable_table_free(&program->uniforms);
+    gs_variable_table_free(&program->attributes);
+    gs_render_release(op);
+}
+
 void gs_destroy_program(GsProgram *program) {
     GS_ASSERT(program != NULL);
     GS_ASSERT(active_config != NULL);
     GS_ASSERT(active_config->backend != NULL);
 
-    if (program->completed) {
-        active_config->backend->destroy_program_handle(program);
-    }
+    gs_release_resource(gs_op_destroy_program, program, program->id);
+}
 
-    GS_FREE(program);
+static void gs_op_create_texture(GsRenderOp *op) {
+    active_config->backend->create_texture_handle(op->resource);
 }
 
 GsTexture *gs_create_texture(const int width, const int height, const GsTextureFormat format, const GsTextureWrap wrap_s, const GsTextureWrap wrap_t, const GsTextureFilter min, const GsTextureFilter mag) {
@@ -587,8 +3773,14 @@ GsTexture *gs_create_texture(const int width, const int height, const GsTextureF
     texture->type = GS_TEXTURE_TYPE_2D;
     texture->handle = NULL;
     texture->lodBias = 0.0f;
+    texture->levels = 1;
+    texture->storage = 0;
+    texture->pending_uploads = 0;
+    texture->stream = NULL;
+    texture->id = gs_register_resource(texture, GS_RESOURCE_TYPE_TEXTURE);
 
-    active_config->backend->create_texture_handle(texture);
+    GsRenderOp op = { .func = gs_op_create_texture, .resource = texture };
+    gs_render_submit(&op);
 
     return texture;
 }
@@ -608,19 +3800,134 @@ GsTexture *gs_create_cubemap(const int width, const int height, const GsTextureF
     texture->mag = mag;
     texture->type = GS_TEXTURE_TYPE_CUBEMAP;
     texture->handle = NULL;
+    texture->lodBias = 0.0f;
+    texture->levels = 1;
+    texture->storage = 0;
+    texture->pending_uploads = 0;
+    texture->stream = NULL;
+    texture->id = gs_register_resource(texture, GS_RESOURCE_TYPE_TEXTURE);
+
+    GsRenderOp op = { .func = gs_op_create_texture, .resource = texture };
+    gs_render_submit(&op);
+
+    return texture;
+}
+
+GsTexture *gs_create_streamed_texture(const int width, const int height, const GsTextureFormat format, const GsTextureWrap wrap_s, const GsTextureWrap wrap_t, const GsTextureFilter min, const GsTextureFilter mag) {
+    GS_ASSERT(width > 0 && height > 0);
+    GS_ASSERT(active_config != NULL);
+    GS_ASSERT(active_config->backend != NULL);
+
+    int levels = 1;
+    while ((width >> levels) > 0 || (height >> levels) > 0) {
+        levels += 1;
+    }
+
+    GS_ASSERT(levels <= GS_TEXTURE_MAX_LEVELS);
+
+    GsTexture *texture = GS_ALLOC(GsTexture);
+    texture->width = width;
+    texture->height = height;
+    texture->format = format;
+    texture->wrap_s = wrap_s;
+    texture->wrap_t = wrap_t;
+    texture->wrap_r = GS_TEXTURE_WRAP_REPEAT;
+    texture->min = min;
+    texture->mag = mag;
+    texture->type = GS_TEXTURE_TYPE_2D;
+    texture->handle = NULL;
+    texture->lodBias = 0.0f;
+    texture->levels = levels;
+    texture->storage = 0;
+    texture->pending_uploads = 0;
+    texture->id = gs_register_resource(texture, GS_RESOURCE_TYPE_TEXTURE);
+
+    GsTextureStream *stream = GS_ALLOC(GsTextureStream);
+    GS_ASSERT(stream != NULL);
+    GS_MEMSET(stream, 0, sizeof(GsTextureStream));
+    stream->texture = texture;
+    stream->screen_size = (float) (width > height ? width : height);
+    texture->stream = stream;
+
+    if (gs_has_capability(GS_CAPABILITY_TEXTURE_STREAMING)) {
+        stream->requested = levels;
+        stream->resident = levels;
+        stream->next = active_config->texture_streams;
+        active_config->texture_streams = stream;
+    } else {
+        // a plain mipmapped texture, every level goes up once it is given and gs_frame never looks at it
+        stream->requested = 0;
+        stream->resident = 0;
+    }
 
-    active_config->backend->create_texture_handle(texture);
+    GsRenderOp op = { .func = gs_op_create_texture, .resource = texture };
+    gs_render_submit(&op);
 
     return texture;
 }
 
+void gs_texture_set_level_data(GsTexture *texture, const int level, const void *data) {
+    GS_ASSERT(texture != NULL);
+    GS_ASSERT(texture->stream != NULL);
+    GS_ASSERT(level >= 0 && level < texture->levels);
+    GS_ASSERT(data != NULL);
+
+    GsTextureStream *stream = texture->stream;
+    const int size = gs_get_texture_level_size(texture->width, level) * gs_get_texture_level_size(texture->height, level) * gs_get_texture_format_size(texture->format);
+
+    if (stream->data[level] == NULL) {
+        stream->data[level] = GS_MALLOC(size);
+        GS_ASSERT(stream->data[level] != NULL);
+    }
+
+    memcpy(stream->data[level], data, size);
+
+    // a level already requested is replaced, the others go up once gs_frame wants them
+    if (level >= stream->requested) {
+        gs_texture_stream_upload(stream, level);
+    }
+
+    gs_capture_shadow_texture_level(texture, level, data);
+}
+
+void gs_texture_set_stream_hint(GsTexture *texture, const float screen_size, const int priority) {
+    GS_ASSERT(texture != NULL);
+    GS_ASSERT(texture->stream != NULL);
+
+    texture->stream->screen_size = screen_size;
+    texture->stream->priority = priority;
+
+    gs_capture_shadow_texture_stream(texture, screen_size, priority);
+}
+
+int gs_texture_get_resident_level(const GsTexture *texture) {
+    GS_ASSERT(texture != NULL);
+
+    return texture->stream != NULL ? texture->stream->resident : 0;
+}
+
+static void gs_op_set_texture_data(GsRenderOp *op) {
+    active_config->backend->set_texture_data(op->resource, (GsCubemapFace) op->value, op->data);
+}
+
+static void gs_texture_upload(GsTexture *texture, const GsCubemapFace face, void *data) {
+    GsRenderOp op = { .func = gs_op_set_texture_data, .resource = texture, .value = face };
+    gs_render_set_data(&op, data, texture->width * texture->height * gs_get_texture_format_size(texture->format));
+    gs_render_submit(&op);
+}
+
 void gs_texture_set_data(GsTexture *texture, void *data) {
     GS_ASSERT(texture != NULL);
     GS_ASSERT(data != NULL);
     GS_ASSERT(active_config != NULL);
     GS_ASSERT(active_config->backend != NULL);
 
-    active_config->backend->set_texture_data(texture, GS_CUBEMAP_FACE_NONE, data);
+    gs_texture_upload(texture, GS_CUBEMAP_FACE_NONE, data);
+    gs_capture_shadow_texture(texture, GS_CUBEMAP_FACE_NONE, data);
+}
+
+static void gs_op_clear_texture(GsRenderOp *op) {
+    active_config->backend->clear_texture(op->resource);
 }
 
 void gs_texture_clear(GsTexture *texture) {
@@ -628,7 +3935,10 @@ void gs_texture_clear(GsTexture *texture) {
     GS_ASSERT(active_config != NULL);
     GS_ASSERT(active_config->backend != NULL);
 
-    active_config->backend->clear_texture(texture);
+    GsRenderOp op = { .func = gs_op_clear_texture, .resource = texture };
+    gs_render_submit(&op);
+
+    gs_capture_shadow_texture_clear(texture);
 }
 
 void gs_texture_set_face_data(GsTexture *texture, const GsCubemapFace face, void *data) {
@@ -637,7 +3947,12 @@ void gs_texture_set_face_data(GsTexture *texture, const GsCubemapFace face, void
     GS_ASSERT(active_config != NULL);
     GS_ASSERT(active_config->backend != NULL);
 
-    active_config->backend->set_texture_data(texture, face, data);
+    gs_texture_upload(texture, face, data);
+    gs_capture_shadow_texture(texture, face, data);
+}
+
+static void gs_op_generate_mipmaps(GsRenderOp *op) {
+    active_config->backend->generate_mipmaps(op->resource);
 }
 
 void gs_texture_generate_mipmaps(GsTexture *texture) {
@@ -645,69 +3960,81 @@ void gs_texture_generate_mipmaps(GsTexture *texture) {
     GS_ASSERT(active_config != NULL);
     GS_ASSERT(active_config->backend != NULL);
 
-    active_config->backend->generate_mipmaps(texture);
+    GsRenderOp op = { .func = gs_op_generate_mipmaps, .resource = texture };
+    gs_render_submit(&op);
+
+    gs_capture_shadow_texture_mipmaps(texture);
+}
+
+int gs_get_texture_format_size(const GsTextureFormat format) {
+    switch (format) {
+        case GS_TEXTURE_FORMAT_RGB8:
+            return 3;
+        case GS_TEXTURE_FORMAT_RGBA8:
+            return 4;
+        case GS_TEXTURE_FORMAT_RGB16F:
+            return 6;
+        case GS_TEXTURE_FORMAT_RGBA16F:
+            return 8;
+        case GS_TEXTURE_FORMAT_DEPTH24_STENCIL8:
+        case GS_TEXTURE_FORMAT_DEPTH32F:
+            return 4;
+        default:
+            GS_ASSERT(GS_FALSE);
+            return 0;
+    }
 }
 
 void gs_uniform_set_int(GsCommandList *list, GsUniformLocation location, int value) {
     GS_ASSERT(list != NULL);
 
-    GsUniformIntCommand *data = GS_CMD_ALLOC(list, GsUniformIntCommand);
+    GsUniformIntCommand *data = GS_CMD_PUSH(list, GS_COMMAND_SET_UNIFORM_INT, GsUniformIntCommand);
     data->location = location;
     data->value = value;
-
-    gs_command_list_add(list, GS_COMMAND_SET_UNIFORM_INT, data, sizeof(GsUniformIntCommand));
 }
 
 void gs_uniform_set_float(GsCommandList *list, GsUniformLocation location, float value) {
     GS_ASSERT(list != NULL);
 
-    GsUniformFloatCommand *data = GS_CMD_ALLOC(list, GsUniformFloatCommand);
+    GsUniformFloatCommand *data = GS_CMD_PUSH(list, GS_COMMAND_SET_UNIFORM_FLOAT, GsUniformFloatCommand);
     data->location = location;
     data->value = value;
-
-    gs_command_list_add(list, GS_COMMAND_SET_UNIFORM_FLOAT, data, sizeof(GsUniformFloatCommand));
 }
 
 void gs_uniform_set_vec2(GsCommandList *list, GsUniformLocation location, float x, float y) {
     GS_ASSERT(list != NULL);
 
-    GsUniformVec2Command *data = GS_CMD_ALLOC(list, GsUniformVec2Command);
+    GsUniformVec2Command *data = GS_CMD_PUSH(list, GS_COMMAND_SET_UNIFORM_VEC2, GsUniformVec2Command);
     data->location = location;
     data->x = x;
     data->y = y;
-
-    gs_command_list_add(list, GS_COMMAND_SET_UNIFORM_VEC2, data, sizeof(GsUniformVec2Command));
 }
 
 void gs_uniform_set_vec3(GsCommandList *list, GsUniformLocation location, float x, float y, float z) {
     GS_ASSERT(list != NULL);
 
-    GsUniformVec3Command *data = GS_CMD_ALLOC(list, GsUniformVec3Command);
+    GsUniformVec3Command *data = GS_CMD_PUSH(list, GS_COMMAND_SET_UNIFORM_VEC3, GsUniformVec3Command);
     data->location = location;
     data->x = x;
     data->y = y;
     data->z = z;
-
-    gs_command_list_add(list, GS_COMMAND_SET_UNIFORM_VEC3, data, sizeof(GsUniformVec3Command));
 }
 
 void gs_uniform_set_vec4(GsCommandList *list, GsUniformLocation location, float x, float y, float z, float w) {
     GS_ASSERT(list != NULL);
 
-    GsUniformVec4Command *data = GS_CMD_ALLOC(list, GsUniformVec4Command);
+    GsUniformVec4Command *data = GS_CMD_PUSH(list, GS_COMMAND_SET_UNIFORM_VEC4, GsUniformVec4Command);
     data->location = location;
     data->x = x;
     data->y = y;
     data->z = z;
     data->w = w;
-
-    gs_command_list_add(list, GS_COMMAND_SET_UNIFORM_VEC4, data, sizeof(GsUniformVec4Command));
 }
 
 void gs_uniform_set_mat4(GsCommandList *list, GsUniformLocation location, float m00, float m01, float m02, float m03, float m10, float m11, float m12, float m13, float m20, float m21, float m22, float m23, float m30, float m31, float m32, float m33) {
     GS_ASSERT(list != NULL);
 
-    GsUniformMat4Command *data = GS_CMD_ALLOC(list, GsUniformMat4Command);
+    GsUniformMat4Command *data = GS_CMD_PUSH(list, GS_COMMAND_SET_UNIFORM_MAT4, GsUniformMat4Command);
     data->location = location;
     data->m00 = m00;
     data->m01 = m01;
@@ -725,8 +4052,44 @@ void gs_uniform_set_mat4(GsCommandList *list, GsUniformLocation location, float
     data->m31 = m31;
     data->m32 = m32;
     data->m33 = m33;
+}
+
+static void gs_uniform_set_array(GsCommandList *list, const GsCommandType type, const GsUniformLocation location, const float *data, const int count, const int components) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(data != NULL);
+    GS_ASSERT(count > 0);
+
+    const int size = (int) sizeof(float) * components * count;
+    GS_ASSERT(size <= GS_COMMAND_MAX_PAYLOAD - (int) sizeof(GsUniformArrayCommand));
+
+    GsUniformArrayCommand *cmd = (GsUniformArrayCommand*)gs_command_list_push(list, type, (int) sizeof(GsUniformArrayCommand) + size);
+    cmd->location = location;
+    cmd->count = count;
+    memcpy(cmd + 1, data, size);
+}
+
+void gs_uniform_set_floatv(GsCommandList *list, GsUniformLocation location, const float *data, int count) {
+    gs_uniform_set_array(list, GS_COMMAND_SET_UNIFORM_FLOAT_ARRAY, location, data, count, 1);
+}
+
+void gs_uniform_set_vec2v(GsCommandList *list, GsUniformLocation location, const float *data, int count) {
+    gs_uniform_set_array(list, GS_COMMAND_SET_UNIFORM_VEC2_ARRAY, location, data, count, 2);
+}
+
+void gs_uniform_set_vec3v(GsCommandList *list, GsUniformLocation location, const float *data, int count) {
+    gs_uniform_set_array(list, GS_COMMAND_SET_UNIFORM_VEC3_ARRAY, location, data, count, 3);
+}
+
+void gs_uniform_set_vec4v(GsCommandList *list, GsUniformLocation location, const float *data, int count) {
+    gs_uniform_set_array(list, GS_COMMAND_SET_UNIFORM_VEC4_ARRAY, location, data, count, 4);
+}
+
+void gs_uniform_set_mat3v(GsCommandList *list, GsUniformLocation location, const float *data, int count) {
+    gs_uniform_set_array(list, GS_COMMAND_SET_UNIFORM_MAT3_ARRAY, location, data, count, 9);
+}
 
-    gs_command_list_add(list, GS_COMMAND_SET_UNIFORM_MAT4, data, sizeof(GsUniformMat4Command));
+void gs_uniform_set_mat4v(GsCommandList *list, GsUniformLocation location, const float *data, int count) {
+    gs_uniform_set_array(list, GS_COMMAND_SET_UNIFORM_MAT4_ARRAY, location, data, count, 16);
 }
 
 void gs_copy_texture(GsCommandList *list, GsTexture *src, GsTexture *dst) {
@@ -734,11 +4097,9 @@ void gs_copy_texture(GsCommandList *list, GsTexture *src, GsTexture *dst) {
     GS_ASSERT(src != NULL);
     GS_ASSERT(dst != NULL);
 
-    GsCopyTextureCommand *data = GS_CMD_ALLOC(list, GsCopyTextureCommand);
-    data->src = src;
-    data->dst = dst;
-
-    gs_command_list_add(list, GS_COMMAND_COPY_TEXTURE, data, sizeof(GsCopyTextureCommand));
+    GsCopyTextureCommand *data = GS_CMD_PUSH(list, GS_COMMAND_COPY_TEXTURE, GsCopyTextureCommand);
+    data->src = src->id;
+    data->dst = dst->id;
 }
 
 void gs_resolve_texture(GsCommandList *list, GsTexture *src, GsTexture *dst) {
@@ -746,11 +4107,9 @@ void gs_resolve_texture(GsCommandList *list, GsTexture *src, GsTexture *dst) {
     GS_ASSERT(src != NULL);
     GS_ASSERT(dst != NULL);
 
-    GsResolveTextureCommand *data = GS_CMD_ALLOC(list, GsResolveTextureCommand);
-    data->src = src;
-    data->dst = dst;
-
-    gs_command_list_add(list, GS_COMMAND_RESOLVE_TEXTURE, data, sizeof(GsResolveTextureCommand));
+    GsResolveTextureCommand *data = GS_CMD_PUSH(list, GS_COMMAND_RESOLVE_TEXTURE, GsResolveTextureCommand);
+    data->src = src->id;
+    data->dst = dst->id;
 }
 
 void gs_copy_texture_partial(GsCommandList *list, GsTexture *src, GsTexture *dst, const int src_x, const int src_y, const int dst_x, const int dst_y, const int width, const int height) {
@@ -758,27 +4117,101 @@ void gs_copy_texture_partial(GsCommandList *list, GsTexture *src, GsTexture *dst
     GS_ASSERT(src != NULL);
     GS_ASSERT(dst != NULL);
 
-    GsCopyTexturePartialCommand *data = GS_CMD_ALLOC(list, GsCopyTexturePartialCommand);
-    data->src = src;
-    data->dst = dst;
+    GsCopyTexturePartialCommand *data = GS_CMD_PUSH(list, GS_COMMAND_COPY_TEXTURE_PARTIAL, GsCopyTexturePartialCommand);
+    data->src = src->id;
+    data->dst = dst->id;
     data->src_x = src_x;
     data->src_y = src_y;
     data->dst_x = dst_x;
     data->dst_y = dst_y;
     data->width = width;
     data->height = height;
-
-    gs_command_list_add(list, GS_COMMAND_COPY_TEXTURE_PARTIAL, data, sizeof(GsCopyTexturePartialCommand));
 }
 
 void gs_generate_mipmaps(GsCommandList *list, GsTexture *texture) {
     GS_ASSERT(list != NULL);
     GS_ASSERT(texture != NULL);
 
-    GsGenMipmapsCommand *data = GS_CMD_ALLOC(list, GsGenMipmapsCommand);
-    data->texture = texture;
+    GsGenMipmapsCommand *data = GS_CMD_PUSH(list, GS_COMMAND_GEN_MIPMAPS, GsGenMipmapsCommand);
+    data->texture = texture->id;
+}
+
+GsCommandPointer gs_command_pointer(void *pointer) {
+    GsCommandPointer result;
+    memcpy(&result, &pointer, sizeof(void*));
+    return result;
+}
+
+void *gs_command_pointer_get(const GsCommandPointer pointer) {
+    void *result;
+    memcpy(&result, &pointer, sizeof(void*));
+    return result;
+}
+
+// Update payloads have to stay valid until the list executed, so they are kept in its data arena.
+static void *gs_command_list_keep(GsCommandList *list, void *data, const int size) {
+    if (gs_command_arena_contains(&list->data, data, size)) {
+        return data;
+    }
+
+    void *copy = gs_command_arena_alloc(&list->data, size);
+    memcpy(copy, data, size);
+
+    return copy;
+}
+
+void gs_update_buffer(GsCommandList *list, GsBuffer *buffer, void *data, const int size) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(buffer != NULL);
+    GS_ASSERT(buffer->stream == NULL);
+    GS_ASSERT(data != NULL);
+    GS_ASSERT(size > 0);
+
+    GsUpdateBufferCommand *cmd = GS_CMD_PUSH(list, GS_COMMAND_UPDATE_BUFFER, GsUpdateBufferCommand);
+    cmd->buffer = buffer->id;
+    cmd->partial = GS_FALSE;
+    cmd->offset = 0;
+    cmd->size = size;
+    cmd->data = gs_command_pointer(gs_command_list_keep(list, data, size));
+}
+
+void gs_update_buffer_partial(GsCommandList *list, GsBuffer *buffer, void *data, const int size, const int offset) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(buffer != NULL);
+    GS_ASSERT(buffer->stream == NULL);
+    GS_ASSERT(data != NULL);
+    GS_ASSERT(size > 0);
+    GS_ASSERT(offset >= 0);
+
+    GsUpdateBufferCommand *cmd = GS_CMD_PUSH(list, GS_COMMAND_UPDATE_BUFFER, GsUpdateBufferCommand);
+    cmd->buffer = buffer->id;
+    cmd->partial = GS_TRUE;
+    cmd->offset = offset;
+    cmd->size = size;
+    cmd->data = gs_command_pointer(gs_command_list_keep(list, data, size));
+}
+
+void gs_update_texture_face(GsCommandList *list, GsTexture *texture, const GsCubemapFace face, void *data) {
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(texture != NULL);
+    GS_ASSERT(data != NULL);
+
+    const int size = texture->width * texture->height * gs_get_texture_format_size(texture->format);
 
-    gs_command_list_add(list, GS_COMMAND_GEN_MIPMAPS, data, sizeof(GsGenMipmapsCommand));
+    GsUpdateTextureCommand *cmd = GS_CMD_PUSH(list, GS_COMMAND_UPDATE_TEXTURE, GsUpdateTextureCommand);
+    cmd->texture = texture->id;
+    cmd->face = face;
+    cmd->size = size;
+    cmd->data = gs_command_pointer(gs_command_list_keep(list, data, size));
+}
+
+void gs_update_texture(GsCommandList *list, GsTexture *texture, void *data) {
+    gs_update_texture_face(list, texture, GS_CUBEMAP_FACE_NONE, data);
+}
+
+static void gs_op_destroy_texture(GsRenderOp *op) {
+    active_config->backend->destroy_texture_handle(op->resource);
+    gs_render_release(op);
 }
 
 void gs_destroy_texture(GsTexture *texture) {
@@ -786,8 +4219,13 @@ void gs_destroy_texture(GsTexture *texture) {
     GS_ASSERT(active_config != NULL);
     GS_ASSERT(active_config->backend != NULL);
 
-    active_config->backend->destroy_texture_handle(texture);
-    GS_FREE(texture);
+    gs_forget_texture_uploads(active_config, texture);
+
+    if (texture->stream != NULL) {
+        gs_destroy_texture_stream(active_config, texture->stream);
+    }
+
+    gs_release_resource(gs_op_destroy_texture, texture, texture->id);
 }
 
 void gs_create_mainloop(void (*mainloop)()) {
@@ -806,6 +4244,10 @@ void gs_stop_mainloop() {
     mainloop_active = GS_FALSE;
 }
 
+static void gs_op_create_render_pass(GsRenderOp *op) {
+    active_config->backend->create_render_pass_handle(op->resource);
+}
+
 GsRenderPass *gs_create_render_pass(GsFramebuffer* framebuffer) {
     GS_ASSERT(active_config != NULL);
     GS_ASSERT(active_config->backend != NULL);
@@ -813,19 +4255,32 @@ GsRenderPass *gs_create_render_pass(GsFramebuffer* framebuffer) {
     GsRenderPass *pass = GS_ALLOC(GsRenderPass);
     pass->framebuffer = framebuffer;
     pass->handle = NULL;
+    pass->id = gs_register_resource(pass, GS_RESOURCE_TYPE_RENDER_PASS);
 
-    active_config->backend->create_render_pass_handle(pass);
+    GsRenderOp op = { .func = gs_op_create_render_pass, .resource = pass };
+    gs_render_submit(&op);
 
     return pass;
 }
 
+static void gs_op_destroy_render_pass(GsRenderOp *op) {
+    active_config->backend->destroy_render_pass_handle(op->resource);
+    gs_render_release(op);
+}
+
 void gs_destroy_render_pass(GsRenderPass *pass) {
     GS_ASSERT(pass != NULL);
     GS_ASSERT(active_config != NULL);
     GS_ASSERT(active_config->backend != NULL);
 
-    active_config->backend->destroy_render_pass_handle(pass);
-    GS_FREE(pass);
+    gs_release_resource(gs_op_destroy_render_pass, pass, pass->id);
+}
+
+GsBackendStats gs_get_backend_stats() {
+    GS_ASSERT(active_config != NULL);
+    GS_ASSERT(active_config->backend != NULL);
+
+    return active_config->backend->stats;
 }
 
 GS_BOOL gs_has_capability(const GsCapability capability) {
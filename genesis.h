@@ -6,19 +6,40 @@ extern "C"
 {
 #endif
 
+#include <stdint.h>
+
 #define GS_VERSION_MAJOR 0
 #define GS_VERSION_MINOR 1
 #define GS_VERSION_PATCH 0
 
 #define GS_MAX_VERTEX_LAYOUT_ITEMS 128
 #define GS_MAX_TEXTURE_SLOTS 16
-#define GS_MAX_COMMAND_LIST_ITEMS 4096
-#define GS_MAX_COMMAND_SUBMISSIONS 4096
-
-#define GS_COMMAND_LIST_DATA_SIZE 524288
-#define GS_CMD_ALLOC(list, cmd) (cmd*)gs_command_list_alloc(list, sizeof(cmd))
+#define GS_MAX_VERTEX_STREAMS 4 // vertex buffers a layout reads from, the instance buffer not included
+#define GS_VERTEX_STREAM_INSTANCE -1 // stream of the items added with gs_layout_add_instanced
+#define GS_MAX_UNIFORM_BLOCK_BINDINGS 16
+#define GS_UNIFORM_BUFFER_ALIGNMENT 256 // offsets of bound uniform block ranges, the largest alignment drivers report
+
+#define GS_COMMAND_LIST_CHUNK_SIZE 16384 // default size of a command list arena chunk, grows in linked chunks
+#define GS_COMMAND_LIST_ALIGNMENT 8
+#define GS_COMMAND_ALIGNMENT 4
+#define GS_COMMAND_MAX_PAYLOAD 65535
+#define GS_CMD_PUSH(list, type, cmd) (cmd*)gs_command_list_push(list, type, sizeof(cmd))
+#define GS_COMMAND_DATA(header, cmd) ((const cmd*)((const GsCommandHeader*)(header) + 1))
+#define GS_COMMAND_STRIDE(header) (int)((sizeof(GsCommandHeader) + (header)->size + GS_COMMAND_ALIGNMENT - 1) & ~(GS_COMMAND_ALIGNMENT - 1))
+#define GS_UNIFORM_ARRAY_DATA(cmd) ((const float*)((const GsUniformArrayCommand*)(cmd) + 1))
+
+#define GS_FRAME_ALLOCATOR_SIZE 262144 // initial size of the frame allocator, see gs_frame_alloc
+#define GS_FRAME_ALLOCATOR_HISTORY 32 // frames the frame allocator sizes itself from
+#define GS_FRAME_ALLOCATOR_ALIGNMENT 16
+#define GS_STREAM_RING_MAX_FRAMES 8 // frames a mapped stream ring keeps fenced before it waits for the oldest
+#define GS_FENCE_WAIT_FOREVER UINT64_MAX
+#define GS_TEXTURE_UPLOAD_BUDGET 4194304 // bytes of asynchronous texture uploads gs_frame issues, see gs_texture_upload_async
+#define GS_TEXTURE_MAX_LEVELS 16 // mip levels of a streamed texture, enough for 32768 texels
+
+#define GS_INVALID_RESOURCE_ID 0
 
 #define GS_MALLOC(size) malloc(size)
+#define GS_REALLOC(ptr, size) realloc(ptr, size)
 #define GS_ALLOC_MULTIPLE(obj, count) (obj*)malloc(sizeof(obj) * count)
 
 #if defined(__ANDROID__)
@@ -40,6 +61,14 @@ extern "C"
 #define GS_TRUE 1
 #define GS_FALSE 0
 
+// flags written and read on different threads, only the C sources touch them so C++ only needs the layout
+#if defined(__cplusplus)
+    #define GS_ATOMIC_BOOL unsigned char
+#else
+    #include <stdatomic.h>
+    #define GS_ATOMIC_BOOL atomic_bool
+#endif
+
 typedef enum {
     GS_BACKEND_NOOP = 1,
     GS_BACKEND_OPENGL = 2
@@ -47,6 +76,14 @@ typedef enum {
 
 typedef enum {
     GS_CAPABILITY_RENDERER = 1 << 0,
+    GS_CAPABILITY_UNIFORM_BUFFERS = 1 << 1,
+    GS_CAPABILITY_INSTANCING = 1 << 2,
+    GS_CAPABILITY_MULTI_DRAW_INDIRECT = 1 << 3, // draw parameters are read by the GPU and gl_DrawID is available
+    GS_CAPABILITY_BASE_VERTEX = 1 << 4, // native base vertex draws, emulated by moving the attribute pointers otherwise
+    GS_CAPABILITY_PACKED_ATTRIBUTES = 1 << 5, // half float and 2_10_10_10 attributes, integer attributes
+    GS_CAPABILITY_PERSISTENT_MAPPING = 1 << 6, // stream rings are written straight into mapped buffer memory
+    GS_CAPABILITY_READBACK = 1 << 7, // buffer contents can be copied back to the CPU
+    GS_CAPABILITY_TEXTURE_STREAMING = 1 << 8, // the sampled mip levels of a texture can be restricted, see gs_create_streamed_texture
 } GsCapability;
 
 typedef enum {
@@ -58,6 +95,8 @@ typedef enum {
     GS_ATTRIB_TYPE_INT32,
     GS_ATTRIB_TYPE_INT8,
     GS_ATTRIB_TYPE_DOUBLE,
+    GS_ATTRIB_TYPE_HALF_FLOAT,
+    GS_ATTRIB_TYPE_INT_2_10_10_10_REV, // x, y, z in 10 bits and w in 2 bits of one uint32, always 4 components
 } GsVtxAttribType;
 
 typedef enum {
@@ -82,8 +121,38 @@ typedef enum {
     GS_COMMAND_GEN_MIPMAPS,
     GS_COMMAND_BEGIN_PASS,
     GS_COMMAND_END_PASS,
+    GS_COMMAND_EXECUTE_BUNDLE,
+    GS_COMMAND_UPDATE_BUFFER,
+    GS_COMMAND_UPDATE_TEXTURE,
+    GS_COMMAND_SET_UNIFORM_FLOAT_ARRAY,
+    GS_COMMAND_SET_UNIFORM_VEC2_ARRAY,
+    GS_COMMAND_SET_UNIFORM_VEC3_ARRAY,
+    GS_COMMAND_SET_UNIFORM_VEC4_ARRAY,
+    GS_COMMAND_SET_UNIFORM_MAT3_ARRAY,
+    GS_COMMAND_SET_UNIFORM_MAT4_ARRAY,
+    GS_COMMAND_USE_UNIFORM_BLOCK,
+    GS_COMMAND_USE_INSTANCE_BUFFER,
+    GS_COMMAND_DRAW_ARRAYS_INSTANCED,
+    GS_COMMAND_DRAW_INDEXED_INSTANCED,
+    GS_COMMAND_DRAW_INDIRECT,
+    GS_COMMAND_MULTI_DRAW_INDIRECT,
+    GS_COMMAND_USE_VERTEX_STREAM,
+    GS_COMMAND_COUNT // keep last
 } GsCommandType;
 
+typedef enum {
+    GS_RESOURCE_TYPE_NONE,
+    GS_RESOURCE_TYPE_BUFFER,
+    GS_RESOURCE_TYPE_TEXTURE,
+    GS_RESOURCE_TYPE_PIPELINE,
+    GS_RESOURCE_TYPE_RENDER_PASS,
+    GS_RESOURCE_TYPE_PROGRAM,
+    GS_RESOURCE_TYPE_SHADER,
+    GS_RESOURCE_TYPE_LAYOUT,
+    GS_RESOURCE_TYPE_FRAMEBUFFER,
+    GS_RESOURCE_TYPE_BUNDLE
+} GsResourceType;
+
 typedef enum {
     GS_CLEAR_COLOR = 1,
     GS_CLEAR_DEPTH = 2,
@@ -92,9 +161,16 @@ typedef enum {
 
 typedef enum {
     GS_BUFFER_TYPE_VERTEX,
-    GS_BUFFER_TYPE_INDEX
+    GS_BUFFER_TYPE_INDEX,
+    GS_BUFFER_TYPE_UNIFORM,
+    GS_BUFFER_TYPE_INDIRECT
 } GsBufferType;
 
+typedef enum {
+    GS_INDEX_TYPE_UINT16,
+    GS_INDEX_TYPE_UINT32
+} GsIndexType;
+
 typedef enum {
     GS_BUFFER_INTENT_DRAW_STATIC,
     GS_BUFFER_INTENT_DRAW_DYNAMIC,
@@ -207,27 +283,69 @@ typedef enum {
     GS_WINDING_DIRECTION_CW
 } GsWindingDirection;
 
+typedef enum {
+    GS_VARIABLE_TYPE_UNKNOWN,
+    GS_VARIABLE_TYPE_FLOAT,
+    GS_VARIABLE_TYPE_VEC2,
+    GS_VARIABLE_TYPE_VEC3,
+    GS_VARIABLE_TYPE_VEC4,
+    GS_VARIABLE_TYPE_INT,
+    GS_VARIABLE_TYPE_IVEC2,
+    GS_VARIABLE_TYPE_IVEC3,
+    GS_VARIABLE_TYPE_IVEC4,
+    GS_VARIABLE_TYPE_BOOL,
+    GS_VARIABLE_TYPE_BVEC2,
+    GS_VARIABLE_TYPE_BVEC3,
+    GS_VARIABLE_TYPE_BVEC4,
+    GS_VARIABLE_TYPE_MAT2,
+    GS_VARIABLE_TYPE_MAT3,
+    GS_VARIABLE_TYPE_MAT4,
+    GS_VARIABLE_TYPE_SAMPLER_2D,
+    GS_VARIABLE_TYPE_SAMPLER_3D,
+    GS_VARIABLE_TYPE_SAMPLER_CUBE,
+    GS_VARIABLE_TYPE_SAMPLER_2D_SHADOW,
+    GS_VARIABLE_TYPE_SAMPLER_2D_ARRAY,
+    GS_VARIABLE_TYPE_SAMPLER_CUBE_SHADOW
+} GsVariableType;
+
 typedef int GsUniformLocation;
+typedef uint32_t GsResourceId;
 typedef struct GsBackend GsBackend;
 typedef struct GsConfig GsConfig;
 typedef struct GsVtxLayout GsVtxLayout;
 typedef struct GsVtxLayoutItem GsVtxLayoutItem;
 typedef struct GsCommandList GsCommandList;
-typedef struct GsCommandListItem GsCommandListItem;
+typedef struct GsCommandHeader GsCommandHeader;
+typedef struct GsCommandIterator GsCommandIterator;
+typedef struct GsCommandListChunk GsCommandListChunk;
+typedef struct GsCommandArena GsCommandArena;
+typedef struct GsCommandListStats GsCommandListStats;
+typedef struct GsCommandSorter GsCommandSorter;
+typedef struct GsFrameAllocator GsFrameAllocator;
+typedef struct GsFrameAllocatorStats GsFrameAllocatorStats;
 typedef struct GsPipeline GsPipeline;
 typedef struct GsShader GsShader;
 typedef struct GsProgram GsProgram;
+typedef struct GsProgramVariable GsProgramVariable;
+typedef struct GsProgramVariableTable GsProgramVariableTable;
 typedef struct GsBuffer GsBuffer;
 typedef struct GsTexture GsTexture;
 typedef struct GsFramebuffer GsFramebuffer;
 typedef struct GsUnmanagedBufferData GsUnmanagedBufferData;
+typedef struct GsReadback GsReadback;
 typedef struct GsClearCommand GsClearCommand;
 typedef struct GsViewportCommand GsViewportCommand;
 typedef struct GsPipelineCommand GsPipelineCommand;
 typedef struct GsTextureCommand GsTextureCommand;
 typedef struct GsUseBufferCommand GsUseBufferCommand;
+typedef struct GsUseVertexStreamCommand GsUseVertexStreamCommand;
 typedef struct GsDrawArraysCommand GsDrawArraysCommand;
 typedef struct GsDrawIndexedCommand GsDrawIndexedCommand;
+typedef struct GsDrawArraysInstancedCommand GsDrawArraysInstancedCommand;
+typedef struct GsDrawIndexedInstancedCommand GsDrawIndexedInstancedCommand;
+typedef struct GsDrawIndirectCommand GsDrawIndirectCommand;
+typedef struct GsDrawArraysIndirectArgs GsDrawArraysIndirectArgs;
+typedef struct GsDrawIndexedIndirectArgs GsDrawIndexedIndirectArgs;
 typedef struct GsScissorCommand GsScissorCommand;
 typedef struct GsUniformIntCommand GsUniformIntCommand;
 typedef struct GsUniformFloatCommand GsUniformFloatCommand;
@@ -235,31 +353,64 @@ typedef struct GsUniformVec2Command GsUniformVec2Command;
 typedef struct GsUniformVec3Command GsUniformVec3Command;
 typedef struct GsUniformVec4Command GsUniformVec4Command;
 typedef struct GsUniformMat4Command GsUniformMat4Command;
+typedef struct GsUniformArrayCommand GsUniformArrayCommand;
+typedef struct GsUniformBlockCommand GsUniformBlockCommand;
+typedef struct GsUniformRing GsUniformRing;
+typedef struct GsStreamRing GsStreamRing;
+typedef struct GsTextureRead GsTextureRead;
+typedef struct GsTextureUpload GsTextureUpload;
+typedef struct GsTextureStream GsTextureStream;
 typedef struct GsCopyTextureCommand GsCopyTextureCommand;
 typedef struct GsCopyTexturePartialCommand GsCopyTexturePartialCommand;
 typedef struct GsResolveTextureCommand GsResolveTextureCommand;
 typedef struct GsGenMipmapsCommand GsGenMipmapsCommand;
 typedef struct GsBeginRenderPassCommand GsBeginRenderPassCommand;
 typedef struct GsEndRenderPassCommand GsEndRenderPassCommand;
+typedef struct GsExecuteBundleCommand GsExecuteBundleCommand;
+
+typedef void (*GsTextureReadCallback)(const void *pixels, int width, int height, void *user);
 
 typedef struct GsConfig {
     // config
     GsBackend *backend;
     void *window;
 
+    // render thread, when enabled the backend only ever runs on a dedicated thread, see gs_init
+    GS_BOOL render_thread;
+    void (*render_thread_start)(GsConfig *config); // on the render thread before the backend initializes, e.g. to make a GL context current
+    void (*render_thread_stop)(GsConfig *config); // on the render thread after the backend shut down
+
+    int frame_allocator_size; // bytes the frame allocator starts with and never shrinks below, it grows with the recent frames
+    int texture_upload_budget; // bytes of asynchronous texture uploads issued per gs_frame, at least one is issued
+
     // state
-    GsCommandList *command_lists[GS_MAX_COMMAND_SUBMISSIONS];
-    int command_list_count;
+    GsCommandList **frame_lists; // submissions drained from the queue, sorted by order key
+    int frame_list_capacity;
+    GsFrameAllocator *frame_allocator; // created on the first gs_frame_alloc
+    GsUniformRing *uniform_ring; // created on the first gs_push_uniform_data
+    GsStreamRing *stream_rings; // rings of every buffer given a stream capacity
+    GsTextureRead *texture_reads; // gs_read_texture_async calls waiting for their copy
+    GsTextureUpload *texture_uploads; // queued by gs_texture_upload_async, highest priority first
+    GsTextureUpload *texture_uploads_issued; // waiting for the GPU
+    GsTextureStream *texture_streams; // of every streamed texture
 } GsConfig;
 
 typedef struct GsRenderPass {
     GsFramebuffer *framebuffer;
     void *handle;
+    GsResourceId id;
 } GsRenderPass;
 
+// Counters kept by the backend while it executes commands, reset by gs_init.
+typedef struct GsBackendStats {
+    uint64_t uniform_uploads; // uniform writes that reached the driver
+    uint64_t uniform_uploads_skipped; // uniform writes dropped because the program already held the value
+} GsBackendStats;
+
 typedef struct GsBackend {
     GsBackendType type;
     GsCapability capabilities;
+    GsBackendStats stats;
 
     // core
     GS_BOOL (*init)(GsBackend *backend, GsConfig *config);
@@ -271,6 +422,18 @@ typedef struct GsBackend {
     void (*set_buffer_data)(GsBuffer *buffer, void *data, int size);
     void (*set_buffer_partial_data)(GsBuffer *buffer, void *data, int size, int offset);
     void (*destroy_buffer_handle)(GsBuffer *buffer);
+    void *(*map_stream_buffer)(GsBuffer *buffer, int capacity); // persistently mapped storage, NULL when not supported
+
+    // fences
+    void *(*create_fence)(); // covers the GPU work submitted so far, NULL when the backend can't track it
+    GS_BOOL (*wait_fence)(void *fence, uint64_t timeout); // nanoseconds or GS_FENCE_WAIT_FOREVER, TRUE once the work completed
+    void (*destroy_fence)(void *fence);
+
+    // readback
+    void (*create_readback_handle)(GsReadback *readback, GsBuffer *buffer, int offset); // queues the copy of readback->size bytes
+    void (*create_texture_readback_handle)(GsReadback *readback, GsTexture *texture, int x, int y, int width, int height); // tightly packed rows
+    void *(*map_readback)(GsReadback *readback);
+    void (*destroy_readback_handle)(GsReadback *readback);
 
     // shader
     void (*create_shader_handle)(GsShader *shader, const char *source);
@@ -279,6 +442,7 @@ typedef struct GsBackend {
     // program,
     void (*create_program_handle)(GsProgram *program);
     GsUniformLocation (*get_uniform_location)(GsProgram *program, const char *name);
+    void (*set_uniform_block_binding)(GsProgram *program, const char *name, int binding);
     void (*destroy_program_handle)(GsProgram *program);
 
     // layout
@@ -288,6 +452,8 @@ typedef struct GsBackend {
     // texture
     void (*create_texture_handle)(GsTexture *texture);
     void (*set_texture_data)(GsTexture *texture, GsCubemapFace face, void *data);
+    void (*upload_texture)(GsTexture *texture, GsCubemapFace face, int level, int x, int y, int width, int height, const void *data); // staged, data can be freed after the call
+    void (*set_texture_levels)(GsTexture *texture, int base_level, int keep_level); // samples from base_level on, releases the levels finer than keep_level
     void (*generate_mipmaps)(GsTexture *texture);
     void (*clear_texture)(GsTexture *texture);
     void (*destroy_texture_handle)(GsTexture *texture);
@@ -300,6 +466,10 @@ typedef struct GsBackend {
     void (*create_framebuffer)(GsFramebuffer *framebuffer);
     void (*destroy_framebuffer)(GsFramebuffer *framebuffer);
     void (*framebuffer_attach_texture)(GsFramebuffer *framebuffer, GsTexture *texture, GsFramebufferAttachmentType attachment);
+
+    // bundle
+    void (*create_bundle_handle)(GsCommandList *bundle);
+    void (*destroy_bundle_handle)(GsCommandList *bundle);
 } GsBackend;
 
 typedef struct GsVtxLayoutItem {
@@ -310,30 +480,98 @@ typedef struct GsVtxLayoutItem {
     int components;
 
     GsVtxAttribType type;
-    GS_BOOL normalized;
+    GS_BOOL normalized; // integer types are read as [0, 1] or [-1, 1] instead of converted as is
+    GS_BOOL integer; // integer types reach the shader as ints, see gs_layout_set_integer
+    int divisor; // 0 advances per vertex, otherwise once every divisor instances
+    int stream; // vertex buffer the item is read from, see gs_layout_add_stream
 } GsVtxLayoutItem;
 
 typedef struct GsVtxLayout {
     GsVtxLayoutItem items[GS_MAX_VERTEX_LAYOUT_ITEMS];
     int count;
     int components;
-    int stride;
+    int stride; // stride of stream 0
+    int instance_stride; // stride of the per-instance items, 0 without any
+    int stream_strides[GS_MAX_VERTEX_STREAMS]; // each stream is packed on its own, stream_strides[0] equals stride
+    int stream_divisors[GS_MAX_VERTEX_STREAMS];
+    int stream_count; // highest stream an item was added to + 1
     void *handle;
     GS_BOOL completed;
+    GsResourceId id;
 } GsVtxLayout;
 
-typedef struct GsCommandListItem {
-    void *data;
+// Every command is stored as a header followed directly by its payload.
+typedef struct GsCommandHeader {
+    uint16_t type; // GsCommandType
+    uint16_t size; // payload size in bytes, excluding the header
+} GsCommandHeader;
+
+typedef struct GsCommandListChunk {
+    GsCommandListChunk *next;
     int size;
-    GsCommandType type;
-} GsCommandListItem;
+    int offset;
+    char data[];
+} GsCommandListChunk;
+
+typedef struct GsCommandArena {
+    GsCommandListChunk *head; // first chunk in use
+    GsCommandListChunk *current; // chunk currently allocated from
+    GsCommandListChunk *free_chunks; // recycled chunks, reused before allocating new ones
+    int chunk_size;
+    int alignment;
+    int used; // bytes handed out since the last reset
+    int reserved; // bytes owned by all chunks, including the free list
+    int chunk_count;
+} GsCommandArena;
+
+typedef struct GsCommandListStats {
+    int bytes_used;
+    int bytes_reserved;
+    int chunk_count;
+    int command_count;
+    int eliminated_commands; // redundant commands dropped by gs_command_list_end
+    int high_water_bytes; // largest recording since creation
+    int high_water_commands;
+} GsCommandListStats;
+
+typedef struct GsFrameAllocatorStats {
+    int bytes_used; // handed out during the last completed frame
+    int bytes_overflow; // part of bytes_used that did not fit and was allocated separately
+    int bytes_peak; // largest frame within the last GS_FRAME_ALLOCATOR_HISTORY frames
+    int capacity; // bytes reserved for the current frame
+    int allocation_count; // allocations during the last completed frame
+    int resize_count;
+} GsFrameAllocatorStats;
+
+typedef struct GsCommandIterator {
+    const GsCommandListChunk *chunk;
+    int offset;
+} GsCommandIterator;
 
 typedef struct GsCommandList {
-    char* alloc_data;
-    int alloc_offset;
-    GsCommandListItem items[GS_MAX_COMMAND_LIST_ITEMS];
+    GsCommandArena stream; // packed command headers and payloads, walked in order on submit
+    GsCommandArena data; // side allocations referenced by commands
     GsPipeline *pipeline;
     int count;
+    int eliminated;
+    int high_water_bytes;
+    int high_water_commands;
+
+    // submission
+    uint32_t order_key; // lists are executed in ascending key order within a frame
+    uint32_t submit_sequence; // breaks ties between equal keys
+    GsCommandList *next_submission;
+    GS_ATOMIC_BOOL queued; // set by gs_command_list_submit, cleared once the frame drained the list
+    uint64_t fence; // render thread work that has to complete before the list may be recorded again
+
+    // bundle, recorded once and replayed through GS_COMMAND_EXECUTE_BUNDLE
+    GS_BOOL bundle;
+    GS_BOOL sealed;
+    void *handle;
+    GsResourceId id;
+
+    // optional draw sorting, NULL unless enabled through gs_command_list_set_sorting
+    GsCommandSorter *sorter;
 } GsCommandList;
 
 typedef struct GsPipeline {
@@ -363,19 +601,25 @@ typedef struct GsPipeline {
     GsDepthFunc depth_func;
     GS_BOOL depth_write;
     GS_BOOL depth_test;
+
+    GsResourceId id;
 } GsPipeline;
 
 typedef struct GsBuffer {
     GsBufferType type;
     GsBufferIntent intent;
+    GsIndexType index_type; // element type of index buffers, GS_INDEX_TYPE_UINT32 unless changed
     int size;
     void *handle;
+    GsStreamRing *stream; // set by gs_buffer_set_stream_capacity
+    GsResourceId id;
 } GsBuffer;
 
 typedef struct GsFramebuffer {
     void *handle;
     int width;
     int height;
+    GsResourceId id;
 } GsFramebuffer;
 
 typedef struct GsUnmanagedBufferData {
@@ -383,6 +627,15 @@ typedef struct GsUnmanagedBufferData {
     int size;
 } GsUnmanagedBufferData;
 
+typedef struct GsReadback {
+    int size;
+    void *handle; // staging storage the backend copied into
+    void *fence; // completes with the copy, written by the render thread
+    void *data; // mapped staging storage, once the copy completed and gs_readback_get_data was called
+    GS_ATOMIC_BOOL complete; // written by the render thread once the fence signaled
+    uint64_t poll_fence; // render op of the last gs_readback_poll
+} GsReadback;
+
 typedef struct GsClearCommand {
     float r;
     float g;
@@ -449,19 +702,37 @@ typedef struct GsUniformMat4Command {
     float m33;
 } GsUniformMat4Command;
 
+// Followed by count elements of floats in the payload, matrices row-major like GsUniformMat4Command.
+typedef struct GsUniformArrayCommand {
+    GsUniformLocation location;
+    int count;
+} GsUniformArrayCommand;
+
+typedef struct GsUniformBlockCommand {
+    int binding; // first, uniform writes and block binds are told apart by type but compared by this field
+    GsResourceId buffer;
+    int offset;
+    int size;
+} GsUniformBlockCommand;
+
 typedef struct GsPipelineCommand {
-    GsPipeline *pipeline;
+    GsResourceId pipeline;
 } GsPipelineCommand;
 
 typedef struct GsTextureCommand {
-    GsTexture *texture;
+    GsResourceId texture;
     int slot;
 } GsTextureCommand;
 
 typedef struct GsUseBufferCommand {
-    GsBuffer *buffer;
+    GsResourceId buffer;
 } GsUseBufferCommand;
 
+typedef struct GsUseVertexStreamCommand {
+    GsResourceId buffer;
+    int stream;
+} GsUseVertexStreamCommand;
+
 typedef struct GsDrawArraysCommand {
     int start;
     int count;
@@ -469,8 +740,48 @@ typedef struct GsDrawArraysCommand {
 
 typedef struct GsDrawIndexedCommand {
     int count;
+    int first_index;
+    int base_vertex;
 } GsDrawIndexedCommand;
 
+typedef struct GsDrawArraysInstancedCommand {
+    int start;
+    int count;
+    int instances;
+} GsDrawArraysInstancedCommand;
+
+typedef struct GsDrawIndexedInstancedCommand {
+    int count;
+    int instances;
+    int first_index;
+    int base_vertex;
+} GsDrawIndexedInstancedCommand;
+
+// used by GS_COMMAND_DRAW_INDIRECT (draw_count is always 1) and GS_COMMAND_MULTI_DRAW_INDIRECT
+typedef struct GsDrawIndirectCommand {
+    GsResourceId buffer;
+    int offset;
+    int draw_count;
+    int stride; // 0 when the draws are tightly packed
+    GS_BOOL indexed;
+} GsDrawIndirectCommand;
+
+// One draw inside a GS_BUFFER_TYPE_INDIRECT buffer, laid out the way GL reads it.
+typedef struct GsDrawArraysIndirectArgs {
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first;
+    uint32_t base_instance;
+} GsDrawArraysIndirectArgs;
+
+typedef struct GsDrawIndexedIndirectArgs {
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+    uint32_t base_instance;
+} GsDrawIndexedIndirectArgs;
+
 typedef struct GsScissorCommand {
     int x;
     int y;
@@ -482,13 +793,38 @@ typedef struct GsScissorCommand {
 typedef struct GsShader {
     GsShaderType type;
     void *handle;
+    GsResourceId id;
 } GsShader;
 
+// An active uniform or attribute found when the program linked. Arrays are stored once under their name without the
+// [0] suffix, location is the one of the first element and count the number of elements.
+typedef struct GsProgramVariable {
+    uint32_t hash;
+    char *name;
+    int location;
+    GsVariableType type;
+    int count;
+    GS_BOOL collided; // another variable of the program has the same hash, so the hash alone does not name this one
+} GsProgramVariable;
+
+// Open addressing table keyed by gs_hash_name, a slot without a name is empty.
+typedef struct GsProgramVariableTable {
+    GsProgramVariable *entries;
+    int capacity;
+    int count;
+} GsProgramVariableTable;
+
 typedef struct GsProgram {
     GsShader *vertex;
     GsShader *fragment;
     GS_BOOL completed;
     void *handle;
+    GsResourceId id;
+
+    // filled by the backend while linking, readable once the build fence passed
+    GsProgramVariableTable uniforms;
+    GsProgramVariableTable attributes;
+    uint64_t fence;
 } GsProgram;
 
 typedef struct GsTexture {
@@ -503,16 +839,21 @@ typedef struct GsTexture {
     GsTextureFilter mag;
     GsTextureType type;
     void *handle;
+    GsResourceId id;
+    int levels; // mip levels the backend declares, 1 unless the texture is streamed
+    int storage; // a bit per GsCubemapFace (GS_CUBEMAP_FACE_NONE for 2D), per level when streamed, whose storage the backend allocated
+    int pending_uploads; // asynchronous uploads not completed yet, see gs_texture_upload_pending
+    GsTextureStream *stream; // set by gs_create_streamed_texture
 } GsTexture;
 
 typedef struct GsCopyTextureCommand {
-    GsTexture *src;
-    GsTexture *dst;
+    GsResourceId src;
+    GsResourceId dst;
 } GsCopyTextureCommand;
 
 typedef struct GsCopyTexturePartialCommand {
-    GsTexture *src;
-    GsTexture *dst;
+    GsResourceId src;
+    GsResourceId dst;
     int src_x;
     int src_y;
     int dst_x;
@@ -522,28 +863,81 @@ typedef struct GsCopyTexturePartialCommand {
 } GsCopyTexturePartialCommand;
 
 typedef struct GsResolveTextureCommand {
-    GsTexture *src;
-    GsTexture *dst;
+    GsResourceId src;
+    GsResourceId dst;
 } GsResolveTextureCommand;
 
 typedef struct GsGenMipmapsCommand {
-    GsTexture *texture;
+    GsResourceId texture;
 } GsGenMipmapsCommand;
 
 typedef struct GsBeginRenderPassCommand {
-    GsRenderPass *pass;
+    GsResourceId pass;
 } GsBeginRenderPassCommand;
 
 typedef struct GsEndRenderPassCommand {
     int dummy;
 } GsEndRenderPassCommand;
 
+typedef struct GsExecuteBundleCommand {
+    GsResourceId bundle;
+} GsExecuteBundleCommand;
+
+// Payloads are only GS_COMMAND_ALIGNMENT aligned, so pointers inside them are stored split into words.
+typedef struct GsCommandPointer {
+    uint32_t words[sizeof(void*) / sizeof(uint32_t)];
+} GsCommandPointer;
+
+// Update payloads live in the list's data arena and are applied when the command executes.
+typedef struct GsUpdateBufferCommand {
+    GsResourceId buffer;
+    GS_BOOL partial; // write size bytes at offset, otherwise the buffer is respecified with size bytes
+    int offset;
+    int size;
+    GsCommandPointer data;
+} GsUpdateBufferCommand;
+
+typedef struct GsUpdateTextureCommand {
+    GsResourceId texture;
+    GsCubemapFace face;
+    int size;
+    GsCommandPointer data;
+} GsUpdateTextureCommand;
+
 // Textures
 GsTexture *gs_create_texture(int width, int height, GsTextureFormat format, GsTextureWrap wrap_s, GsTextureWrap wrap_t, GsTextureFilter min, GsTextureFilter mag);
 GsTexture *gs_create_cubemap(int width, int height, GsTextureFormat format, GsTextureWrap wrap_s, GsTextureWrap wrap_t, GsTextureWrap wrap_r, GsTextureFilter min, GsTextureFilter mag);
 void gs_texture_set_data(GsTexture *texture, void *data);
 void gs_texture_set_face_data(GsTexture *texture, GsCubemapFace face, void *data);
 void gs_texture_generate_mipmaps(GsTexture *texture);
+
+// Asynchronous texture uploads
+// gs_texture_upload_async copies width x height texels of data (tightly packed rows in the texture's format) and queues
+// them for the rectangle at x, y of face (GS_CUBEMAP_FACE_NONE for 2D textures). gs_frame issues the queued uploads
+// highest priority first, equal priorities in call order, until config->texture_upload_budget bytes were issued. The
+// pixels are staged in a fenced unpack buffer ring so neither thread waits on the driver. The texture can be drawn
+// meanwhile, the rectangle keeps its old contents (undefined before the first upload) until the upload was issued.
+// gs_texture_upload_pending is TRUE until every upload to the texture completed on the GPU.
+void gs_texture_upload_async(GsTexture *texture, GsCubemapFace face, int x, int y, int width, int height, const void *data, int priority);
+GS_BOOL gs_texture_upload_pending(const GsTexture *texture);
+
+// Streamed textures (streaming needs GS_CAPABILITY_TEXTURE_STREAMING)
+// gs_create_streamed_texture declares the full mip chain of a 2D texture, nothing is sampled until its smallest level
+// arrived. gs_texture_set_level_data keeps a copy of a level (max(1, width >> level) x max(1, height >> level) texels),
+// gs_frame uploads the levels the texture should hold through the asynchronous uploads, coarsest first across all
+// textures, and lowers the sampled base level as soon as the next finer level completed. The levels it should hold
+// follow gs_texture_set_stream_hint: screen_size is the number of pixels the larger side of the texture covers on
+// screen (0 when it is not visible, which keeps only the smallest level), the finest level that still has a texel per
+// pixel is the one wanted. Levels no longer wanted stop being sampled and their storage is released. priority orders
+// the uploads of equally coarse levels of different textures. gs_texture_get_resident_level is the finest level sampled,
+// texture->levels while none is. Without the capability the texture is a plain mipmapped one: every level is uploaded
+// as soon as it is given, the hint is ignored and the resident level is always 0.
+GsTexture *gs_create_streamed_texture(int width, int height, GsTextureFormat format, GsTextureWrap wrap_s, GsTextureWrap wrap_t, GsTextureFilter min, GsTextureFilter mag);
+void gs_texture_set_level_data(GsTexture *texture, int level, const void *data);
+void gs_texture_set_stream_hint(GsTexture *texture, float screen_size, int priority);
+int gs_texture_get_resident_level(const GsTexture *texture);
+
+int gs_get_texture_format_size(GsTextureFormat format);
 void gs_texture_clear(GsTexture *texture);
 void gs_destroy_texture(GsTexture *texture);
 
@@ -560,6 +954,13 @@ GsProgram *gs_create_program();
 void gs_program_attach_shader(GsProgram *program, GsShader *shader);
 void gs_program_build(GsProgram *program);
 GsUniformLocation gs_get_uniform_location(GsProgram *program, const char *name);
+uint32_t gs_hash_name(const char *name);
+const GsProgramVariable *gs_program_find_uniform(GsProgram *program, uint32_t hash);
+const GsProgramVariable *gs_program_find_attribute(GsProgram *program, uint32_t hash);
+GsUniformLocation gs_get_uniform_location_hashed(GsProgram *program, uint32_t hash);
+void gs_program_add_uniform(GsProgram *program, const char *name, int location, GsVariableType type, int count);
+void gs_program_add_attribute(GsProgram *program, const char *name, int location, GsVariableType type, int count);
+void gs_program_set_uniform_block(GsProgram *program, const char *name, int binding);
 void gs_destroy_program(GsProgram *program);
 
 // Pipeline
@@ -577,16 +978,41 @@ GsBuffer *gs_create_buffer(GsBufferType type, GsBufferIntent intent);
 void gs_destroy_buffer(GsBuffer *buffer);
 void gs_buffer_set_data(GsBuffer *buffer, void *data, int size);
 void gs_buffer_set_partial_data(GsBuffer *buffer, void *data, int size, int offset);
-GsUnmanagedBufferData *gs_buffer_get_data(GsBuffer *buffer, int offset, int size);
+void gs_buffer_set_index_type(GsBuffer *buffer, GsIndexType type);
+GsUnmanagedBufferData *gs_buffer_get_data(GsBuffer *buffer, int offset, int size); // blocks until the GPU caught up, see gs_buffer_read_async
 void gs_destroy_unmanaged_buffer_data(GsUnmanagedBufferData *data);
 
+// Readback (needs GS_CAPABILITY_READBACK)
+// gs_buffer_read_async queues a copy of size bytes at offset into staging storage and returns at once. The copy runs
+// behind everything submitted so far, so it sees what the frames before it wrote. gs_readback_poll tells whether the
+// GPU is done without waiting, gs_readback_wait blocks until it is, and gs_readback_get_data waits when needed and
+// returns the bytes, valid until gs_destroy_readback. None of them drain the pipeline, only the copy is waited on.
+GsReadback *gs_buffer_read_async(GsBuffer *buffer, int offset, int size);
+GS_BOOL gs_readback_poll(GsReadback *readback);
+void gs_readback_wait(GsReadback *readback);
+const void *gs_readback_get_data(GsReadback *readback);
+void gs_destroy_readback(GsReadback *readback);
+
+// gs_read_texture_async reads a rectangle of a 2D color texture the same way, tightly packed in the texture's format.
+// The result arrives at a later gs_frame once the copy completed: it is copied to dst when that isn't NULL, then
+// callback is called when that isn't NULL, both on the calling thread. GLES2 has no pack buffers and reads at once, the
+// delivery still waits for gs_frame. Reads still pending at gs_shutdown are waited on and delivered there.
+void gs_read_texture_async(GsTexture *texture, int x, int y, int width, int height, void *dst, GsTextureReadCallback callback, void *user);
+
 // Command list
 GsCommandList *gs_create_command_list();
 void gs_command_list_begin(GsCommandList *list);
 void gs_command_list_add(GsCommandList *list, GsCommandType type, void *data, int size);
+void* gs_command_list_push(GsCommandList *list, GsCommandType type, int size);
 void gs_command_list_clear(GsCommandList *list);
+void gs_command_list_iter_begin(const GsCommandList *list, GsCommandIterator *iterator);
+const GsCommandHeader *gs_command_list_iter_next(GsCommandIterator *iterator);
 void* gs_command_list_alloc(GsCommandList *list, int size);
 void gs_command_list_alloc_reset(GsCommandList *list);
+void gs_command_list_trim(GsCommandList *list);
+GsCommandListStats gs_command_list_get_stats(GsCommandList *list);
+GsCommandPointer gs_command_pointer(void *pointer);
+void *gs_command_pointer_get(GsCommandPointer pointer);
 void gs_clear(GsCommandList *list, GsClearFlags flags, float r, float g, float b, float a);
 void gs_set_viewport(GsCommandList *list, int x, int y, int width, int height);
 void gs_use_pipeline(GsCommandList *list, GsPipeline *pipeline);
@@ -596,43 +1022,145 @@ void gs_set_scissor(GsCommandList *list, int x, int y, int width, int height);
 void gs_disable_scissor(GsCommandList *list);
 void gs_draw_arrays(GsCommandList *list, int start, int count);
 void gs_draw_indexed(GsCommandList *list, int count);
+void gs_draw_indexed_base_vertex(GsCommandList *list, int count, int first_index, int base_vertex); // base_vertex is added to every index
 void gs_uniform_set_int(GsCommandList *list, GsUniformLocation location, int value);
 void gs_uniform_set_float(GsCommandList *list, GsUniformLocation location, float value);
 void gs_uniform_set_vec2(GsCommandList *list, GsUniformLocation location, float x, float y);
 void gs_uniform_set_vec3(GsCommandList *list, GsUniformLocation location, float x, float y, float z);
 void gs_uniform_set_vec4(GsCommandList *list, GsUniformLocation location, float x, float y, float z, float w);
 void gs_uniform_set_mat4(GsCommandList *list, GsUniformLocation location, float m00, float m01, float m02, float m03, float m10, float m11, float m12, float m13, float m20, float m21, float m22, float m23, float m30, float m31, float m32, float m33);
+void gs_uniform_set_floatv(GsCommandList *list, GsUniformLocation location, const float *data, int count);
+void gs_uniform_set_vec2v(GsCommandList *list, GsUniformLocation location, const float *data, int count);
+void gs_uniform_set_vec3v(GsCommandList *list, GsUniformLocation location, const float *data, int count);
+void gs_uniform_set_vec4v(GsCommandList *list, GsUniformLocation location, const float *data, int count);
+void gs_uniform_set_mat3v(GsCommandList *list, GsUniformLocation location, const float *data, int count); // row-major, 9 floats each
+void gs_uniform_set_mat4v(GsCommandList *list, GsUniformLocation location, const float *data, int count); // row-major, 16 floats each
 void gs_copy_texture(GsCommandList *list, GsTexture *src, GsTexture *dst);
 void gs_resolve_texture(GsCommandList *list, GsTexture *src, GsTexture *dst);
 void gs_copy_texture_partial(GsCommandList *list, GsTexture *src, GsTexture *dst, int src_x, int src_y, int dst_x, int dst_y, int width, int height);
 void gs_generate_mipmaps(GsCommandList *list, GsTexture *texture);
+void gs_use_uniform_block(GsCommandList *list, int binding, GsBuffer *buffer, int offset, int size);
+void gs_use_uniform_data(GsCommandList *list, int binding, const void *data, int size);
 void gs_begin_render_pass(GsCommandList *list, GsRenderPass *pass);
 void gs_end_render_pass(GsCommandList *list);
+
+// Instancing (needs GS_CAPABILITY_INSTANCING)
+// Layout items added with gs_layout_add_instanced are read from the buffer bound with gs_use_instance_buffer, packed
+// with their own instance_stride, and advance once every divisor instances.
+void gs_use_instance_buffer(GsCommandList *list, GsBuffer *buffer);
+void gs_draw_arrays_instanced(GsCommandList *list, int start, int count, int instances);
+void gs_draw_indexed_instanced(GsCommandList *list, int count, int instances);
+void gs_draw_indexed_instanced_base_vertex(GsCommandList *list, int count, int first_index, int base_vertex, int instances);
+
+// Vertex streams
+// Items added with gs_layout_add_stream are read from their own vertex buffer, packed with the stride of that stream,
+// so attributes that change at different rates can be updated separately and passes can fetch only what they read.
+// Stream 0 is the buffer bound with gs_use_buffer, the others are bound with gs_use_vertex_stream. A stream with a
+// divisor advances once every divisor instances instead of once per vertex.
+void gs_use_vertex_stream(GsCommandList *list, int stream, GsBuffer *buffer);
+
+// Indirect draws
+// Parameters are GsDrawArraysIndirectArgs or GsDrawIndexedIndirectArgs read from a GS_BUFFER_TYPE_INDIRECT buffer at
+// offset, a stride of 0 means tightly packed. Without GS_CAPABILITY_MULTI_DRAW_INDIRECT the backend reads them from a
+// CPU copy of the buffer and issues one draw each; base_instance must be 0 there.
+void gs_draw_arrays_indirect(GsCommandList *list, GsBuffer *buffer, int offset);
+void gs_draw_indexed_indirect(GsCommandList *list, GsBuffer *buffer, int offset);
+void gs_multi_draw_arrays_indirect(GsCommandList *list, GsBuffer *buffer, int offset, int draw_count, int stride);
+void gs_multi_draw_indexed_indirect(GsCommandList *list, GsBuffer *buffer, int offset, int draw_count, int stride);
+
 void gs_command_list_end(GsCommandList *list);
+void gs_command_list_set_order(GsCommandList *list, uint32_t key);
 void gs_command_list_submit(GsCommandList *list);
 void gs_destroy_command_list(GsCommandList *list);
 
+// Deferred updates
+// gs_update_* apply in stream order when the list executes instead of right away. The data is copied into the list,
+// unless it already came from gs_command_list_alloc on the same list, then it is referenced. When a later full update
+// replaces the same buffer or texture face before anything reads it, gs_command_list_end drops the earlier one.
+void gs_update_buffer(GsCommandList *list, GsBuffer *buffer, void *data, int size);
+void gs_update_buffer_partial(GsCommandList *list, GsBuffer *buffer, void *data, int size, int offset);
+void gs_update_texture(GsCommandList *list, GsTexture *texture, void *data);
+void gs_update_texture_face(GsCommandList *list, GsTexture *texture, GsCubemapFace face, void *data);
+
+// Stream buffers
+// gs_buffer_set_stream_capacity turns a GS_BUFFER_INTENT_DRAW_STREAM buffer into a ring that dynamic data is
+// suballocated from. gs_buffer_stream_alloc returns memory for size bytes that the caller fills right away, and its
+// offset in the buffer for the draws of the current frame (first vertex, base vertex, first index or uniform block
+// offset). With GS_CAPABILITY_PERSISTENT_MAPPING that memory is the mapped buffer itself, nothing is copied and every
+// frame's part of the ring is fenced, gs_frame gives the parts the GPU is done with back. An allocation that reaches a
+// part the GPU may still read returns NULL instead of waiting, so it is safe on recording threads, the caller draws
+// that data from elsewhere or sizes the ring for a few frames. Without, allocations are staged and gs_frame uploads
+// them with one respecification, which orphans the storage of the previous frame. The capacity has to hold at least
+// one frame. The ring replaces gs_buffer_set_data and gs_update_buffer for the buffer.
+void gs_buffer_set_stream_capacity(GsBuffer *buffer, int capacity);
+void *gs_buffer_stream_alloc(GsBuffer *buffer, int size, int alignment, int *offset);
+
+// Uniform buffers (needs GS_CAPABILITY_UNIFORM_BUFFERS)
+// Buffers of GS_BUFFER_TYPE_UNIFORM are bound to binding points with gs_use_uniform_block, a program reads a binding
+// point through the block assigned to it with gs_program_set_uniform_block. Data that changes every frame goes into
+// the uniform ring instead: gs_push_uniform_data copies it and returns its offset in gs_get_uniform_ring, and the whole
+// ring is uploaded in one go by the next gs_frame. Pushed data is only valid for that frame, so lists and bundles that
+// are submitted again have to push again. gs_use_uniform_data pushes and binds in one call.
+int gs_push_uniform_data(const void *data, int size);
+GsBuffer *gs_get_uniform_ring();
+
+// Draw sorting
+// In sorted mode draws between two non-draw commands (clear, viewport, scissor, passes, copies, bundles) are reordered by
+// their sort key in gs_command_list_end. Each draw keeps the pipeline, buffers and textures that were bound when it was
+// recorded, plus the uniform commands recorded since the previous draw, so uniforms must be set per draw in this mode.
+void gs_command_list_set_sorting(GsCommandList *list, GS_BOOL enabled);
+void gs_set_sort_layer(GsCommandList *list, int layer);
+void gs_set_sort_depth(GsCommandList *list, float depth);
+uint64_t gs_make_sort_key(int layer, GS_BOOL translucent, GsResourceId pipeline, GsResourceId program, GsResourceId texture, float depth);
+
+// Bundles (state bound inside a bundle remains bound after it executes)
+GsCommandList *gs_create_bundle();
+void gs_execute_bundle(GsCommandList *list, GsCommandList *bundle);
+
 // Vertex Layout
 GS_BOOL gs_layout_add(GsVtxLayout *layout, int index, GsVtxAttribType type, int count);
+GS_BOOL gs_layout_add_instanced(GsVtxLayout *layout, int index, GsVtxAttribType type, int count, int divisor);
+GS_BOOL gs_layout_add_stream(GsVtxLayout *layout, int stream, int index, GsVtxAttribType type, int count);
+void gs_layout_set_stream_divisor(GsVtxLayout *layout, int stream, int divisor);
+void gs_layout_set_normalized(GsVtxLayout *layout, int index, GS_BOOL normalized);
+void gs_layout_set_integer(GsVtxLayout *layout, int index, GS_BOOL integer); // needs GS_CAPABILITY_PACKED_ATTRIBUTES
+const GsVtxLayoutItem *gs_layout_find_item(const GsVtxLayout *layout, int index);
 GsVtxLayout *gs_create_layout();
 void gs_destroy_layout(GsVtxLayout *layout);
 void gs_layout_build(GsVtxLayout *layout);
 
+// Resources
+GsResourceId gs_register_resource(void *resource, GsResourceType type);
+void gs_unregister_resource(GsResourceId id);
+void *gs_get_resource(GsResourceId id, GsResourceType type);
+GsResourceType gs_get_resource_type(GsResourceId id);
+
 // Global
 GS_BOOL gs_init(GsConfig *config);
-void gs_handle_internal_command(GsCommandListItem item);
+void gs_handle_internal_command(const GsCommandHeader *header);
 void gs_shutdown();
 void gs_discard_frame();
 void gs_frame();
+void gs_finish(); // waits until the render thread executed everything queued so far, returns at once without one
+
+// Frame allocator
+// Scratch memory that stays valid until the end of the next gs_frame or gs_discard_frame, then it is reclaimed at once.
+// Meant for per-frame upload data such as dynamic vertices passed to gs_buffer_set_partial_data. With a render thread
+// data from here is handed over without the copy other memory needs.
+void *gs_frame_alloc(int size);
+void *gs_frame_alloc_aligned(int size, int alignment);
+GsFrameAllocatorStats gs_get_frame_allocator_stats();
 
 // Config
 void gs_destroy_config(GsConfig *config);
 GsConfig *gs_create_config();
+GsConfig *gs_get_active_config();
 
 // Backend
 GsBackend *gs_create_backend(GsBackendType type);
 void gs_destroy_backend(GsBackend *backend);
 GsBackendType gs_get_optimal_backend_type();
+GsBackendStats gs_get_backend_stats(); // with a render thread call gs_finish first for counts that include everything submitted
 
 // caps
 GS_BOOL gs_has_capability(GsCapability capability);
@@ -0,0 +1,1658 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200809L // clock_gettime
+#endif
+
+#include "genesis.h"
+#include "genesis_capture.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define GS_CAPTURE_MMAP
+#endif
+
+// File layout: GsCaptureFileHeader, then records. Every record is a GsCaptureRecord followed by its payload, padded to
+// GS_CAPTURE_RECORD_ALIGNMENT. Resources come before anything that refers to them, command lists come last in the
+// order they were executed. Captures store native struct layouts and are meant to be replayed on the same platform.
+#define GS_CAPTURE_RECORD_ALIGNMENT 8
+#define GS_CAPTURE_RECORD_LIST 0x100
+#define GS_CAPTURE_MAX_ATTACHMENTS 8
+
+typedef struct GsCaptureFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_count;
+    uint32_t max_id; // largest resource id referenced by the frame
+} GsCaptureFileHeader;
+
+typedef struct GsCaptureRecord {
+    uint32_t type; // GsResourceType or GS_CAPTURE_RECORD_LIST
+    uint32_t id;
+    uint32_t size; // payload size, excluding padding
+    uint32_t reserved;
+} GsCaptureRecord;
+
+typedef struct GsCaptureShaderRecord {
+    int32_t type;
+    int32_t source_size; // including the terminator, 0 when the source was not shadowed
+} GsCaptureShaderRecord;
+
+typedef struct GsCaptureProgramRecord {
+    uint32_t vertex;
+    uint32_t fragment;
+    int32_t completed;
+    int32_t uniform_count; // followed by GsCaptureUniformRecord entries
+    int32_t block_count; // followed by GsCaptureUniformBlockRecord entries, after the uniforms
+} GsCaptureProgramRecord;
+
+typedef struct GsCaptureUniformRecord {
+    int32_t location;
+    int32_t name_size; // including the terminator, the name is padded to 4 bytes
+} GsCaptureUniformRecord;
+
+typedef struct GsCaptureUniformBlockRecord {
+    int32_t binding;
+    int32_t name_size; // including the terminator, the name is padded to 4 bytes
+} GsCaptureUniformBlockRecord;
+
+typedef struct GsCaptureLayoutRecord {
+    int32_t count; // followed by GsCaptureLayoutItemRecord entries
+    int32_t completed;
+} GsCaptureLayoutRecord;
+
+typedef struct GsCaptureLayoutItemRecord {
+    int32_t index;
+    int32_t type;
+    int32_t components;
+    int32_t normalized;
+    int32_t integer;
+    int32_t divisor;
+    int32_t stream;
+} GsCaptureLayoutItemRecord;
+
+typedef struct GsCaptureBufferRecord {
+    int32_t type;
+    int32_t intent;
+    int32_t index_type;
+    int32_t data_size; // followed by the shadowed contents
+} GsCaptureBufferRecord;
+
+typedef struct GsCaptureTextureRecord {
+    int32_t width;
+    int32_t height;
+    int32_t format;
+    int32_t wrap_s;
+    int32_t wrap_t;
+    int32_t wrap_r;
+    int32_t min;
+    int32_t mag;
+    int32_t type;
+    float lod_bias;
+    uint32_t faces; // faces with data, each followed in order by width * height pixels
+    int32_t mipmaps;
+    int32_t levels; // mip chain of a streamed texture, 0 otherwise
+    uint32_t level_mask; // streamed levels with data, each followed in order by its pixels after the faces
+    float screen_size; // stream hint
+    int32_t priority;
+} GsCaptureTextureRecord;
+
+typedef struct GsCaptureFramebufferRecord {
+    int32_t width;
+    int32_t height;
+    int32_t attachment_count; // followed by GsCaptureAttachmentRecord entries
+} GsCaptureFramebufferRecord;
+
+typedef struct GsCaptureAttachmentRecord {
+    uint32_t texture;
+    int32_t type;
+} GsCaptureAttachmentRecord;
+
+typedef struct GsCaptureRenderPassRecord {
+    uint32_t framebuffer;
+} GsCaptureRenderPassRecord;
+
+typedef struct GsCapturePipelineRecord {
+    uint32_t layout;
+    uint32_t program;
+    int32_t primitive_type;
+    int32_t msaa_samples;
+    int32_t blend_op;
+    int32_t blend_src;
+    int32_t blend_dst;
+    int32_t blend_op_alpha;
+    int32_t blend_src_alpha;
+    int32_t blend_dst_alpha;
+    int32_t blend_enabled;
+    int32_t cull_face;
+    int32_t cull_front;
+    int32_t stencil_test;
+    int32_t depth_func;
+    int32_t depth_write;
+    int32_t depth_test;
+} GsCapturePipelineRecord;
+
+// bundles and submitted lists
+typedef struct GsCaptureStreamRecord {
+    uint32_t order_key;
+    int32_t command_count;
+    int32_t stream_size; // followed by the packed commands
+    int32_t data_size; // followed by the update payloads, commands point at them by offset
+} GsCaptureStreamRecord;
+
+typedef struct GsCaptureAttachment {
+    GsResourceId texture;
+    GsFramebufferAttachmentType type;
+} GsCaptureAttachment;
+
+typedef struct GsCaptureUniform {
+    char *name;
+    GsUniformLocation location;
+} GsCaptureUniform;
+
+typedef struct GsCaptureUniformBlock {
+    char *name;
+    int binding;
+} GsCaptureUniformBlock;
+
+typedef struct GsCaptureShadow {
+    unsigned char *data; // buffer contents, or texture faces stored one after another
+    int size;
+    char *source;
+    uint32_t faces;
+    GS_BOOL mipmaps;
+    unsigned char *level_data; // streamed texture levels stored one after another, finest first
+    uint32_t level_mask;
+    GS_BOOL hinted;
+    float screen_size;
+    int priority;
+    GsCaptureAttachment attachments[GS_CAPTURE_MAX_ATTACHMENTS];
+    int attachment_count;
+    GsCaptureUniform *uniforms;
+    int uniform_count;
+    int uniform_capacity;
+    GsCaptureUniformBlock *blocks;
+    int block_count;
+    int block_capacity;
+} GsCaptureShadow;
+
+typedef struct GsCaptureBytes {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} GsCaptureBytes;
+
+typedef struct GsCaptureWriter {
+    FILE *file;
+    GsCaptureBytes payload;
+    uint32_t record_count;
+    uint32_t max_id;
+    unsigned char *visited;
+    int visited_capacity;
+    GS_BOOL failed;
+} GsCaptureWriter;
+
+struct GsCapture {
+    const unsigned char *data;
+    size_t size;
+
+    #if defined(_WIN32)
+        HANDLE file;
+        HANDLE mapping;
+    #elif defined(GS_CAPTURE_MMAP)
+        int file;
+    #endif
+};
+
+typedef struct GsReplayProgram {
+    GsResourceId id;
+    GsUniformLocation *from;
+    GsUniformLocation *to;
+    int count;
+} GsReplayProgram;
+
+struct GsReplay {
+    GsCapture *capture;
+
+    // capture id to replay id
+    GsResourceId *remap;
+    uint32_t remap_count;
+
+    // resources in creation order, destroyed in reverse
+    GsResourceId *created;
+    int created_count;
+
+    GsCommandList **lists;
+    int list_count;
+    GsCommandList *scratch; // single command list for per-command timing
+
+    // uniform locations that moved between the capture and this backend
+    GsReplayProgram *programs;
+    int program_count;
+    GS_BOOL remap_uniforms;
+    GsResourceId pipeline_stack[16];
+    int pipeline_depth;
+
+    uint64_t *command_ns;
+    GsCommandType *command_types;
+    int command_capacity;
+    GsReplayStats stats;
+};
+
+static GS_BOOL shadowing = GS_FALSE;
+static GsCaptureShadow *shadows = NULL; // indexed by resource id
+static int shadow_capacity = 0;
+static char *capture_path = NULL;
+
+static uint64_t gs_capture_now_ns() {
+    #if defined(_WIN32)
+        LARGE_INTEGER frequency;
+        LARGE_INTEGER counter;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        return (uint64_t) ((double) counter.QuadPart * 1000000000.0 / (double) frequency.QuadPart);
+    #else
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+    #endif
+}
+
+static void *gs_capture_grow(void *data, int *capacity, const int needed, const int element_size) {
+    if (needed <= *capacity) {
+        return data;
+    }
+
+    int capacity_new = *capacity > 0 ? *capacity : 64;
+    while (capacity_new < needed) {
+        capacity_new *= 2;
+    }
+
+    unsigned char *grown = (unsigned char*)GS_REALLOC(data, (size_t) capacity_new * element_size);
+    GS_ASSERT(grown != NULL);
+
+    GS_MEMSET(grown + (size_t) *capacity * element_size, 0, (size_t) (capacity_new - *capacity) * element_size);
+    *capacity = capacity_new;
+
+    return grown;
+}
+
+static char *gs_capture_copy_string(const char *string) {
+    const size_t size = strlen(string) + 1;
+    char *copy = (char*)GS_MALLOC(size);
+    memcpy(copy, string, size);
+
+    return copy;
+}
+
+// Offsets of the resource ids inside a command payload.
+static int gs_capture_command_ids(const GsCommandType type, int offsets[2]) {
+    switch (type) {
+        case GS_COMMAND_USE_PIPELINE:
+            offsets[0] = (int) offsetof(GsPipelineCommand, pipeline);
+            return 1;
+        case GS_COMMAND_USE_BUFFER:
+            offsets[0] = (int) offsetof(GsUseBufferCommand, buffer);
+            return 1;
+        case GS_COMMAND_USE_TEXTURE:
+            offsets[0] = (int) offsetof(GsTextureCommand, texture);
+            return 1;
+        case GS_COMMAND_COPY_TEXTURE:
+            offsets[0] = (int) offsetof(GsCopyTextureCommand, src);
+            offsets[1] = (int) offsetof(GsCopyTextureCommand, dst);
+            return 2;
+        case GS_COMMAND_COPY_TEXTURE_PARTIAL:
+            offsets[0] = (int) offsetof(GsCopyTexturePartialCommand, src);
+            offsets[1] = (int) offsetof(GsCopyTexturePartialCommand, dst);
+            return 2;
+        case GS_COMMAND_RESOLVE_TEXTURE:
+            offsets[0] = (int) offsetof(GsResolveTextureCommand, src);
+            offsets[1] = (int) offsetof(GsResolveTextureCommand, dst);
+            return 2;
+        case GS_COMMAND_GEN_MIPMAPS:
+            offsets[0] = (int) offsetof(GsGenMipmapsCommand, texture);
+            return 1;
+        case GS_COMMAND_BEGIN_PASS:
+            offsets[0] = (int) offsetof(GsBeginRenderPassCommand, pass);
+            return 1;
+        case GS_COMMAND_EXECUTE_BUNDLE:
+            offsets[0] = (int) offsetof(GsExecuteBundleCommand, bundle);
+            return 1;
+        case GS_COMMAND_UPDATE_BUFFER:
+            offsets[0] = (int) offsetof(GsUpdateBufferCommand, buffer);
+            return 1;
+        case GS_COMMAND_UPDATE_TEXTURE:
+            offsets[0] = (int) offsetof(GsUpdateTextureCommand, texture);
+            return 1;
+        case GS_COMMAND_USE_UNIFORM_BLOCK:
+            offsets[0] = (int) offsetof(GsUniformBlockCommand, buffer);
+            return 1;
+        case GS_COMMAND_USE_INSTANCE_BUFFER:
+            offsets[0] = (int) offsetof(GsUseBufferCommand, buffer);
+            return 1;
+        case GS_COMMAND_USE_VERTEX_STREAM:
+            offsets[0] = (int) offsetof(GsUseVertexStreamCommand, buffer);
+            return 1;
+        case GS_COMMAND_DRAW_INDIRECT:
+        case GS_COMMAND_MULTI_DRAW_INDIRECT:
+            offsets[0] = (int) offsetof(GsDrawIndirectCommand, buffer);
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Offsets of the data pointer and its size inside commands that carry a payload in the list's data arena.
+static GS_BOOL gs_capture_command_data(const GsCommandType type, int *data_offset, int *size_offset) {
+    switch (type) {
+        case GS_COMMAND_UPDATE_BUFFER:
+            *data_offset = (int) offsetof(GsUpdateBufferCommand, data);
+            *size_offset = (int) offsetof(GsUpdateBufferCommand, size);
+            return GS_TRUE;
+        case GS_COMMAND_UPDATE_TEXTURE:
+            *data_offset = (int) offsetof(GsUpdateTextureCommand, data);
+            *size_offset = (int) offsetof(GsUpdateTextureCommand, size);
+            return GS_TRUE;
+        default:
+            return GS_FALSE;
+    }
+}
+
+static GsCaptureShadow *gs_capture_find_shadow(const GsResourceId id) {
+    if ((int) id >= shadow_capacity) {
+        return NULL;
+    }
+
+    return &shadows[id];
+}
+
+static GsCaptureShadow *gs_capture_get_shadow(const GsResourceId id) {
+    GS_ASSERT(id != GS_INVALID_RESOURCE_ID);
+
+    shadows = (GsCaptureShadow*)gs_capture_grow(shadows, &shadow_capacity, (int) id + 1, sizeof(GsCaptureShadow));
+    return &shadows[id];
+}
+
+void gs_capture_set_shadowing(const GS_BOOL enabled) {
+    shadowing = enabled;
+}
+
+GS_BOOL gs_capture_is_shadowing() {
+    return shadowing;
+}
+
+void gs_capture_shadow_shader(const GsShader *shader, const char *source) {
+    if (!shadowing || source == NULL) {
+        return;
+    }
+
+    GsCaptureShadow *shadow = gs_capture_get_shadow(shader->id);
+    GS_FREE(shadow->source);
+    shadow->source = gs_capture_copy_string(source);
+}
+
+void gs_capture_shadow_buffer(const GsBuffer *buffer, const void *data, const int size, const int offset, const GS_BOOL partial) {
+    if (!shadowing) {
+        return;
+    }
+
+    GsCaptureShadow *shadow = gs_capture_get_shadow(buffer->id);
+    const int end = offset + size;
+
+    if (!partial || end > shadow->size) {
+        const int size_new = partial ? end : size;
+        unsigned char *grown = (unsigned char*)GS_REALLOC(shadow->data, size_new);
+        GS_ASSERT(grown != NULL);
+
+        if (partial) {
+            GS_MEMSET(grown + shadow->size, 0, size_new - shadow->size);
+        }
+
+        shadow->data = grown;
+        shadow->size = size_new;
+    }
+
+    memcpy(shadow->data + offset, data, size);
+}
+
+void gs_capture_shadow_texture(const GsTexture *texture, const GsCubemapFace face, const void *data) {
+    gs_capture_shadow_texture_rect(texture, face, 0, 0, texture->width, texture->height, data);
+}
+
+void gs_capture_shadow_texture_rect(const GsTexture *texture, const GsCubemapFace face, const int x, const int y, const int width, const int height, const void *data) {
+    if (!shadowing) {
+        return;
+    }
+
+    GsCaptureShadow *shadow = gs_capture_get_shadow(texture->id);
+    const int texel_size = gs_get_texture_format_size(texture->format);
+    const int face_size = texture->width * texture->height * texel_size;
+    const int face_count = texture->type == GS_TEXTURE_TYPE_CUBEMAP ? 6 : 1;
+    const int index = texture->type == GS_TEXTURE_TYPE_CUBEMAP ? (int) face : 0;
+    GS_ASSERT(index >= 0 && index < face_count);
+
+    if (shadow->data == NULL) {
+        shadow->size = face_size * face_count;
+        shadow->data = (unsigned char*)GS_MALLOC(shadow->size);
+        GS_ASSERT(shadow->data != NULL);
+        GS_MEMSET(shadow->data, 0, shadow->size); // what a rectangle leaves out is replayed as zeroes
+    }
+
+    unsigned char *dst = shadow->data + (size_t) index * face_size + ((size_t) y * texture->width + x) * texel_size;
+    const unsigned char *src = (const unsigned char*)data;
+    for (int row = 0; row < height; row++) {
+        memcpy(dst + (size_t) row * texture->width * texel_size, src + (size_t) row * width * texel_size, (size_t) width * texel_size);
+    }
+
+    shadow->faces |= 1u << index;
+}
+
+static int gs_capture_level_size(const int width, const int height, const GsTextureFormat format, const int level) {
+    const int level_width = (width >> level) > 0 ? width >> level : 1;
+    const int level_height = (height >> level) > 0 ? height >> level : 1;
+    return level_width * level_height * gs_get_texture_format_size(format);
+}
+
+static int gs_capture_level_offset(const int width, const int height, const GsTextureFormat format, const int level) {
+    int offset = 0;
+    for (int i = 0; i < level; i++) {
+        offset += gs_capture_level_size(width, height, format, i);
+    }
+
+    return offset;
+}
+
+void gs_capture_shadow_texture_level(const GsTexture *texture, const int level, const void *data) {
+    if (!shadowing) {
+        return;
+    }
+
+    GsCaptureShadow *shadow = gs_capture_get_shadow(texture->id);
+
+    if (shadow->level_data == NULL) {
+        shadow->level_data = (unsigned char*)GS_MALLOC(gs_capture_level_offset(texture->width, texture->height, texture->format, texture->levels));
+        GS_ASSERT(shadow->level_data != NULL);
+    }
+
+    const int offset = gs_capture_level_offset(texture->width, texture->height, texture->format, level);
+    memcpy(shadow->level_data + offset, data, gs_capture_level_size(texture->width, texture->height, texture->format, level));
+    shadow->level_mask |= 1u << level;
+}
+
+void gs_capture_shadow_texture_stream(const GsTexture *texture, const float screen_size, const int priority) {
+    if (!shadowing) {
+        return;
+    }
+
+    GsCaptureShadow *shadow = gs_capture_get_shadow(texture->id);
+    shadow->hinted = GS_TRUE;
+    shadow->screen_size = screen_size;
+    shadow->priority = priority;
+}
+
+void gs_capture_shadow_texture_mipmaps(const GsTexture *texture) {
+    if (!shadowing) {
+        return;
+    }
+
+    gs_capture_get_shadow(texture->id)->mipmaps = GS_TRUE;
+}
+
+void gs_capture_shadow_texture_clear(const GsTexture *texture) {
+    if (!shadowing) {
+        return;
+    }
+
+    GsCaptureShadow *shadow = gs_capture_get_shadow(texture->id);
+    shadow->faces = 0;
+    shadow->mipmaps = GS_FALSE;
+}
+
+void gs_capture_shadow_attachment(const GsFramebuffer *framebuffer, const GsTexture *texture, const GsFramebufferAttachmentType attachment) {
+    if (!shadowing) {
+        return;
+    }
+
+    GsCaptureShadow *shadow = gs_capture_get_shadow(framebuffer->id);
+
+    for (int i = 0; i < shadow->attachment_count; i++) {
+        if (shadow->attachments[i].type == attachment) {
+            shadow->attachments[i].texture = texture->id;
+            return;
+        }
+    }
+
+    GS_ASSERT(shadow->attachment_count < GS_CAPTURE_MAX_ATTACHMENTS);
+    shadow->attachments[shadow->attachment_count].texture = texture->id;
+    shadow->attachments[shadow->attachment_count].type = attachment;
+    shadow->attachment_count += 1;
+}
+
+void gs_capture_shadow_uniform(const GsProgram *program, const char *name, const GsUniformLocation location) {
+    if (!shadowing) {
+        return;
+    }
+
+    GsCaptureShadow *shadow = gs_capture_get_shadow(program->id);
+
+    for (int i = 0; i < shadow->uniform_count; i++) {
+        if (strcmp(shadow->uniforms[i].name, name) == 0) {
+            shadow->uniforms[i].location = location;
+            return;
+        }
+    }
+
+    shadow->uniforms = (GsCaptureUniform*)gs_capture_grow(shadow->uniforms, &shadow->uniform_capacity, shadow->uniform_count + 1, sizeof(GsCaptureUniform));
+    shadow->uniforms[shadow->uniform_count].name = gs_capture_copy_string(name);
+    shadow->uniforms[shadow->uniform_count].location = location;
+    shadow->uniform_count += 1;
+}
+
+void gs_capture_shadow_uniform_block(const GsProgram *program, const char *name, const int binding) {
+    if (!shadowing) {
+        return;
+    }
+
+    GsCaptureShadow *shadow = gs_capture_get_shadow(program->id);
+
+    for (int i = 0; i < shadow->block_count; i++) {
+        if (strcmp(shadow->blocks[i].name, name) == 0) {
+            shadow->blocks[i].binding = binding;
+            return;
+        }
+    }
+
+    shadow->blocks = (GsCaptureUniformBlock*)gs_capture_grow(shadow->blocks, &shadow->block_capacity, shadow->block_count + 1, sizeof(GsCaptureUniformBlock));
+    shadow->blocks[shadow->block_count].name = gs_capture_copy_string(name);
+    shadow->blocks[shadow->block_count].binding = binding;
+    shadow->block_count += 1;
+}
+
+static void gs_capture_shadow_stream(const GsCommandList *list) {
+    GsCommandIterator iterator;
+    gs_command_list_iter_begin(list, &iterator);
+
+    const GsCommandHeader *header;
+    while ((header = gs_command_list_iter_next(&iterator)) != NULL) {
+        switch (header->type) {
+            case GS_COMMAND_UPDATE_BUFFER: {
+                const GsUpdateBufferCommand *cmd = GS_COMMAND_DATA(header, GsUpdateBufferCommand);
+                gs_capture_shadow_buffer(gs_get_resource(cmd->buffer, GS_RESOURCE_TYPE_BUFFER), gs_command_pointer_get(cmd->data), cmd->size, cmd->offset, cmd->partial);
+                break;
+            }
+            case GS_COMMAND_UPDATE_TEXTURE: {
+                const GsUpdateTextureCommand *cmd = GS_COMMAND_DATA(header, GsUpdateTextureCommand);
+                gs_capture_shadow_texture(gs_get_resource(cmd->texture, GS_RESOURCE_TYPE_TEXTURE), cmd->face, gs_command_pointer_get(cmd->data));
+                break;
+            }
+            case GS_COMMAND_GEN_MIPMAPS:
+                gs_capture_shadow_texture_mipmaps(gs_get_resource(GS_COMMAND_DATA(header, GsGenMipmapsCommand)->texture, GS_RESOURCE_TYPE_TEXTURE));
+                break;
+            case GS_COMMAND_EXECUTE_BUNDLE:
+                gs_capture_shadow_stream(gs_get_resource(GS_COMMAND_DATA(header, GsExecuteBundleCommand)->bundle, GS_RESOURCE_TYPE_BUNDLE));
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// Deferred updates change resources only when their list executes, so the frame's lists are walked once it was drained.
+void gs_capture_shadow_updates(GsCommandList **lists, const int count) {
+    if (!shadowing) {
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        gs_capture_shadow_stream(lists[i]);
+    }
+}
+
+void gs_capture_forget(const GsResourceId id) {
+    GsCaptureShadow *shadow = gs_capture_find_shadow(id);
+    if (shadow == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < shadow->uniform_count; i++) {
+        GS_FREE(shadow->uniforms[i].name);
+    }
+
+    for (int i = 0; i < shadow->block_count; i++) {
+        GS_FREE(shadow->blocks[i].name);
+    }
+
+    GS_FREE(shadow->uniforms);
+    GS_FREE(shadow->blocks);
+    GS_FREE(shadow->source);
+    GS_FREE(shadow->data);
+    GS_FREE(shadow->level_data);
+    GS_MEMSET(shadow, 0, sizeof(GsCaptureShadow));
+}
+
+void gs_capture_next_frame(const char *path) {
+    GS_ASSERT(path != NULL);
+
+    GS_FREE(capture_path);
+    capture_path = gs_capture_copy_string(path);
+}
+
+GS_BOOL gs_capture_pending() {
+    return capture_path != NULL;
+}
+
+static void gs_capture_append(GsCaptureBytes *bytes, const void *data, const size_t size) {
+    if (bytes->size + size > bytes->capacity) {
+        size_t capacity_new = bytes->capacity > 0 ? bytes->capacity : 4096;
+        while (capacity_new < bytes->size + size) {
+            capacity_new *= 2;
+        }
+
+        unsigned char *grown = (unsigned char*)GS_REALLOC(bytes->data, capacity_new);
+        GS_ASSERT(grown != NULL);
+
+        bytes->data = grown;
+        bytes->capacity = capacity_new;
+    }
+
+    if (data != NULL) {
+        memcpy(bytes->data + bytes->size, data, size);
+    } else {
+        GS_MEMSET(bytes->data + bytes->size, 0, size);
+    }
+
+    bytes->size += size;
+}
+
+static void gs_capture_write(GsCaptureWriter *writer, const void *data, const size_t size) {
+    if (size > 0 && fwrite(data, 1, size, writer->file) != size) {
+        writer->failed = GS_TRUE;
+    }
+}
+
+static void gs_capture_write_record(GsCaptureWriter *writer, const uint32_t type, const GsResourceId id) {
+    static const unsigned char padding[GS_CAPTURE_RECORD_ALIGNMENT] = { 0 };
+
+    GsCaptureRecord record;
+    record.type = type;
+    record.id = id;
+    record.size = (uint32_t) writer->payload.size;
+    record.reserved = 0;
+
+    gs_capture_write(writer, &record, sizeof(GsCaptureRecord));
+    gs_capture_write(writer, writer->payload.data, writer->payload.size);
+    gs_capture_write(writer, padding, (GS_CAPTURE_RECORD_ALIGNMENT - writer->payload.size % GS_CAPTURE_RECORD_ALIGNMENT) % GS_CAPTURE_RECORD_ALIGNMENT);
+
+    writer->record_count += 1;
+    writer->payload.size = 0;
+}
+
+static void gs_capture_visit(GsCaptureWriter *writer, GsResourceId id);
+
+static void gs_capture_visit_stream(GsCaptureWriter *writer, const GsCommandList *list) {
+    GsCommandIterator iterator;
+    gs_command_list_iter_begin(list, &iterator);
+
+    const GsCommandHeader *header;
+    while ((header = gs_command_list_iter_next(&iterator)) != NULL) {
+        int offsets[2];
+        const int count = gs_capture_command_ids((GsCommandType) header->type, offsets);
+
+        for (int i = 0; i < count; i++) {
+            GsResourceId id;
+            memcpy(&id, (const unsigned char*)(header + 1) + offsets[i], sizeof(GsResourceId));
+            gs_capture_visit(writer, id);
+        }
+    }
+}
+
+static void gs_capture_append_stream(GsCaptureWriter *writer, const GsCommandList *list) {
+    GsCaptureStreamRecord record;
+    record.order_key = list->order_key;
+    record.command_count = 0;
+    record.stream_size = 0;
+    record.data_size = 0;
+
+    GsCaptureBytes side;
+    GS_MEMSET(&side, 0, sizeof(GsCaptureBytes));
+
+    const size_t start = writer->payload.size;
+    gs_capture_append(&writer->payload, &record, sizeof(GsCaptureStreamRecord));
+
+    GsCommandIterator iterator;
+    gs_command_list_iter_begin(list, &iterator);
+
+    // removed commands are skipped, the stream is stored packed
+    const GsCommandHeader *header;
+    while ((header = gs_command_list_iter_next(&iterator)) != NULL) {
+        const int stride = GS_COMMAND_STRIDE(header);
+        const size_t payload = writer->payload.size + sizeof(GsCommandHeader);
+        gs_capture_append(&writer->payload, header, sizeof(GsCommandHeader) + header->size);
+        gs_capture_append(&writer->payload, NULL, stride - sizeof(GsCommandHeader) - header->size);
+
+        // payloads follow the stream, the command keeps their offset in place of the pointer
+        int data_offset, size_offset;
+        if (gs_capture_command_data((GsCommandType) header->type, &data_offset, &size_offset)) {
+            const void *data;
+            int size;
+            memcpy(&data, writer->payload.data + payload + data_offset, sizeof(void*));
+            memcpy(&size, writer->payload.data + payload + size_offset, sizeof(int));
+
+            const uintptr_t offset = side.size;
+            memcpy(writer->payload.data + payload + data_offset, &offset, sizeof(uintptr_t));
+
+            gs_capture_append(&side, data, size);
+            gs_capture_append(&side, NULL, (GS_CAPTURE_RECORD_ALIGNMENT - size % GS_CAPTURE_RECORD_ALIGNMENT) % GS_CAPTURE_RECORD_ALIGNMENT);
+        }
+
+        record.command_count += 1;
+        record.stream_size += stride;
+    }
+
+    if (side.size > 0) {
+        gs_capture_append(&writer->payload, side.data, side.size);
+        record.data_size = (int32_t) side.size;
+    }
+
+    GS_FREE(side.data);
+    memcpy(writer->payload.data + start, &record, sizeof(GsCaptureStreamRecord));
+}
+
+// Writes a resource after everything it depends on.
+static void gs_capture_visit(GsCaptureWriter *writer, const GsResourceId id) {
+    if (id == GS_INVALID_RESOURCE_ID) {
+        return;
+    }
+
+    writer->visited = (unsigned char*)gs_capture_grow(writer->visited, &writer->visited_capacity, (int) id + 1, 1);
+    if (writer->visited[id]) {
+        return;
+    }
+
+    writer->visited[id] = 1;
+    if (id > writer->max_id) {
+        writer->max_id = id;
+    }
+
+    const GsResourceType type = gs_get_resource_type(id);
+    const GsCaptureShadow *shadow = gs_capture_find_shadow(id);
+    void *resource = gs_get_resource(id, type);
+
+    // dependencies first, the payload buffer is shared between records
+    switch (type) {
+        case GS_RESOURCE_TYPE_PROGRAM: {
+            const GsProgram *program = (const GsProgram*)resource;
+            gs_capture_visit(writer, program->vertex != NULL ? program->vertex->id : GS_INVALID_RESOURCE_ID);
+            gs_capture_visit(writer, program->fragment != NULL ? program->fragment->id : GS_INVALID_RESOURCE_ID);
+            break;
+        }
+        case GS_RESOURCE_TYPE_PIPELINE: {
+            const GsPipeline *pipeline = (const GsPipeline*)resource;
+            gs_capture_visit(writer, pipeline->layout != NULL ? pipeline->layout->id : GS_INVALID_RESOURCE_ID);
+            gs_capture_visit(writer, pipeline->program != NULL ? pipeline->program->id : GS_INVALID_RESOURCE_ID);
+            break;
+        }
+        case GS_RESOURCE_TYPE_RENDER_PASS: {
+            const GsRenderPass *pass = (const GsRenderPass*)resource;
+            gs_capture_visit(writer, pass->framebuffer != NULL ? pass->framebuffer->id : GS_INVALID_RESOURCE_ID);
+            break;
+        }
+        case GS_RESOURCE_TYPE_FRAMEBUFFER:
+            for (int i = 0; shadow != NULL && i < shadow->attachment_count; i++) {
+                gs_capture_visit(writer, shadow->attachments[i].texture);
+            }
+            break;
+        case GS_RESOURCE_TYPE_BUNDLE:
+            gs_capture_visit_stream(writer, (const GsCommandList*)resource);
+            break;
+        default:
+            break;
+    }
+
+    GsCaptureBytes *payload = &writer->payload;
+
+    switch (type) {
+        case GS_RESOURCE_TYPE_SHADER: {
+            const GsShader *shader = (const GsShader*)resource;
+            GsCaptureShaderRecord record;
+            record.type = shader->type;
+            record.source_size = shadow != NULL && shadow->source != NULL ? (int32_t) strlen(shadow->source) + 1 : 0;
+
+            gs_capture_append(payload, &record, sizeof(record));
+            gs_capture_append(payload, shadow != NULL ? shadow->source : NULL, record.source_size);
+            break;
+        }
+        case GS_RESOURCE_TYPE_PROGRAM: {
+            const GsProgram *program = (const GsProgram*)resource;
+            GsCaptureProgramRecord record;
+            record.vertex = program->vertex != NULL ? program->vertex->id : GS_INVALID_RESOURCE_ID;
+            record.fragment = program->fragment != NULL ? program->fragment->id : GS_INVALID_RESOURCE_ID;
+            record.completed = program->completed;
+            record.uniform_count = shadow != NULL ? shadow->uniform_count : 0;
+            record.block_count = shadow != NULL ? shadow->block_count : 0;
+            gs_capture_append(payload, &record, sizeof(record));
+
+            for (int i = 0; i < record.uniform_count; i++) {
+                GsCaptureUniformRecord uniform;
+                uniform.location = shadow->uniforms[i].location;
+                uniform.name_size = (int32_t) strlen(shadow->uniforms[i].name) + 1;
+
+                gs_capture_append(payload, &uniform, sizeof(uniform));
+                gs_capture_append(payload, shadow->uniforms[i].name, uniform.name_size);
+                gs_capture_append(payload, NULL, (4 - uniform.name_size % 4) % 4);
+            }
+
+            for (int i = 0; i < record.block_count; i++) {
+                GsCaptureUniformBlockRecord block;
+                block.binding = shadow->blocks[i].binding;
+                block.name_size = (int32_t) strlen(shadow->blocks[i].name) + 1;
+
+                gs_capture_append(payload, &block, sizeof(block));
+                gs_capture_append(payload, shadow->blocks[i].name, block.name_size);
+                gs_capture_append(payload, NULL, (4 - block.name_size % 4) % 4);
+            }
+            break;
+        }
+        case GS_RESOURCE_TYPE_LAYOUT: {
+            const GsVtxLayout *layout = (const GsVtxLayout*)resource;
+            GsCaptureLayoutRecord record;
+            record.count = layout->count;
+            record.completed = layout->completed;
+            gs_capture_append(payload, &record, sizeof(record));
+
+            for (int i = 0; i < layout->count; i++) {
+                GsCaptureLayoutItemRecord item;
+                item.index = layout->items[i].index;
+                item.type = layout->items[i].type;
+                item.components = layout->items[i].components;
+                item.normalized = layout->items[i].normalized;
+                item.integer = layout->items[i].integer;
+                item.divisor = layout->items[i].divisor;
+                item.stream = layout->items[i].stream;
+                gs_capture_append(payload, &item, sizeof(item));
+            }
+            break;
+        }
+        case GS_RESOURCE_TYPE_BUFFER: {
+            const GsBuffer *buffer = (const GsBuffer*)resource;
+            GsCaptureBufferRecord record;
+            record.type = buffer->type;
+            record.intent = buffer->intent;
+            record.index_type = buffer->index_type;
+            record.data_size = shadow != NULL ? shadow->size : 0;
+
+            gs_capture_append(payload, &record, sizeof(record));
+            gs_capture_append(payload, shadow != NULL ? shadow->data : NULL, record.data_size);
+            break;
+        }
+        case GS_RESOURCE_TYPE_TEXTURE: {
+            const GsTexture *texture = (const GsTexture*)resource;
+            GsCaptureTextureRecord record;
+            record.width = texture->width;
+            record.height = texture->height;
+            record.format = texture->format;
+            record.wrap_s = texture->wrap_s;
+            record.wrap_t = texture->wrap_t;
+            record.wrap_r = texture->wrap_r;
+            record.min = texture->min;
+            record.mag = texture->mag;
+            record.type = texture->type;
+            record.lod_bias = texture->lodBias;
+            record.faces = shadow != NULL ? shadow->faces : 0;
+            record.mipmaps = shadow != NULL ? shadow->mipmaps : GS_FALSE;
+            record.levels = texture->stream != NULL ? texture->levels : 0;
+            record.level_mask = texture->stream != NULL && shadow != NULL ? shadow->level_mask : 0;
+
+            // an unhinted stream keeps the defaults of gs_create_streamed_texture
+            const GS_BOOL hinted = shadow != NULL && shadow->hinted;
+            record.screen_size = hinted ? shadow->screen_size : (float) (texture->width > texture->height ? texture->width : texture->height);
+            record.priority = hinted ? shadow->priority : 0;
+            gs_capture_append(payload, &record, sizeof(record));
+
+            const int face_size = texture->width * texture->height * gs_get_texture_format_size(texture->format);
+            for (int i = 0; i < 6; i++) {
+                if (record.faces & (1u << i)) {
+                    gs_capture_append(payload, shadow->data + (size_t) i * face_size, face_size);
+                }
+            }
+
+            for (int i = 0; i < record.levels; i++) {
+                if (record.level_mask & (1u << i)) {
+                    const int offset = gs_capture_level_offset(texture->width, texture->height, texture->format, i);
+                    gs_capture_append(payload, shadow->level_data + offset, gs_capture_level_size(texture->width, texture->height, texture->format, i));
+                }
+            }
+            break;
+        }
+        case GS_RESOURCE_TYPE_FRAMEBUFFER: {
+            const GsFramebuffer *framebuffer = (const GsFramebuffer*)resource;
+            GsCaptureFramebufferRecord record;
+            record.width = framebuffer->width;
+            record.height = framebuffer->height;
+            record.attachment_count = shadow != NULL ? shadow->attachment_count : 0;
+            gs_capture_append(payload, &record, sizeof(record));
+
+            for (int i = 0; i < record.attachment_count; i++) {
+                GsCaptureAttachmentRecord attachment;
+                attachment.texture = shadow->attachments[i].texture;
+                attachment.type = shadow->attachments[i].type;
+                gs_capture_append(payload, &attachment, sizeof(attachment));
+            }
+            break;
+        }
+        case GS_RESOURCE_TYPE_RENDER_PASS: {
+            const GsRenderPass *pass = (const GsRenderPass*)resource;
+            GsCaptureRenderPassRecord record;
+            record.framebuffer = pass->framebuffer != NULL ? pass->framebuffer->id : GS_INVALID_RESOURCE_ID;
+            gs_capture_append(payload, &record, sizeof(record));
+            break;
+        }
+        case GS_RESOURCE_TYPE_PIPELINE: {
+            const GsPipeline *pipeline = (const GsPipeline*)resource;
+            GsCapturePipelineRecord record;
+            record.layout = pipeline->layout != NULL ? pipeline->layout->id : GS_INVALID_RESOURCE_ID;
+            record.program = pipeline->program != NULL ? pipeline->program->id : GS_INVALID_RESOURCE_ID;
+            record.primitive_type = pipeline->primitive_type;
+            record.msaa_samples = pipeline->msaa_samples;
+            record.blend_op = pipeline->blend_op;
+            record.blend_src = pipeline->blend_src;
+            record.blend_dst = pipeline->blend_dst;
+            record.blend_op_alpha = pipeline->blend_op_alpha;
+            record.blend_src_alpha = pipeline->blend_src_alpha;
+            record.blend_dst_alpha = pipeline->blend_dst_alpha;
+            record.blend_enabled = pipeline->blend_enabled;
+            record.cull_face = pipeline->cull_face;
+            record.cull_front = pipeline->cull_front;
+            record.stencil_test = pipeline->stencil_test;
+            record.depth_func = pipeline->depth_func;
+            record.depth_write = pipeline->depth_write;
+            record.depth_test = pipeline->depth_test;
+            gs_capture_append(payload, &record, sizeof(record));
+            break;
+        }
+        case GS_RESOURCE_TYPE_BUNDLE:
+            gs_capture_append_stream(writer, (const GsCommandList*)resource);
+            break;
+        default:
+            GS_ASSERT(GS_FALSE);
+            break;
+    }
+
+    gs_capture_write_record(writer, type, id);
+}
+
+GS_BOOL gs_capture_frame(GsCommandList **lists, const int count) {
+    GS_ASSERT(capture_path != NULL);
+    GS_ASSERT(count == 0 || lists != NULL);
+
+    GsCaptureWriter writer;
+    GS_MEMSET(&writer, 0, sizeof(GsCaptureWriter));
+
+    writer.file = fopen(capture_path, "wb");
+    if (writer.file == NULL) {
+        GS_LOG("Genesis capture: failed to open %s\n", capture_path);
+        GS_FREE(capture_path);
+        capture_path = NULL;
+        return GS_FALSE;
+    }
+
+    GsCaptureFileHeader header;
+    header.magic = GS_CAPTURE_MAGIC;
+    header.version = GS_CAPTURE_VERSION;
+    header.record_count = 0;
+    header.max_id = 0;
+    gs_capture_write(&writer, &header, sizeof(GsCaptureFileHeader));
+
+    for (int i = 0; i < count; i++) {
+        gs_capture_visit_stream(&writer, lists[i]);
+    }
+
+    for (int i = 0; i < count; i++) {
+        gs_capture_append_stream(&writer, lists[i]);
+        gs_capture_write_record(&writer, GS_CAPTURE_RECORD_LIST, GS_INVALID_RESOURCE_ID);
+    }
+
+    // patch the header now that the counts are known
+    header.record_count = writer.record_count;
+    header.max_id = writer.max_id;
+    if (fseek(writer.file, 0, SEEK_SET) != 0) {
+        writer.failed = GS_TRUE;
+    }
+    gs_capture_write(&writer, &header, sizeof(GsCaptureFileHeader));
+
+    if (fclose(writer.file) != 0) {
+        writer.failed = GS_TRUE;
+    }
+
+    if (writer.failed) {
+        GS_LOG("Genesis capture: failed to write %s\n", capture_path);
+    }
+
+    GS_FREE(writer.payload.data);
+    GS_FREE(writer.visited);
+    GS_FREE(capture_path);
+    capture_path = NULL;
+
+    return !writer.failed;
+}
+
+GsCapture *gs_open_capture(const char *path) {
+    GS_ASSERT(path != NULL);
+
+    GsCapture *capture = GS_ALLOC(GsCapture);
+    GS_MEMSET(capture, 0, sizeof(GsCapture));
+
+    #if defined(_WIN32)
+        capture->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        LARGE_INTEGER size;
+
+        if (capture->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(capture->file, &size) || size.QuadPart < (LONGLONG) sizeof(GsCaptureFileHeader)) {
+            GS_LOG("Genesis capture: failed to open %s\n", path);
+            if (capture->file != INVALID_HANDLE_VALUE) {
+                CloseHandle(capture->file);
+            }
+            GS_FREE(capture);
+            return NULL;
+        }
+
+        capture->mapping = CreateFileMappingA(capture->file, NULL, PAGE_READONLY, 0, 0, NULL);
+        capture->data = capture->mapping != NULL ? (const unsigned char*)MapViewOfFile(capture->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        capture->size = (size_t) size.QuadPart;
+
+        if (capture->data == NULL) {
+            GS_LOG("Genesis capture: failed to map %s\n", path);
+            if (capture->mapping != NULL) {
+                CloseHandle(capture->mapping);
+            }
+            CloseHandle(capture->file);
+            GS_FREE(capture);
+            return NULL;
+        }
+    #elif defined(GS_CAPTURE_MMAP)
+        capture->file = open(path, O_RDONLY);
+        struct stat info;
+
+        if (capture->file < 0 || fstat(capture->file, &info) != 0 || info.st_size < (off_t) sizeof(GsCaptureFileHeader)) {
+            GS_LOG("Genesis capture: failed to open %s\n", path);
+            if (capture->file >= 0) {
+                close(capture->file);
+            }
+            GS_FREE(capture);
+            return NULL;
+        }
+
+        void *mapped = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, capture->file, 0);
+        if (mapped == MAP_FAILED) {
+            GS_LOG("Genesis capture: failed to map %s\n", path);
+            close(capture->file);
+            GS_FREE(capture);
+            return NULL;
+        }
+
+        capture->data = (const unsigned char*)mapped;
+        capture->size = (size_t) info.st_size;
+    #else
+        // no mappable files, read the capture whole
+        FILE *file = fopen(path, "rb");
+        long size = -1;
+
+        if (file != NULL && fseek(file, 0, SEEK_END) == 0) {
+            size = ftell(file);
+            fseek(file, 0, SEEK_SET);
+        }
+
+        unsigned char *data = size >= (long) sizeof(GsCaptureFileHeader) ? (unsigned char*)GS_MALLOC((size_t) size) : NULL;
+        if (data == NULL || fread(data, 1, (size_t) size, file) != (size_t) size) {
+            GS_LOG("Genesis capture: failed to read %s\n", path);
+            GS_FREE(data);
+            if (file != NULL) {
+                fclose(file);
+            }
+            GS_FREE(capture);
+            return NULL;
+        }
+
+        fclose(file);
+        capture->data = data;
+        capture->size = (size_t) size;
+    #endif
+
+    const GsCaptureFileHeader *header = (const GsCaptureFileHeader*)capture->data;
+    if (header->magic != GS_CAPTURE_MAGIC || header->version != GS_CAPTURE_VERSION) {
+        GS_LOG("Genesis capture: %s is not a version %d capture\n", path, GS_CAPTURE_VERSION);
+        gs_close_capture(capture);
+        return NULL;
+    }
+
+    return capture;
+}
+
+void gs_close_capture(GsCapture *capture) {
+    GS_ASSERT(capture != NULL);
+
+    #if defined(_WIN32)
+        UnmapViewOfFile(capture->data);
+        CloseHandle(capture->mapping);
+        CloseHandle(capture->file);
+    #elif defined(GS_CAPTURE_MMAP)
+        munmap((void*) capture->data, capture->size);
+        close(capture->file);
+    #else
+        GS_FREE((void*) capture->data);
+    #endif
+
+    GS_FREE(capture);
+}
+
+static void *gs_replay_resource(const GsReplay *replay, const GsResourceId id, const GsResourceType type) {
+    if (id == GS_INVALID_RESOURCE_ID) {
+        return NULL;
+    }
+
+    GS_ASSERT(id < replay->remap_count);
+    GS_ASSERT(replay->remap[id] != GS_INVALID_RESOURCE_ID);
+
+    return gs_get_resource(replay->remap[id], type);
+}
+
+static GsUniformLocation gs_replay_uniform_location(const GsReplay *replay, const GsUniformLocation location) {
+    const GsResourceId pipeline_id = replay->pipeline_stack[replay->pipeline_depth];
+    if (pipeline_id == GS_INVALID_RESOURCE_ID) {
+        return location;
+    }
+
+    const GsPipeline *pipeline = gs_get_resource(pipeline_id, GS_RESOURCE_TYPE_PIPELINE);
+    if (pipeline->program == NULL) {
+        return location;
+    }
+
+    for (int i = 0; i < replay->program_count; i++) {
+        const GsReplayProgram *program = &replay->programs[i];
+        if (program->id != pipeline->program->id) {
+            continue;
+        }
+
+        for (int u = 0; u < program->count; u++) {
+            if (program->from[u] == location) {
+                return program->to[u];
+            }
+        }
+    }
+
+    return location;
+}
+
+// Copies a captured stream into a list, translating resource ids and uniform locations.
+static void gs_replay_load_stream(GsReplay *replay, GsCommandList *list, const GsCaptureStreamRecord *record) {
+    const unsigned char *stream = (const unsigned char*)(record + 1);
+    int offset = 0;
+
+    unsigned char *side = NULL;
+    if (record->data_size > 0) {
+        side = (unsigned char*)gs_command_list_alloc(list, record->data_size);
+        memcpy(side, stream + record->stream_size, record->data_size);
+    }
+
+    while (offset < record->stream_size) {
+        const GsCommandHeader *header = (const GsCommandHeader*)(stream + offset);
+        const GsCommandType type = (GsCommandType) header->type;
+        GS_ASSERT(type < GS_COMMAND_COUNT);
+
+        unsigned char *payload = (unsigned char*)gs_command_list_push(list, type, header->size);
+        memcpy(payload, header + 1, header->size);
+
+        int offsets[2];
+        const int count = gs_capture_command_ids(type, offsets);
+
+        for (int i = 0; i < count; i++) {
+            GsResourceId id;
+            memcpy(&id, payload + offsets[i], sizeof(GsResourceId));
+            GS_ASSERT(id != GS_INVALID_RESOURCE_ID && id < replay->remap_count);
+
+            id = replay->remap[id];
+            memcpy(payload + offsets[i], &id, sizeof(GsResourceId));
+        }
+
+        int data_offset, size_offset;
+        if (gs_capture_command_data(type, &data_offset, &size_offset)) {
+            uintptr_t side_offset;
+            memcpy(&side_offset, payload + data_offset, sizeof(uintptr_t));
+            GS_ASSERT(side != NULL && side_offset < (uintptr_t) record->data_size);
+
+            void *data = side + side_offset;
+            memcpy(payload + data_offset, &data, sizeof(void*));
+        }
+
+        if (replay->remap_uniforms) {
+            GsResourceId *pipeline = &replay->pipeline_stack[replay->pipeline_depth];
+
+            if (type == GS_COMMAND_USE_PIPELINE) {
+                memcpy(pipeline, payload + offsetof(GsPipelineCommand, pipeline), sizeof(GsResourceId));
+            } else if (type == GS_COMMAND_BEGIN_PASS && replay->pipeline_depth + 1 < GS_TABLE_SIZE(replay->pipeline_stack)) {
+                replay->pipeline_stack[replay->pipeline_depth + 1] = *pipeline;
+                replay->pipeline_depth += 1;
+            } else if (type == GS_COMMAND_END_PASS && replay->pipeline_depth > 0) {
+                replay->pipeline_depth -= 1;
+            } else if (type == GS_COMMAND_EXECUTE_BUNDLE) {
+                *pipeline = GS_INVALID_RESOURCE_ID;
+            } else if ((type >= GS_COMMAND_SET_UNIFORM_INT && type <= GS_COMMAND_SET_UNIFORM_MAT4) ||
+                       (type >= GS_COMMAND_SET_UNIFORM_FLOAT_ARRAY && type <= GS_COMMAND_SET_UNIFORM_MAT4_ARRAY)) {
+                // the location comes first in every uniform command, arrays included
+                GsUniformLocation location;
+                memcpy(&location, payload, sizeof(GsUniformLocation));
+                location = gs_replay_uniform_location(replay, location);
+                memcpy(payload, &location, sizeof(GsUniformLocation));
+            }
+        }
+
+        offset += GS_COMMAND_STRIDE(header);
+    }
+}
+
+static GsResourceId gs_replay_create_resource(GsReplay *replay, const GsCaptureRecord *record) {
+    const void *data = record + 1;
+
+    switch (record->type) {
+        case GS_RESOURCE_TYPE_SHADER: {
+            const GsCaptureShaderRecord *shader = (const GsCaptureShaderRecord*)data;
+            const char *source = shader->source_size > 0 ? (const char*)(shader + 1) : "";
+            return gs_create_shader((GsShaderType) shader->type, source)->id;
+        }
+        case GS_RESOURCE_TYPE_PROGRAM: {
+            const GsCaptureProgramRecord *captured = (const GsCaptureProgramRecord*)data;
+            GsProgram *program = gs_create_program();
+
+            if (captured->vertex != GS_INVALID_RESOURCE_ID) {
+                gs_program_attach_shader(program, gs_replay_resource(replay, captured->vertex, GS_RESOURCE_TYPE_SHADER));
+            }
+
+            if (captured->fragment != GS_INVALID_RESOURCE_ID) {
+                gs_program_attach_shader(program, gs_replay_resource(replay, captured->fragment, GS_RESOURCE_TYPE_SHADER));
+            }
+
+            if (captured->completed) {
+                gs_program_build(program);
+            }
+
+            // resolve the names again, locations are only stable for the backend and driver that captured them
+            GsReplayProgram *mapping = &replay->programs[replay->program_count];
+            mapping->id = program->id;
+            mapping->count = captured->uniform_count;
+            const int uniform_capacity = captured->uniform_count > 0 ? captured->uniform_count : 1;
+            mapping->from = GS_ALLOC_MULTIPLE(GsUniformLocation, uniform_capacity);
+            mapping->to = GS_ALLOC_MULTIPLE(GsUniformLocation, uniform_capacity);
+            replay->program_count += 1;
+
+            const unsigned char *cursor = (const unsigned char*)(captured + 1);
+            for (int i = 0; i < captured->uniform_count; i++) {
+                const GsCaptureUniformRecord *uniform = (const GsCaptureUniformRecord*)cursor;
+                const char *name = (const char*)(uniform + 1);
+
+                mapping->from[i] = uniform->location;
+                mapping->to[i] = captured->completed ? gs_get_uniform_location(program, name) : uniform->location;
+                if (mapping->to[i] != mapping->from[i]) {
+                    replay->remap_uniforms = GS_TRUE;
+                }
+
+                cursor += sizeof(GsCaptureUniformRecord) + uniform->name_size + (4 - uniform->name_size % 4) % 4;
+            }
+
+            // bindings are program state, without them blocks read the driver's default binding points
+            for (int i = 0; i < captured->block_count; i++) {
+                const GsCaptureUniformBlockRecord *block = (const GsCaptureUniformBlockRecord*)cursor;
+                gs_program_set_uniform_block(program, (const char*)(block + 1), block->binding);
+
+                cursor += sizeof(GsCaptureUniformBlockRecord) + block->name_size + (4 - block->name_size % 4) % 4;
+            }
+
+            return program->id;
+        }
+        case GS_RESOURCE_TYPE_LAYOUT: {
+            const GsCaptureLayoutRecord *captured = (const GsCaptureLayoutRecord*)data;
+            const GsCaptureLayoutItemRecord *items = (const GsCaptureLayoutItemRecord*)(captured + 1);
+            GsVtxLayout *layout = gs_create_layout();
+
+            for (int i = 0; i < captured->count; i++) {
+                if (items[i].stream == GS_VERTEX_STREAM_INSTANCE) {
+                    gs_layout_add_instanced(layout, items[i].index, (GsVtxAttribType) items[i].type, items[i].components, items[i].divisor);
+                } else {
+                    gs_layout_add_stream(layout, items[i].stream, items[i].index, (GsVtxAttribType) items[i].type, items[i].components);
+                    gs_layout_set_stream_divisor(layout, items[i].stream, items[i].divisor);
+                }
+                layout->items[i].normalized = items[i].normalized;
+                layout->items[i].integer = items[i].integer;
+            }
+
+            if (captured->completed) {
+                gs_layout_build(layout);
+            }
+
+            return layout->id;
+        }
+        case GS_RESOURCE_TYPE_BUFFER: {
+            const GsCaptureBufferRecord *captured = (const GsCaptureBufferRecord*)data;
+            GsBuffer *buffer = gs_create_buffer((GsBufferType) captured->type, (GsBufferIntent) captured->intent);
+            if (buffer->type == GS_BUFFER_TYPE_INDEX) {
+                gs_buffer_set_index_type(buffer, (GsIndexType) captured->index_type);
+            }
+
+            if (captured->data_size > 0) {
+                gs_buffer_set_data(buffer, (void*)(captured + 1), captured->data_size);
+            }
+
+            return buffer->id;
+        }
+        case GS_RESOURCE_TYPE_TEXTURE: {
+            const GsCaptureTextureRecord *captured = (const GsCaptureTextureRecord*)data;
+            GsTexture *texture;
+
+            if (captured->levels > 0) {
+                // falls back to a plain mipmapped texture where streaming isn't supported
+                texture = gs_create_streamed_texture(captured->width, captured->height, (GsTextureFormat) captured->format, (GsTextureWrap) captured->wrap_s, (GsTextureWrap) captured->wrap_t, (GsTextureFilter) captured->min, (GsTextureFilter) captured->mag);
+                GS_ASSERT(texture->levels == captured->levels);
+            } else if (captured->type == GS_TEXTURE_TYPE_CUBEMAP) {
+                texture = gs_create_cubemap(captured->width, captured->height, (GsTextureFormat) captured->format, (GsTextureWrap) captured->wrap_s, (GsTextureWrap) captured->wrap_t, (GsTextureWrap) captured->wrap_r, (GsTextureFilter) captured->min, (GsTextureFilter) captured->mag);
+            } else {
+                texture = gs_create_texture(captured->width, captured->height, (GsTextureFormat) captured->format, (GsTextureWrap) captured->wrap_s, (GsTextureWrap) captured->wrap_t, (GsTextureFilter) captured->min, (GsTextureFilter) captured->mag);
+            }
+
+            texture->lodBias = captured->lod_bias;
+
+            // render targets are cleared rather than uploaded, they still need storage to be attachable
+            if (captured->levels == 0 && captured->faces == 0) {
+                gs_texture_clear(texture);
+            }
+
+            const int face_size = captured->width * captured->height * gs_get_texture_format_size((GsTextureFormat) captured->format);
+            const unsigned char *pixels = (const unsigned char*)(captured + 1);
+
+            for (int i = 0; i < 6; i++) {
+                if (!(captured->faces & (1u << i))) {
+                    continue;
+                }
+
+                if (captured->type == GS_TEXTURE_TYPE_CUBEMAP) {
+                    gs_texture_set_face_data(texture, (GsCubemapFace) i, (void*) pixels);
+                } else {
+                    gs_texture_set_data(texture, (void*) pixels);
+                }
+
+                pixels += face_size;
+            }
+
+            if (captured->mipmaps) {
+                gs_texture_generate_mipmaps(texture);
+            }
+
+            if (captured->levels > 0) {
+                gs_texture_set_stream_hint(texture, captured->screen_size, captured->priority);
+
+                for (int i = 0; i < captured->levels; i++) {
+                    if (!(captured->level_mask & (1u << i))) {
+                        continue;
+                    }
+
+                    gs_texture_set_level_data(texture, i, (void*) pixels);
+                    pixels += gs_capture_level_size(captured->width, captured->height, (GsTextureFormat) captured->format, i);
+                }
+            }
+
+            return texture->id;
+        }
+        case GS_RESOURCE_TYPE_FRAMEBUFFER: {
+            const GsCaptureFramebufferRecord *captured = (const GsCaptureFramebufferRecord*)data;
+            const GsCaptureAttachmentRecord *attachments = (const GsCaptureAttachmentRecord*)(captured + 1);
+            GsFramebuffer *framebuffer = gs_create_framebuffer(captured->width, captured->height);
+
+            for (int i = 0; i < captured->attachment_count; i++) {
+                GsTexture *texture = gs_replay_resource(replay, attachments[i].texture, GS_RESOURCE_TYPE_TEXTURE);
+                gs_framebuffer_attach_texture(framebuffer, texture, (GsFramebufferAttachmentType) attachments[i].type);
+            }
+
+            return framebuffer->id;
+        }
+        case GS_RESOURCE_TYPE_RENDER_PASS: {
+            const GsCaptureRenderPassRecord *captured = (const GsCaptureRenderPassRecord*)data;
+            return gs_create_render_pass(gs_replay_resource(replay, captured->framebuffer, GS_RESOURCE_TYPE_FRAMEBUFFER))->id;
+        }
+        case GS_RESOURCE_TYPE_PIPELINE: {
+            const GsCapturePipelineRecord *captured = (const GsCapturePipelineRecord*)data;
+            GsPipeline *pipeline = gs_create_pipeline();
+
+            pipeline->layout = gs_replay_resource(replay, captured->layout, GS_RESOURCE_TYPE_LAYOUT);
+            pipeline->program = gs_replay_resource(replay, captured->program, GS_RESOURCE_TYPE_PROGRAM);
+            pipeline->primitive_type = (GsPrimitiveType) captured->primitive_type;
+            pipeline->msaa_samples = captured->msaa_samples;
+            pipeline->blend_op = (GsBlendOp) captured->blend_op;
+            pipeline->blend_src = (GsBlendFactor) captured->blend_src;
+            pipeline->blend_dst = (GsBlendFactor) captured->blend_dst;
+            pipeline->blend_op_alpha = (GsBlendOp) captured->blend_op_alpha;
+            pipeline->blend_src_alpha = (GsBlendFactor) captured->blend_src_alpha;
+            pipeline->blend_dst_alpha = (GsBlendFactor) captured->blend_dst_alpha;
+            pipeline->blend_enabled = captured->blend_enabled;
+            pipeline->cull_face = captured->cull_face;
+            pipeline->cull_front = (GsWindingDirection) captured->cull_front;
+            pipeline->stencil_test = captured->stencil_test;
+            pipeline->depth_func = (GsDepthFunc) captured->depth_func;
+            pipeline->depth_write = captured->depth_write;
+            pipeline->depth_test = captured->depth_test;
+
+            return pipeline->id;
+        }
+        case GS_RESOURCE_TYPE_BUNDLE: {
+            GsCommandList *bundle = gs_create_bundle();
+            replay->pipeline_depth = 0;
+            replay->pipeline_stack[0] = GS_INVALID_RESOURCE_ID;
+
+            gs_command_list_begin(bundle);
+            gs_replay_load_stream(replay, bundle, (const GsCaptureStreamRecord*)data);
+            gs_command_list_end(bundle);
+
+            return bundle->id;
+        }
+        default:
+            GS_LOG("Genesis capture: unknown record type %u\n", record->type);
+            return GS_INVALID_RESOURCE_ID;
+    }
+}
+
+static void gs_replay_destroy_resource(const GsResourceId id) {
+    const GsResourceType type = gs_get_resource_type(id);
+    void *resource = gs_get_resource(id, type);
+
+    switch (type) {
+        case GS_RESOURCE_TYPE_SHADER:
+            gs_destroy_shader((GsShader*) resource);
+            break;
+        case GS_RESOURCE_TYPE_PROGRAM:
+            gs_destroy_program((GsProgram*) resource);
+            break;
+        case GS_RESOURCE_TYPE_LAYOUT:
+            gs_destroy_layout((GsVtxLayout*) resource);
+            break;
+        case GS_RESOURCE_TYPE_BUFFER:
+            gs_destroy_buffer((GsBuffer*) resource);
+            break;
+        case GS_RESOURCE_TYPE_TEXTURE:
+            gs_destroy_texture((GsTexture*) resource);
+            break;
+        case GS_RESOURCE_TYPE_FRAMEBUFFER:
+            gs_destroy_framebuffer((GsFramebuffer*) resource);
+            break;
+        case GS_RESOURCE_TYPE_RENDER_PASS:
+            gs_destroy_render_pass((GsRenderPass*) resource);
+            break;
+        case GS_RESOURCE_TYPE_PIPELINE:
+            gs_destroy_pipeline((GsPipeline*) resource);
+            break;
+        case GS_RESOURCE_TYPE_BUNDLE:
+            gs_destroy_command_list((GsCommandList*) resource);
+            break;
+        default:
+            break;
+    }
+}
+
+GsReplay *gs_create_replay(GsCapture *capture) {
+    GS_ASSERT(capture != NULL);
+    GS_ASSERT(gs_get_active_config() != NULL);
+
+    const GsCaptureFileHeader *header = (const GsCaptureFileHeader*)capture->data;
+
+    GsReplay *replay = GS_ALLOC(GsReplay);
+    GS_MEMSET(replay, 0, sizeof(GsReplay));
+    replay->capture = capture;
+    replay->remap_count = header->max_id + 1;
+    replay->remap = GS_ALLOC_MULTIPLE(GsResourceId, replay->remap_count);
+    GS_MEMSET(replay->remap, 0, sizeof(GsResourceId) * replay->remap_count);
+    const int record_capacity = header->record_count > 0 ? (int) header->record_count : 1;
+    replay->created = GS_ALLOC_MULTIPLE(GsResourceId, record_capacity);
+    replay->lists = GS_ALLOC_MULTIPLE(GsCommandList*, record_capacity);
+    replay->programs = GS_ALLOC_MULTIPLE(GsReplayProgram, record_capacity);
+    replay->scratch = gs_create_command_list();
+    replay->stats.frame_min_ns = UINT64_MAX;
+
+    size_t offset = sizeof(GsCaptureFileHeader);
+
+    for (uint32_t i = 0; i < header->record_count; i++) {
+        GS_ASSERT(offset + sizeof(GsCaptureRecord) <= capture->size);
+
+        const GsCaptureRecord *record = (const GsCaptureRecord*)(capture->data + offset);
+        GS_ASSERT(offset + sizeof(GsCaptureRecord) + record->size <= capture->size);
+
+        if (record->type == GS_CAPTURE_RECORD_LIST) {
+            // lists run back to back, a pipeline bound by one is still bound in the next
+            if (replay->list_count == 0) {
+                replay->pipeline_depth = 0;
+                replay->pipeline_stack[0] = GS_INVALID_RESOURCE_ID;
+            }
+
+            GsCommandList *list = gs_create_command_list();
+            gs_command_list_begin(list);
+            gs_replay_load_stream(replay, list, (const GsCaptureStreamRecord*)(record + 1));
+            gs_command_list_set_order(list, (uint32_t) replay->list_count);
+
+            replay->lists[replay->list_count] = list;
+            replay->list_count += 1;
+        } else {
+            GS_ASSERT(record->id < replay->remap_count);
+
+            const GsResourceId id = gs_replay_create_resource(replay, record);
+            replay->remap[record->id] = id;
+
+            if (id != GS_INVALID_RESOURCE_ID) {
+                replay->created[replay->created_count] = id;
+                replay->created_count += 1;
+            }
+        }
+
+        offset += sizeof(GsCaptureRecord) + record->size;
+        offset += (GS_CAPTURE_RECORD_ALIGNMENT - record->size % GS_CAPTURE_RECORD_ALIGNMENT) % GS_CAPTURE_RECORD_ALIGNMENT;
+    }
+
+    return replay;
+}
+
+void gs_replay_frame(GsReplay *replay, const GS_BOOL per_command) {
+    GS_ASSERT(replay != NULL);
+
+    GsConfig *config = gs_get_active_config();
+    GS_ASSERT(config != NULL);
+    GS_ASSERT(config->backend != NULL);
+
+    const uint64_t start = gs_capture_now_ns();
+
+    if (!per_command) {
+        for (int i = 0; i < replay->list_count; i++) {
+            gs_command_list_submit(replay->lists[i]);
+        }
+
+        gs_frame();
+    } else {
+        // every command is submitted on its own so its cost on the calling thread can be measured
+        GS_ASSERT(config->render_thread == GS_FALSE);
+        int count = 0;
+
+        for (int i = 0; i < replay->list_count; i++) {
+            GsCommandIterator iterator;
+            gs_command_list_iter_begin(replay->lists[i], &iterator);
+
+            const GsCommandHeader *header;
+            while ((header = gs_command_list_iter_next(&iterator)) != NULL) {
+                gs_command_list_begin(replay->scratch);
+                gs_command_list_add(replay->scratch, (GsCommandType) header->type, (void*)(header + 1), header->size);
+
+                const uint64_t command_start = gs_capture_now_ns();
+                config->backend->submit(config->backend, replay->scratch);
+                const uint64_t elapsed = gs_capture_now_ns() - command_start;
+
+                if (count >= replay->command_capacity) {
+                    int capacity = replay->command_capacity;
+                    replay->command_ns = (uint64_t*)gs_capture_grow(replay->command_ns, &capacity, count + 1, sizeof(uint64_t));
+                    capacity = replay->command_capacity;
+                    replay->command_types = (GsCommandType*)gs_capture_grow(replay->command_types, &capacity, count + 1, sizeof(GsCommandType));
+                    replay->command_capacity = capacity;
+                }
+
+                replay->command_ns[count] = elapsed;
+                replay->command_types[count] = (GsCommandType) header->type;
+                replay->stats.type_ns[header->type] += elapsed;
+                replay->stats.type_count[header->type] += 1;
+                count += 1;
+            }
+        }
+
+        replay->stats.command_ns = replay->command_ns;
+        replay->stats.command_types = replay->command_types;
+        replay->stats.command_count = count;
+    }
+
+    const uint64_t elapsed = gs_capture_now_ns() - start;
+    GsReplayStats *stats = &replay->stats;
+    stats->frames += 1;
+    stats->frame_ns = elapsed;
+    stats->frame_total_ns += elapsed;
+    stats->frame_min_ns = elapsed < stats->frame_min_ns ? elapsed : stats->frame_min_ns;
+    stats->frame_max_ns = elapsed > stats->frame_max_ns ? elapsed : stats->frame_max_ns;
+}
+
+const GsReplayStats *gs_replay_get_stats(const GsReplay *replay) {
+    GS_ASSERT(replay != NULL);
+    return &replay->stats;
+}
+
+void gs_destroy_replay(GsReplay *replay) {
+    GS_ASSERT(replay != NULL);
+
+    for (int i = 0; i < replay->list_count; i++) {
+        gs_destroy_command_list(replay->lists[i]);
+    }
+
+    for (int i = replay->created_count - 1; i >= 0; i--) {
+        gs_replay_destroy_resource(replay->created[i]);
+    }
+
+    for (int i = 0; i < replay->program_count; i++) {
+        GS_FREE(replay->programs[i].from);
+        GS_FREE(replay->programs[i].to);
+    }
+
+    gs_destroy_command_list(replay->scratch);
+    GS_FREE(replay->programs);
+    GS_FREE(replay->lists);
+    GS_FREE(replay->created);
+    GS_FREE(replay->remap);
+    GS_FREE(replay->command_ns);
+    GS_FREE(replay->command_types);
+    GS_FREE(replay);
+}
@@ -0,0 +1,68 @@
+#ifndef GENESIS_CAPTURE_H
+#define GENESIS_CAPTURE_H
+
+#include "genesis.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GS_CAPTURE_MAGIC 0x46435347 // "GSCF"
+#define GS_CAPTURE_VERSION 8
+
+typedef struct GsCapture GsCapture;
+typedef struct GsReplay GsReplay;
+
+typedef struct GsReplayStats {
+    int frames;
+    uint64_t frame_ns; // last replayed frame
+    uint64_t frame_min_ns;
+    uint64_t frame_max_ns;
+    uint64_t frame_total_ns;
+
+    // accumulated over every frame replayed with per-command timing
+    uint64_t type_ns[GS_COMMAND_COUNT];
+    uint64_t type_count[GS_COMMAND_COUNT];
+
+    // last frame replayed with per-command timing, in execution order
+    const uint64_t *command_ns;
+    const GsCommandType *command_types;
+    int command_count;
+} GsReplayStats;
+
+// Capture
+// Resource contents only reach a capture when shadowing was enabled before they were uploaded.
+void gs_capture_set_shadowing(GS_BOOL enabled);
+GS_BOOL gs_capture_is_shadowing();
+void gs_capture_next_frame(const char *path);
+GS_BOOL gs_capture_pending();
+GS_BOOL gs_capture_frame(GsCommandList **lists, int count);
+void gs_capture_shadow_updates(GsCommandList **lists, int count);
+
+// Shadowing, called by the core as resources change
+void gs_capture_shadow_shader(const GsShader *shader, const char *source);
+void gs_capture_shadow_buffer(const GsBuffer *buffer, const void *data, int size, int offset, GS_BOOL partial);
+void gs_capture_shadow_texture(const GsTexture *texture, GsCubemapFace face, const void *data);
+void gs_capture_shadow_texture_rect(const GsTexture *texture, GsCubemapFace face, int x, int y, int width, int height, const void *data);
+void gs_capture_shadow_texture_level(const GsTexture *texture, int level, const void *data);
+void gs_capture_shadow_texture_stream(const GsTexture *texture, float screen_size, int priority);
+void gs_capture_shadow_texture_mipmaps(const GsTexture *texture);
+void gs_capture_shadow_texture_clear(const GsTexture *texture);
+void gs_capture_shadow_attachment(const GsFramebuffer *framebuffer, const GsTexture *texture, GsFramebufferAttachmentType attachment);
+void gs_capture_shadow_uniform(const GsProgram *program, const char *name, GsUniformLocation location);
+void gs_capture_shadow_uniform_block(const GsProgram *program, const char *name, int binding);
+void gs_capture_forget(GsResourceId id);
+
+// Replay
+GsCapture *gs_open_capture(const char *path);
+void gs_close_capture(GsCapture *capture);
+GsReplay *gs_create_replay(GsCapture *capture);
+void gs_replay_frame(GsReplay *replay, GS_BOOL per_command);
+const GsReplayStats *gs_replay_get_stats(const GsReplay *replay);
+void gs_destroy_replay(GsReplay *replay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GENESIS_CAPTURE_H
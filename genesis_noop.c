@@ -2,7 +2,7 @@
 #include <stdlib.h>
 
 static GS_BOOL gs_noop_init(GsBackend *backend, GsConfig *config) {
-    backend->capabilities = 0;
+    backend->capabilities = GS_CAPABILITY_READBACK; // readbacks complete at once with zeroed contents
     return GS_TRUE;
 }
 
@@ -14,6 +14,16 @@ static void gs_noop_create_buffer(GsBuffer *buffer) { buffer->handle = 0; }
 static void gs_noop_set_buffer_data(GsBuffer *buffer, void *data, int size) {}
 static void gs_noop_set_buffer_partial_data(GsBuffer *buffer, void *data, int size, int offset) {}
 static void gs_noop_destroy_buffer(GsBuffer *buffer) { buffer->handle = 0; }
+static void *gs_noop_map_stream_buffer(GsBuffer *buffer, int capacity) { return NULL; }
+
+static void *gs_noop_create_fence() { return NULL; }
+static GS_BOOL gs_noop_wait_fence(void *fence, uint64_t timeout) { return GS_TRUE; }
+static void gs_noop_destroy_fence(void *fence) {}
+
+static void gs_noop_create_readback(GsReadback *readback, GsBuffer *buffer, int offset) { readback->handle = calloc(1, readback->size); }
+static void gs_noop_create_texture_readback(GsReadback *readback, GsTexture *texture, int x, int y, int width, int height) { readback->handle = calloc(1, readback->size); }
+static void *gs_noop_map_readback(GsReadback *readback) { return readback->handle; }
+static void gs_noop_destroy_readback(GsReadback *readback) { free(readback->handle); readback->handle = 0; }
 
 static void gs_noop_create_shader(GsShader *shader, const char *source) { shader->handle = 0; }
 static void gs_noop_destroy_shader(GsShader *shader) { shader->handle = 0; }
@@ -22,12 +32,15 @@ static void gs_noop_create_program(GsProgram *program) { program->handle = 0; }
 static void gs_noop_destroy_program(GsProgram *program) { program->handle = 0; }
 
 static GsUniformLocation gs_noop_get_uniform_location(GsProgram *program, const char *name) { return -1; }
+static void gs_noop_set_uniform_block_binding(GsProgram *program, const char *name, int binding) {}
 
 static void gs_noop_create_layout(GsVtxLayout *layout) {}
 static void gs_noop_destroy_layout(GsVtxLayout *layout) {}
 
 static void gs_noop_create_texture(GsTexture *texture) { texture->handle = 0; }
 static void gs_noop_set_texture_data(GsTexture *texture, GsCubemapFace face, void *data) {}
+static void gs_noop_upload_texture(GsTexture *texture, GsCubemapFace face, int level, int x, int y, int width, int height, const void *data) {}
+static void gs_noop_set_texture_levels(GsTexture *texture, int base_level, int keep_level) {}
 static void gs_noop_generate_mipmaps(GsTexture *texture) {}
 static void gs_noop_clear_texture(GsTexture *texture) {}
 static void gs_noop_update_texture_state(GsTexture *texture) {}
@@ -40,6 +53,9 @@ static void gs_noop_create_framebuffer(GsFramebuffer *framebuffer) { framebuffer
 static void gs_noop_destroy_framebuffer(GsFramebuffer *framebuffer) { framebuffer->handle = 0; }
 static void gs_noop_framebuffer_attach_texture(GsFramebuffer *framebuffer, GsTexture *texture, GsFramebufferAttachmentType attachment) {}
 
+static void gs_noop_create_bundle(GsCommandList *bundle) { bundle->handle = 0; }
+static void gs_noop_destroy_bundle(GsCommandList *bundle) { bundle->handle = 0; }
+
 GsBackend *gs_noop_create() {
     GsBackend *backend = GS_ALLOC(GsBackend);
 
@@ -52,6 +68,16 @@ GsBackend *gs_noop_create() {
     backend->set_buffer_data = gs_noop_set_buffer_data;
     backend->set_buffer_partial_data = gs_noop_set_buffer_partial_data;
     backend->destroy_buffer_handle = gs_noop_destroy_buffer;
+    backend->map_stream_buffer = gs_noop_map_stream_buffer;
+
+    backend->create_fence = gs_noop_create_fence;
+    backend->wait_fence = gs_noop_wait_fence;
+    backend->destroy_fence = gs_noop_destroy_fence;
+
+    backend->create_readback_handle = gs_noop_create_readback;
+    backend->create_texture_readback_handle = gs_noop_create_texture_readback;
+    backend->map_readback = gs_noop_map_readback;
+    backend->destroy_readback_handle = gs_noop_destroy_readback;
 
     backend->create_shader_handle = gs_noop_create_shader;
     backend->destroy_shader_handle = gs_noop_destroy_shader;
@@ -60,12 +86,15 @@ GsBackend *gs_noop_create() {
     backend->destroy_program_handle = gs_noop_destroy_program;
 
     backend->get_uniform_location = gs_noop_get_uniform_location;
+    backend->set_uniform_block_binding = gs_noop_set_uniform_block_binding;
 
     backend->create_layout_handle = gs_noop_create_layout;
     backend->destroy_layout_handle = gs_noop_destroy_layout;
 
     backend->create_texture_handle = gs_noop_create_texture;
     backend->set_texture_data = gs_noop_set_texture_data;
+    backend->upload_texture = gs_noop_upload_texture;
+    backend->set_texture_levels = gs_noop_set_texture_levels;
     backend->generate_mipmaps = gs_noop_generate_mipmaps;
     backend->destroy_texture_handle = gs_noop_destroy_texture;
     backend->clear_texture = gs_noop_clear_texture;
@@ -77,6 +106,9 @@ GsBackend *gs_noop_create() {
     backend->destroy_framebuffer = gs_noop_destroy_framebuffer;
     backend->framebuffer_attach_texture = gs_noop_framebuffer_attach_texture;
 
+    backend->create_bundle_handle = gs_noop_create_bundle;
+    backend->destroy_bundle_handle = gs_noop_destroy_bundle;
+
     return backend;
 }
 
@@ -20,6 +20,18 @@ void gs_noop_create_buffer(GsBuffer *buffer);
 void gs_noop_set_buffer_data(GsBuffer *buffer, void *data, int size);
 void gs_noop_set_buffer_partial_data(GsBuffer *buffer, void *data, int size, int offset);
 void gs_noop_destroy_buffer(GsBuffer *buffer);
+void *gs_noop_map_stream_buffer(GsBuffer *buffer, int capacity);
+
+// Fence
+void *gs_noop_create_fence();
+GS_BOOL gs_noop_wait_fence(void *fence, uint64_t timeout);
+void gs_noop_destroy_fence(void *fence);
+
+// Readback
+void gs_noop_create_readback(GsReadback *readback, GsBuffer *buffer, int offset);
+void gs_noop_create_texture_readback(GsReadback *readback, GsTexture *texture, int x, int y, int width, int height);
+void *gs_noop_map_readback(GsReadback *readback);
+void gs_noop_destroy_readback(GsReadback *readback);
 
 // Shader
 void gs_noop_create_shader(GsShader *shader, const char *source);
@@ -31,6 +43,7 @@ void gs_noop_destroy_program(GsProgram *program);
 
 // Uniforms
 GsUniformLocation gs_noop_get_uniform_location(GsProgram *program, const char *name);
+void gs_noop_set_uniform_block_binding(GsProgram *program, const char *name, int binding);
 
 // Layout
 void gs_noop_create_layout(GsVtxLayout *layout);
@@ -39,6 +52,8 @@ void gs_noop_destroy_layout(GsVtxLayout *layout);
 // Texture
 void gs_noop_create_texture(GsTexture *texture);
 void gs_noop_set_texture_data(GsTexture *texture, GsCubemapFace face, void *data);
+void gs_noop_upload_texture(GsTexture *texture, GsCubemapFace face, int level, int x, int y, int width, int height, const void *data);
+void gs_noop_set_texture_levels(GsTexture *texture, int base_level, int keep_level);
 void gs_noop_generate_mipmaps(GsTexture *texture);
 void gs_noop_clear_texture(GsTexture *texture);
 void gs_noop_update_texture_state(GsTexture *texture);
@@ -53,6 +68,10 @@ void gs_noop_create_framebuffer(GsFramebuffer *framebuffer);
 void gs_noop_destroy_framebuffer(GsFramebuffer *framebuffer);
 void gs_noop_framebuffer_attach_texture(GsFramebuffer *framebuffer, GsTexture *texture, GsFramebufferAttachmentType attachment);
 
+// Bundle
+void gs_noop_create_bundle(GsCommandList *bundle);
+void gs_noop_destroy_bundle(GsCommandList *bundle);
+
 #ifdef __cplusplus
 }
 #endif
@@ -2,6 +2,7 @@
 #include "genesis.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #if defined(__EMSCRIPTEN__)
     #define GS_OPENGL_PLATFORM_IMPL
@@ -10,6 +11,9 @@
     #if defined(GS_EMSCRIPTEN_GLES3)
         #define GS_OPENGL_V320ES
         #include <GLES3/gl3.h>
+
+        // WebGL 2 getBufferSubData, implemented by emscripten but not declared by the GLES 3 headers
+        GL_APICALL void GL_APIENTRY glGetBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, void *data);
     #else
         #define GS_OPENGL_V200ES
         #include <GLES2/gl2.h>
@@ -128,10 +132,27 @@ static const int gs_opengl_attrib_types[] = {
     [GS_ATTRIB_TYPE_INT32]  = GL_INT,
     [GS_ATTRIB_TYPE_INT8]   = GL_BYTE,
     [GS_ATTRIB_TYPE_DOUBLE] = GL_DOUBLE,
+    [GS_ATTRIB_TYPE_HALF_FLOAT] = GL_HALF_FLOAT,
+    [GS_ATTRIB_TYPE_INT_2_10_10_10_REV] = GL_INT_2_10_10_10_REV,
+};
+#endif
+
+#if defined(GS_OPENGL_V320ES)
+static const int gs_opengl_attrib_types[] = {
+    [GS_ATTRIB_TYPE_FLOAT]  = GL_FLOAT,
+    [GS_ATTRIB_TYPE_INT16]  = GL_SHORT,
+    [GS_ATTRIB_TYPE_UINT8]  = GL_UNSIGNED_BYTE,
+    [GS_ATTRIB_TYPE_UINT16] = GL_UNSIGNED_SHORT,
+    [GS_ATTRIB_TYPE_UINT32] = GL_UNSIGNED_INT,
+    [GS_ATTRIB_TYPE_INT32]  = GL_INT,
+    [GS_ATTRIB_TYPE_INT8]   = GL_BYTE,
+    [GS_ATTRIB_TYPE_DOUBLE] = -1,
+    [GS_ATTRIB_TYPE_HALF_FLOAT] = GL_HALF_FLOAT,
+    [GS_ATTRIB_TYPE_INT_2_10_10_10_REV] = GL_INT_2_10_10_10_REV,
 };
 #endif
 
-#if defined(GS_OPENGL_V200ES) || defined(GS_OPENGL_V320ES)
+#if defined(GS_OPENGL_V200ES)
 static const int gs_opengl_attrib_types[] = {
     [GS_ATTRIB_TYPE_FLOAT]  = GL_FLOAT,
     [GS_ATTRIB_TYPE_INT16]  = GL_SHORT,
@@ -141,6 +162,8 @@ static const int gs_opengl_attrib_types[] = {
     [GS_ATTRIB_TYPE_INT32]  = GL_INT,
     [GS_ATTRIB_TYPE_INT8]   = GL_BYTE,
     [GS_ATTRIB_TYPE_DOUBLE] = -1,
+    [GS_ATTRIB_TYPE_HALF_FLOAT] = -1,
+    [GS_ATTRIB_TYPE_INT_2_10_10_10_REV] = -1,
 };
 #endif
 
@@ -193,10 +216,32 @@ static const int gs_opengl_texture_filters[] = {
     [GS_TEXTURE_FILTER_MIPMAP_LINEAR]   = GL_LINEAR_MIPMAP_LINEAR
 };
 
+#if defined(GS_OPENGL_V460)
+static const int gs_opengl_buffer_types[] = {
+    [GS_BUFFER_TYPE_VERTEX]   = GL_ARRAY_BUFFER,
+    [GS_BUFFER_TYPE_INDEX]    = GL_ELEMENT_ARRAY_BUFFER,
+    [GS_BUFFER_TYPE_UNIFORM]  = GL_UNIFORM_BUFFER,
+    [GS_BUFFER_TYPE_INDIRECT] = GL_DRAW_INDIRECT_BUFFER
+};
+#endif
+
+#if defined(GS_OPENGL_V320ES)
+static const int gs_opengl_buffer_types[] = {
+    [GS_BUFFER_TYPE_VERTEX]   = GL_ARRAY_BUFFER,
+    [GS_BUFFER_TYPE_INDEX]    = GL_ELEMENT_ARRAY_BUFFER,
+    [GS_BUFFER_TYPE_UNIFORM]  = GL_UNIFORM_BUFFER,
+    [GS_BUFFER_TYPE_INDIRECT] = -1 // kept on the CPU
+};
+#endif
+
+#if defined(GS_OPENGL_V200ES)
 static const int gs_opengl_buffer_types[] = {
-    [GS_BUFFER_TYPE_VERTEX] = GL_ARRAY_BUFFER,
-    [GS_BUFFER_TYPE_INDEX]  = GL_ELEMENT_ARRAY_BUFFER
+    [GS_BUFFER_TYPE_VERTEX]   = GL_ARRAY_BUFFER,
+    [GS_BUFFER_TYPE_INDEX]    = GL_ELEMENT_ARRAY_BUFFER,
+    [GS_BUFFER_TYPE_UNIFORM]  = -1,
+    [GS_BUFFER_TYPE_INDIRECT] = -1 // kept on the CPU
 };
+#endif
 
 #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
 static const int gs_opengl_buffer_intents[] = {
@@ -305,11 +350,30 @@ static const GsCommandHandler gs_opengl_commands [] = {
     [GS_COMMAND_RESOLVE_TEXTURE]      = gs_opengl_cmd_resolve_texture,
     [GS_COMMAND_GEN_MIPMAPS]          = gs_opengl_cmd_generate_mipmaps,
     [GS_COMMAND_COPY_TEXTURE_PARTIAL] = gs_opengl_cmd_copy_texture_partial,
+    [GS_COMMAND_EXECUTE_BUNDLE]       = gs_opengl_cmd_execute_bundle,
+    [GS_COMMAND_UPDATE_BUFFER]        = gs_opengl_cmd_update_buffer,
+    [GS_COMMAND_UPDATE_TEXTURE]       = gs_opengl_cmd_update_texture,
+    [GS_COMMAND_SET_UNIFORM_FLOAT_ARRAY] = gs_opengl_cmd_set_uniform_float_array,
+    [GS_COMMAND_SET_UNIFORM_VEC2_ARRAY]  = gs_opengl_cmd_set_uniform_vec2_array,
+    [GS_COMMAND_SET_UNIFORM_VEC3_ARRAY]  = gs_opengl_cmd_set_uniform_vec3_array,
+    [GS_COMMAND_SET_UNIFORM_VEC4_ARRAY]  = gs_opengl_cmd_set_uniform_vec4_array,
+    [GS_COMMAND_SET_UNIFORM_MAT3_ARRAY]  = gs_opengl_cmd_set_uniform_mat3_array,
+    [GS_COMMAND_SET_UNIFORM_MAT4_ARRAY]  = gs_opengl_cmd_set_uniform_mat4_array,
+    [GS_COMMAND_USE_UNIFORM_BLOCK]       = gs_opengl_cmd_use_uniform_block,
+    [GS_COMMAND_USE_INSTANCE_BUFFER]     = gs_opengl_cmd_use_instance_buffer,
+    [GS_COMMAND_DRAW_ARRAYS_INSTANCED]   = gs_opengl_cmd_draw_arrays_instanced,
+    [GS_COMMAND_DRAW_INDEXED_INSTANCED]  = gs_opengl_cmd_draw_indexed_instanced,
+    [GS_COMMAND_DRAW_INDIRECT]           = gs_opengl_cmd_draw_indirect,
+    [GS_COMMAND_MULTI_DRAW_INDIRECT]     = gs_opengl_cmd_multi_draw_indirect,
+    [GS_COMMAND_USE_VERTEX_STREAM]       = gs_opengl_cmd_use_vertex_stream,
 };
 
 // State
 GsBuffer* bound_vertex_buffer = NULL;
 GsBuffer* bound_index_buffer = NULL;
+GsBuffer* bound_instance_buffer = NULL;
+GsBuffer* bound_streams[GS_MAX_VERTEX_STREAMS] = { NULL }; // index 0 is the vertex buffer and stays unused
+GsBuffer* bound_indirect_buffer = NULL;
 GsProgram* bound_program = NULL;
 GsVtxLayout* bound_layout = NULL;
 GsFramebuffer* bound_framebuffer = NULL;
@@ -320,6 +384,10 @@ int bound_texture_slot = 0;
 GsPipeline* bound_pipeline = NULL;
 GsBuffer* requested_vertex_buffer = NULL;
 GsBuffer* requested_index_buffer = NULL;
+GsBuffer* requested_instance_buffer = NULL;
+GsBuffer* requested_streams[GS_MAX_VERTEX_STREAMS] = { NULL };
+int requested_base_vertex = 0; // only used on GLES, which has no base vertex draws
+int bound_base_vertex = 0;
 GsProgram* requested_program = NULL;
 GsVtxLayout* requested_layout = NULL;
 GsFramebuffer* requested_framebuffer = NULL;
@@ -340,6 +408,8 @@ GS_BOOL stencil_test_enabled = -1;
 GS_BOOL msaa_enabled = -1;
 GsWindingDirection cull_front = -1;
 GsPrimitiveType primitive_type = GS_PRIMITIVE_TRIANGLES;
+GsOpenGLUniformBlock bound_uniform_blocks[GS_MAX_UNIFORM_BLOCK_BINDINGS];
+GsBackendStats *backend_stats = NULL;
 
 #if defined(GS_OPENGL_V200ES)
 GsBuffer* last_vertex_buffer_for_layout = NULL;
@@ -365,12 +435,16 @@ void gs_opengl_push_state() {
     GsOpenGLStateStack state = {
         .vertex_buffer = requested_vertex_buffer,
         .index_buffer = requested_index_buffer,
+        .instance_buffer = requested_instance_buffer,
+        .streams = { NULL },
         .pipeline = bound_pipeline,
         .framebuffer = requested_framebuffer,
         .textures = requested_textures_copy,
         .viewport = { requested_viewport.x, requested_viewport.y, requested_viewport.width, requested_viewport.height },
     };
 
+    memcpy(state.streams, requested_streams, sizeof(requested_streams));
+
     state_stack[state_stack_index] = state;
     state_stack_index++;
 }
@@ -387,6 +461,16 @@ void gs_opengl_pop_state() {
         requested_index_buffer = state_stack[state_stack_index].index_buffer;
     }
 
+    if (state_stack[state_stack_index].instance_buffer != NULL) {
+        requested_instance_buffer = state_stack[state_stack_index].instance_buffer;
+    }
+
+    for (int i = 1; i < GS_MAX_VERTEX_STREAMS; i++) {
+        if (state_stack[state_stack_index].streams[i] != NULL) {
+            requested_streams[i] = state_stack[state_stack_index].streams[i];
+        }
+    }
+
     requested_framebuffer = state_stack[state_stack_index].framebuffer; // framebuffer may be null
     requested_viewport = state_stack[state_stack_index].viewport; // always set
 
@@ -417,6 +501,18 @@ GsBackend *gs_opengl_create() {
     backend->set_buffer_data = gs_opengl_set_buffer_data;
     backend->set_buffer_partial_data = gs_opengl_set_buffer_partial_data;
     backend->destroy_buffer_handle = gs_opengl_destroy_buffer;
+    backend->map_stream_buffer = gs_opengl_map_stream_buffer;
+
+    // fences
+    backend->create_fence = gs_opengl_create_fence;
+    backend->wait_fence = gs_opengl_wait_fence;
+    backend->destroy_fence = gs_opengl_destroy_fence;
+
+    // readback
+    backend->create_readback_handle = gs_opengl_create_readback;
+    backend->create_texture_readback_handle = gs_opengl_create_texture_readback;
+    backend->map_readback = gs_opengl_map_readback;
+    backend->destroy_readback_handle = gs_opengl_destroy_readback;
 
     // shader
     backend->create_shader_handle = gs_opengl_create_shader;
@@ -428,6 +524,7 @@ GsBackend *gs_opengl_create() {
 
     // uniforms
     backend->get_uniform_location = gs_opengl_get_uniform_location;
+    backend->set_uniform_block_binding = gs_opengl_set_uniform_block_binding;
 
     // layout
     backend->create_layout_handle = gs_opengl_create_layout;
@@ -436,6 +533,8 @@ GsBackend *gs_opengl_create() {
     // texture
     backend->create_texture_handle = gs_opengl_create_texture;
     backend->set_texture_data = gs_opengl_set_texture_data;
+    backend->upload_texture = gs_opengl_upload_texture;
+    backend->set_texture_levels = gs_opengl_set_texture_levels;
     backend->generate_mipmaps = gs_opengl_generate_mipmaps;
     backend->destroy_texture_handle = gs_opengl_destroy_texture;
     backend->clear_texture = gs_opengl_clear_texture;
@@ -449,6 +548,10 @@ GsBackend *gs_opengl_create() {
     backend->destroy_framebuffer = gs_opengl_destroy_framebuffer;
     backend->framebuffer_attach_texture = gs_opengl_framebuffer_attach_texture;
 
+    // bundle
+    backend->create_bundle_handle = gs_opengl_create_bundle;
+    backend->destroy_bundle_handle = gs_opengl_destroy_bundle;
+
     // init state
     bound_textures = GS_ALLOC_MULTIPLE(GsTexture*, GS_MAX_TEXTURE_SLOTS);
     requested_textures = GS_ALLOC_MULTIPLE(GsTexture*, GS_MAX_TEXTURE_SLOTS);
@@ -458,6 +561,10 @@ GsBackend *gs_opengl_create() {
         requested_textures[i] = NULL;
     }
 
+    for (int i = 0; i < GS_MAX_UNIFORM_BLOCK_BINDINGS; i++) {
+        bound_uniform_blocks[i].buffer = NULL;
+    }
+
     return backend;
 }
 
@@ -476,6 +583,9 @@ static void gs_opengl_bind_vertex_buffer() {
             glBindVertexArray(handle->vaoHandle);
 
             bound_index_buffer = handle->lastIndexBuffer;
+            bound_instance_buffer = handle->lastInstanceBuffer;
+            memcpy(bound_streams, handle->lastStreams, sizeof(bound_streams));
+            bound_base_vertex = handle->lastBaseVertex;
             bound_layout = handle->lastLayout;
         } else {
             glBindVertexArray(0);
@@ -521,22 +631,41 @@ static void gs_opengl_bind_index_buffer() {
 static void gs_opengl_bind_program() {
     if (requested_program != bound_program) {
         GS_ASSERT(requested_program != NULL);
-        glUseProgram(*(GLuint*)requested_program->handle);
+        glUseProgram(((GsOpenGLProgramHandle*)requested_program->handle)->handle);
         bound_program = requested_program;
     }
 }
 
+// Whether a stream the requested layout reads from, besides the vertex buffer, is now bound to another buffer.
+static GS_BOOL gs_opengl_streams_changed() {
+    if (requested_layout == NULL) {
+        return GS_FALSE;
+    }
+
+    if (requested_layout->instance_stride > 0 && requested_instance_buffer != bound_instance_buffer) {
+        return GS_TRUE;
+    }
+
+    for (int i = 1; i < requested_layout->stream_count; i++) {
+        if (requested_streams[i] != bound_streams[i]) {
+            return GS_TRUE;
+        }
+    }
+
+    return GS_FALSE;
+}
+
 static void gs_opengl_bind_layout() {
     #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
-    if (requested_layout != bound_layout) {
+    if (requested_layout != bound_layout || requested_base_vertex != bound_base_vertex || gs_opengl_streams_changed()) {
         gs_opengl_internal_bind_layout_state();
     }
     #endif
 
     #if defined(GS_OPENGL_V200ES)
-    if (requested_layout != bound_layout ||
+    if (requested_layout != bound_layout || requested_base_vertex != bound_base_vertex ||
         bound_vertex_buffer != last_vertex_buffer_for_layout ||
-        requested_layout != last_layout_for_buffer) {
+        requested_layout != last_layout_for_buffer || gs_opengl_streams_changed()) {
         gs_opengl_internal_bind_layout_state();
     }
     #endif
@@ -588,43 +717,79 @@ void gs_opengl_bind_viewport() {
     }
 }
 
-void gs_opengl_cmd_set_uniform_int(const GsCommandListItem item) {
-    const GsUniformIntCommand *cmd = (GsUniformIntCommand *) item.data;
-
+// Binds the requested state and compares a uniform write against the value the bound program holds, returns GS_TRUE
+// when the upload can be skipped. Otherwise the value is remembered as the new one and the caller uploads it.
+static GS_BOOL gs_opengl_uniform_unchanged(const GsUniformLocation location, const void *data, const int size, const int count) {
     gs_opengl_internal_bind_state();
-    glUniform1i(cmd->location, cmd->value);
+
+    if (location < 0) {
+        // writes to -1 are ignored by GL anyway
+        backend_stats->uniform_uploads_skipped += 1;
+        return GS_TRUE;
+    }
+
+    if (bound_program != NULL) {
+        GsOpenGLProgramHandle *handle = (GsOpenGLProgramHandle*)bound_program->handle;
+
+        if (location < handle->uniform_count && handle->uniforms[location].offset >= 0 && handle->uniforms[location].size == size) {
+            const GsOpenGLUniformShadow *shadow = &handle->uniforms[location];
+            const int bytes = size * (count < shadow->remaining ? count : shadow->remaining);
+
+            if (memcmp(handle->values + shadow->offset, data, bytes) == 0) {
+                backend_stats->uniform_uploads_skipped += 1;
+                return GS_TRUE;
+            }
+
+            memcpy(handle->values + shadow->offset, data, bytes);
+        }
+    }
+
+    backend_stats->uniform_uploads += 1;
+    return GS_FALSE;
 }
 
-void gs_opengl_cmd_set_uniform_float(const GsCommandListItem item) {
-    const GsUniformFloatCommand *cmd = (GsUniformFloatCommand *) item.data;
+void gs_opengl_cmd_set_uniform_int(const GsCommandHeader *header) {
+    const GsUniformIntCommand *cmd = GS_COMMAND_DATA(header, GsUniformIntCommand);
 
-    gs_opengl_internal_bind_state();
-    glUniform1f(cmd->location, cmd->value);
+    if (!gs_opengl_uniform_unchanged(cmd->location, &cmd->value, sizeof(int), 1)) {
+        glUniform1i(cmd->location, cmd->value);
+    }
 }
 
-void gs_opengl_cmd_set_uniform_vec2(const GsCommandListItem item) {
-    const GsUniformVec2Command *cmd = (GsUniformVec2Command *) item.data;
+void gs_opengl_cmd_set_uniform_float(const GsCommandHeader *header) {
+    const GsUniformFloatCommand *cmd = GS_COMMAND_DATA(header, GsUniformFloatCommand);
 
-    gs_opengl_internal_bind_state();
-    glUniform2f(cmd->location, cmd->x, cmd->y);
+    if (!gs_opengl_uniform_unchanged(cmd->location, &cmd->value, sizeof(float), 1)) {
+        glUniform1f(cmd->location, cmd->value);
+    }
 }
 
-void gs_opengl_cmd_set_uniform_vec3(const GsCommandListItem item) {
-    const GsUniformVec3Command *cmd = (GsUniformVec3Command *) item.data;
+void gs_opengl_cmd_set_uniform_vec2(const GsCommandHeader *header) {
+    const GsUniformVec2Command *cmd = GS_COMMAND_DATA(header, GsUniformVec2Command);
 
-    gs_opengl_internal_bind_state();
-    glUniform3f(cmd->location, cmd->x, cmd->y, cmd->z);
+    if (!gs_opengl_uniform_unchanged(cmd->location, &cmd->x, sizeof(float) * 2, 1)) {
+        glUniform2f(cmd->location, cmd->x, cmd->y);
+    }
 }
 
-void gs_opengl_cmd_set_uniform_vec4(const GsCommandListItem item) {
-    const GsUniformVec4Command *cmd = (GsUniformVec4Command *) item.data;
+void gs_opengl_cmd_set_uniform_vec3(const GsCommandHeader *header) {
+    const GsUniformVec3Command *cmd = GS_COMMAND_DATA(header, GsUniformVec3Command);
 
-    gs_opengl_internal_bind_state();
-    glUniform4f(cmd->location, cmd->x, cmd->y, cmd->z, cmd->w);
+    if (!gs_opengl_uniform_unchanged(cmd->location, &cmd->x, sizeof(float) * 3, 1)) {
+        glUniform3f(cmd->location, cmd->x, cmd->y, cmd->z);
+    }
 }
 
-void gs_opengl_cmd_set_uniform_mat4(const GsCommandListItem item) {
-    const GsUniformMat4Command *cmd = (GsUniformMat4Command *) item.data;
+void gs_opengl_cmd_set_uniform_vec4(const GsCommandHeader *header) {
+    const GsUniformVec4Command *cmd = GS_COMMAND_DATA(header, GsUniformVec4Command);
+
+    if (!gs_opengl_uniform_unchanged(cmd->location, &cmd->x, sizeof(float) * 4, 1)) {
+        glUniform4f(cmd->location, cmd->x, cmd->y, cmd->z, cmd->w);
+    }
+}
+
+void gs_opengl_cmd_set_uniform_mat4(const GsCommandHeader *header) {
+    const GsUniformMat4Command *cmd = GS_COMMAND_DATA(header, GsUniformMat4Command);
 
     float mat[16] = {
         cmd->m00, cmd->m01, cmd->m02, cmd->m03,
@@ -633,11 +798,150 @@ void gs_opengl_cmd_set_uniform_mat4(const GsCommandListItem item) {
         cmd->m30, cmd->m31, cmd->m32, cmd->m33
     };
 
-    gs_opengl_internal_bind_state();
-    glUniformMatrix4fv(cmd->location, 1, GL_TRUE, mat);
+    if (!gs_opengl_uniform_unchanged(cmd->location, mat, sizeof(mat), 1)) {
+        glUniformMatrix4fv(cmd->location, 1, GL_TRUE, mat);
+    }
+}
+
+void gs_opengl_cmd_set_uniform_float_array(const GsCommandHeader *header) {
+    const GsUniformArrayCommand *cmd = GS_COMMAND_DATA(header, GsUniformArrayCommand);
+
+    if (!gs_opengl_uniform_unchanged(cmd->location, GS_UNIFORM_ARRAY_DATA(cmd), sizeof(float), cmd->count)) {
+        glUniform1fv(cmd->location, cmd->count, GS_UNIFORM_ARRAY_DATA(cmd));
+    }
+}
+
+void gs_opengl_cmd_set_uniform_vec2_array(const GsCommandHeader *header) {
+    const GsUniformArrayCommand *cmd = GS_COMMAND_DATA(header, GsUniformArrayCommand);
+
+    if (!gs_opengl_uniform_unchanged(cmd->location, GS_UNIFORM_ARRAY_DATA(cmd), sizeof(float) * 2, cmd->count)) {
+        glUniform2fv(cmd->location, cmd->count, GS_UNIFORM_ARRAY_DATA(cmd));
+    }
+}
+
+void gs_opengl_cmd_set_uniform_vec3_array(const GsCommandHeader *header) {
+    const GsUniformArrayCommand *cmd = GS_COMMAND_DATA(header, GsUniformArrayCommand);
+
+    if (!gs_opengl_uniform_unchanged(cmd->location, GS_UNIFORM_ARRAY_DATA(cmd), sizeof(float) * 3, cmd->count)) {
+        glUniform3fv(cmd->location, cmd->count, GS_UNIFORM_ARRAY_DATA(cmd));
+    }
+}
+
+void gs_opengl_cmd_set_uniform_vec4_array(const GsCommandHeader *header) {
+    const GsUniformArrayCommand *cmd = GS_COMMAND_DATA(header, GsUniformArrayCommand);
+
+    if (!gs_opengl_uniform_unchanged(cmd->location, GS_UNIFORM_ARRAY_DATA(cmd), sizeof(float) * 4, cmd->count)) {
+        glUniform4fv(cmd->location, cmd->count, GS_UNIFORM_ARRAY_DATA(cmd));
+    }
+}
+
+#if defined(GS_OPENGL_V200ES)
+// ES 2.0 rejects transposed matrix uploads, so row-major arrays are transposed here first.
+static float *transpose_scratch = NULL;
+static int transpose_scratch_capacity = 0;
+
+static const float *gs_opengl_transpose_matrices(const float *data, const int count, const int size) {
+    const int floats = count * size * size;
+    if (floats > transpose_scratch_capacity) {
+        float *scratch = (float*)GS_REALLOC(transpose_scratch, sizeof(float) * floats);
+        GS_ASSERT(scratch != NULL);
+
+        transpose_scratch = scratch;
+        transpose_scratch_capacity = floats;
+    }
+
+    for (int m = 0; m < count; m++) {
+        const float *src = data + m * size * size;
+        float *dst = transpose_scratch + m * size * size;
+
+        for (int row = 0; row < size; row++) {
+            for (int column = 0; column < size; column++) {
+                dst[column * size + row] = src[row * size + column];
+            }
+        }
+    }
+
+    return transpose_scratch;
+}
+#endif
+
+void gs_opengl_cmd_set_uniform_mat3_array(const GsCommandHeader *header) {
+    const GsUniformArrayCommand *cmd = GS_COMMAND_DATA(header, GsUniformArrayCommand);
+
+    if (gs_opengl_uniform_unchanged(cmd->location, GS_UNIFORM_ARRAY_DATA(cmd), sizeof(float) * 9, cmd->count)) {
+        return;
+    }
+
+    #if defined(GS_OPENGL_V200ES)
+        glUniformMatrix3fv(cmd->location, cmd->count, GL_FALSE, gs_opengl_transpose_matrices(GS_UNIFORM_ARRAY_DATA(cmd), cmd->count, 3));
+    #else
+        glUniformMatrix3fv(cmd->location, cmd->count, GL_TRUE, GS_UNIFORM_ARRAY_DATA(cmd));
+    #endif
+}
+
+void gs_opengl_cmd_set_uniform_mat4_array(const GsCommandHeader *header) {
+    const GsUniformArrayCommand *cmd = GS_COMMAND_DATA(header, GsUniformArrayCommand);
+
+    if (gs_opengl_uniform_unchanged(cmd->location, GS_UNIFORM_ARRAY_DATA(cmd), sizeof(float) * 16, cmd->count)) {
+        return;
+    }
+
+    #if defined(GS_OPENGL_V200ES)
+        glUniformMatrix4fv(cmd->location, cmd->count, GL_FALSE, gs_opengl_transpose_matrices(GS_UNIFORM_ARRAY_DATA(cmd), cmd->count, 4));
+    #else
+        glUniformMatrix4fv(cmd->location, cmd->count, GL_TRUE, GS_UNIFORM_ARRAY_DATA(cmd));
+    #endif
+}
+
+// Buffer an item's attribute pointer reads from, stream 0 is the bound vertex buffer.
+static GsBuffer *gs_opengl_get_stream_buffer(const int stream) {
+    if (stream == GS_VERTEX_STREAM_INSTANCE) {
+        return requested_instance_buffer;
+    }
+
+    return stream == 0 ? bound_vertex_buffer : requested_streams[stream];
+}
+
+static int gs_opengl_get_stream_stride(const GsVtxLayout *layout, const int stream) {
+    return stream == GS_VERTEX_STREAM_INSTANCE ? layout->instance_stride : layout->stream_strides[stream];
+}
+
+static void gs_opengl_attrib_pointer(const GsVtxLayoutItem *item, const int stride, const int offset) {
+    const void *pointer = (const void*)(uintptr_t)offset;
+
+    #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+    if (item->integer) {
+        glVertexAttribIPointer(item->index, item->components, gs_opengl_get_attrib_type(item->type), stride, pointer);
+        return;
+    }
+    #endif
+
+    #if defined(GS_OPENGL_V200ES)
+    if (item->integer) {
+        // always fail because it is not supported
+        GS_ASSERT(0);
+    }
+    #endif
+
+    glVertexAttribPointer(item->index, item->components, gs_opengl_get_attrib_type(item->type), item->normalized ? GL_TRUE : GL_FALSE, stride, pointer);
+}
+
+#if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+static GS_BOOL gs_opengl_layout_uses_attribute(const GsVtxLayout *layout, const int index) {
+    for (int i = 0; i < layout->count; i++) {
+        if (layout->items[i].index == index) {
+            return GS_TRUE;
+        }
+    }
+
+    return GS_FALSE;
 }
+#endif
 
 void gs_opengl_internal_bind_layout_state() {
+    // per-vertex items start base vertex vertices into the buffer, see gs_opengl_bind_draw_state
+    bound_base_vertex = requested_base_vertex;
+
     #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
     if (bound_vertex_buffer == NULL) {
         bound_layout = requested_layout;
@@ -646,19 +950,46 @@ void gs_opengl_internal_bind_layout_state() {
 
     GsOpenGLBufferHandle *handle = (GsOpenGLBufferHandle*)bound_vertex_buffer->handle;
     handle->lastLayout = requested_layout;
+    handle->lastInstanceBuffer = requested_instance_buffer;
+    handle->lastBaseVertex = requested_base_vertex;
+    memcpy(handle->lastStreams, requested_streams, sizeof(requested_streams));
+    bound_instance_buffer = requested_instance_buffer;
+    memcpy(bound_streams, requested_streams, sizeof(requested_streams));
 
     glBindBuffer(GL_ARRAY_BUFFER, handle->handle);
 
     if (requested_layout != NULL) {
+        GS_ASSERT(requested_layout->instance_stride == 0 || requested_instance_buffer != NULL);
+
+        // items of other streams come from their own buffer, GL_ARRAY_BUFFER is only switched when the source changes
+        GsBuffer *source = bound_vertex_buffer;
         for (int i = 0; i < requested_layout->count; i++) {
             const GsVtxLayoutItem item = requested_layout->items[i];
-            glVertexAttribPointer(item.index, item.components, gs_opengl_get_attrib_type(item.type), GL_FALSE, requested_layout->stride, (const void*)(uintptr_t)item.offset);
+            GsBuffer *item_source = gs_opengl_get_stream_buffer(item.stream);
+            GS_ASSERT(item_source != NULL);
+
+            if (item_source != source) {
+                glBindBuffer(GL_ARRAY_BUFFER, ((GsOpenGLBufferHandle*)item_source->handle)->handle);
+                source = item_source;
+            }
+
+            const int stride = gs_opengl_get_stream_stride(requested_layout, item.stream);
+            const int offset = item.divisor > 0 ? item.offset : item.offset + requested_base_vertex * stride;
+            gs_opengl_attrib_pointer(&item, stride, offset);
+            glVertexAttribDivisor(item.index, item.divisor);
             glEnableVertexAttribArray(item.index);
         }
 
-        if (bound_layout != NULL && requested_layout->count < bound_layout->count) {
-            for (int i = requested_layout->count; i < bound_layout->count; i++) {
-                glDisableVertexAttribArray(bound_layout->items[i].index);
+        if (source != bound_vertex_buffer) {
+            glBindBuffer(GL_ARRAY_BUFFER, handle->handle);
+        }
+
+        // attributes are matched by location, layouts may list the same ones in another order
+        if (bound_layout != NULL && bound_layout != requested_layout) {
+            for (int i = 0; i < bound_layout->count; i++) {
+                if (!gs_opengl_layout_uses_attribute(requested_layout, bound_layout->items[i].index)) {
+                    glDisableVertexAttribArray(bound_layout->items[i].index);
+                }
             }
         }
 
@@ -697,14 +1028,33 @@ void gs_opengl_internal_bind_layout_state() {
             }
         }
 
+        GsBuffer *source = bound_vertex_buffer;
         for (int i = 0; i < requested_layout->count; i++) {
             const GsVtxLayoutItem item = requested_layout->items[i];
-            glVertexAttribPointer(item.index, item.components,
-                gs_opengl_get_attrib_type(item.type), GL_FALSE,
-                requested_layout->stride, (const void*)(uintptr_t)item.offset);
+            if (item.divisor > 0) {
+                // always fail because it is not supported
+                GS_ASSERT(0);
+            }
+
+            GsBuffer *item_source = gs_opengl_get_stream_buffer(item.stream);
+            GS_ASSERT(item_source != NULL);
+
+            if (item_source != source) {
+                glBindBuffer(GL_ARRAY_BUFFER, ((GsOpenGLBufferHandle*)item_source->handle)->handle);
+                source = item_source;
+            }
+
+            const int stride = gs_opengl_get_stream_stride(requested_layout, item.stream);
+            const int offset = item.offset + requested_base_vertex * stride;
+            gs_opengl_attrib_pointer(&item, stride, offset);
             glEnableVertexAttribArray(item.index);
         }
 
+        if (source != bound_vertex_buffer) {
+            glBindBuffer(GL_ARRAY_BUFFER, handle->handle);
+        }
+
+        memcpy(bound_streams, requested_streams, sizeof(requested_streams));
         bound_layout = requested_layout;
         last_vertex_buffer_for_layout = bound_vertex_buffer;
         last_layout_for_buffer = requested_layout;
@@ -732,6 +1082,12 @@ void gs_opengl_internal_bind_buffer(GsBuffer *buffer) {
         case GS_BUFFER_TYPE_INDEX:
             requested_index_buffer = buffer;
             break;
+        case GS_BUFFER_TYPE_UNIFORM:
+            // bound per binding point by gs_opengl_cmd_use_uniform_block
+            break;
+        case GS_BUFFER_TYPE_INDIRECT:
+            // bound by the indirect draws that read it
+            break;
     }
 }
 
@@ -770,6 +1126,12 @@ void gs_opengl_internal_unbind_buffer(GsBufferType type) {
         case GS_BUFFER_TYPE_INDEX:
             requested_index_buffer = NULL;
             break;
+        case GS_BUFFER_TYPE_UNIFORM:
+            // bound per binding point by gs_opengl_cmd_use_uniform_block
+            break;
+        case GS_BUFFER_TYPE_INDIRECT:
+            // bound by the indirect draws that read it
+            break;
     }
 }
 
@@ -789,13 +1151,15 @@ void gs_opengl_internal_unbind_texture(int slot) {
 void gs_opengl_create_buffer(GsBuffer *buffer) {
     GS_ASSERT(buffer != NULL);
 
-    GLuint vbo;
+    GLuint vbo = 0;
     #if defined(GS_OPENGL_V460)
         glCreateBuffers(1, &vbo);
     #endif
 
     #if defined(GS_OPENGL_V200ES) || defined(GS_OPENGL_V320ES)
-        glGenBuffers(1, &vbo);
+        if (buffer->type != GS_BUFFER_TYPE_INDIRECT) {
+            glGenBuffers(1, &vbo);
+        }
     #endif
 
     GsOpenGLBufferHandle *handle = GS_ALLOC(GsOpenGLBufferHandle);
@@ -803,6 +1167,10 @@ void gs_opengl_create_buffer(GsBuffer *buffer) {
     handle->vaoHandle = 0xFF; // invalid
     handle->lastLayout = NULL;
     handle->lastIndexBuffer = NULL;
+    handle->lastInstanceBuffer = NULL;
+    GS_MEMSET(handle->lastStreams, 0, sizeof(handle->lastStreams));
+    handle->lastBaseVertex = 0;
+    handle->shadow = NULL;
 
     #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
         if (buffer->type == GS_BUFFER_TYPE_VERTEX) {
@@ -846,6 +1214,13 @@ void gs_opengl_set_buffer_data(GsBuffer *buffer, void *data, int size) {
 
     #if defined(GS_OPENGL_V320ES) || defined(GS_OPENGL_V200ES)
         GsOpenGLBufferHandle *handle = (GsOpenGLBufferHandle*)buffer->handle;
+        if (buffer->type == GS_BUFFER_TYPE_INDIRECT) {
+            GS_FREE(handle->shadow);
+            handle->shadow = (unsigned char*)GS_MALLOC(size);
+            memcpy(handle->shadow, data, size);
+            return;
+        }
+
         glBindBuffer(gs_opengl_get_buffer_type(buffer->type), handle->handle);
         glBufferData(gs_opengl_get_buffer_type(buffer->type), size, data, gs_opengl_get_buffer_intent(buffer->intent));
 
@@ -865,6 +1240,12 @@ void gs_opengl_set_buffer_partial_data(GsBuffer *buffer, void *data, int size, i
 
     #if defined(GS_OPENGL_V320ES) || defined(GS_OPENGL_V200ES)
         GsOpenGLBufferHandle *handle = (GsOpenGLBufferHandle*)buffer->handle;
+        if (buffer->type == GS_BUFFER_TYPE_INDIRECT) {
+            GS_ASSERT(handle->shadow != NULL && offset + size <= buffer->size);
+            memcpy(handle->shadow + offset, data, size);
+            return;
+        }
+
         glBindBuffer(gs_opengl_get_buffer_type(buffer->type), handle->handle);
         glBufferSubData(gs_opengl_get_buffer_type(buffer->type), offset, size, data);
 
@@ -885,8 +1266,37 @@ void gs_opengl_destroy_buffer(GsBuffer *buffer) {
         gs_opengl_internal_bind_state();
     }
 
+    if (requested_instance_buffer == buffer) {
+        requested_instance_buffer = NULL;
+    }
+
+    if (bound_instance_buffer == buffer) {
+        bound_instance_buffer = NULL;
+    }
+
+    for (int i = 1; i < GS_MAX_VERTEX_STREAMS; i++) {
+        if (requested_streams[i] == buffer) {
+            requested_streams[i] = NULL;
+        }
+
+        if (bound_streams[i] == buffer) {
+            bound_streams[i] = NULL;
+        }
+    }
+
+    if (bound_indirect_buffer == buffer) {
+        bound_indirect_buffer = NULL;
+    }
+
+    for (int i = 0; i < GS_MAX_UNIFORM_BLOCK_BINDINGS; i++) {
+        if (bound_uniform_blocks[i].buffer == buffer) {
+            bound_uniform_blocks[i].buffer = NULL;
+        }
+    }
+
     GsOpenGLBufferHandle *handle = (GsOpenGLBufferHandle*)buffer->handle;
     glDeleteBuffers(1, &handle->handle);
+    GS_FREE(handle->shadow);
 
     #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
         if (buffer->type == GS_BUFFER_TYPE_VERTEX) {
@@ -898,77 +1308,529 @@ void gs_opengl_destroy_buffer(GsBuffer *buffer) {
     buffer->handle = NULL;
 }
 
-#ifdef GS_OPENGL_DEBUG
-void gs_opengl_debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar *message, const void *userParam) {
-    if (severity == GL_DEBUG_SEVERITY_NOTIFICATION) {
-        return;
-    }
+// Immutable storage that stays mapped for the life of the buffer, coherent so writes need no explicit flush.
+void *gs_opengl_map_stream_buffer(GsBuffer *buffer, int capacity) {
+    GS_ASSERT(buffer != NULL);
+    GS_ASSERT(capacity > 0);
 
-    GS_LOG("OpenGL Debug: %s\n", message);
+    #if defined(GS_OPENGL_V460)
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLuint handle = ((GsOpenGLBufferHandle*)buffer->handle)->handle;
+
+        glNamedBufferStorage(handle, capacity, NULL, flags);
+        buffer->size = capacity;
+
+        return glMapNamedBufferRange(handle, 0, capacity, flags);
+    #endif
+
+    #if defined(GS_OPENGL_V320ES) || defined(GS_OPENGL_V200ES)
+        // no buffer storage, the ring is staged and orphaned instead
+        return NULL;
+    #endif
 }
-#endif
 
-GS_BOOL gs_opengl_init(GsBackend *backend, GsConfig *config) {
-    // GS_ASSERT(config->window != NULL);
-    GS_ASSERT(backend != NULL);
+void *gs_opengl_create_fence() {
+    #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        return (void*) glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    #endif
 
-    #ifdef GS_OPENGL_USE_GLAD
-        const int res = gladLoadGL((GLADloadfunc) gs_opengl_getproc);
+    #if defined(GS_OPENGL_V200ES)
+        return NULL;
+    #endif
+}
 
-        if (!res) {
-            GS_LOG("Failed to load OpenGL\n");
-            return GS_FALSE;
+GS_BOOL gs_opengl_wait_fence(void *fence, uint64_t timeout) {
+    #if defined(__EMSCRIPTEN__)
+        // WebGL never blocks on a sync object, finishing the pipeline is the closest there is
+        if (timeout > 0) {
+            glFinish();
+            return GS_TRUE;
         }
     #endif
 
-    #ifdef GS_OPENGL_DEBUG
-        glEnable(GL_DEBUG_OUTPUT);
-        glDebugMessageCallback((GLDEBUGPROC) gs_opengl_debug_callback, NULL);
+    #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        if (fence == NULL) {
+            return GS_TRUE;
+        }
+
+        // the first wait flushes, so the fence is guaranteed to reach the GPU
+        const GLuint64 step = timeout == GS_FENCE_WAIT_FOREVER ? GS_OPENGL_FENCE_WAIT_STEP : (GLuint64) timeout;
+        GLenum result = glClientWaitSync((GLsync) fence, GL_SYNC_FLUSH_COMMANDS_BIT, step);
+        while (result == GL_TIMEOUT_EXPIRED && timeout == GS_FENCE_WAIT_FOREVER) {
+            result = glClientWaitSync((GLsync) fence, 0, step);
+        }
+
+        GS_ASSERT(result != GL_WAIT_FAILED);
+        return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
     #endif
 
-    // caps
-    backend->capabilities = 0;
-    backend->capabilities |= GS_CAPABILITY_RENDERER;
+    #if defined(GS_OPENGL_V200ES)
+        // no sync objects, but everything fenced here already finished on the client when its call returned (texture
+        // reads go through glReadPixels), so a poll reports the fence signaled. Blocking waits finish the pipeline.
+        if (timeout > 0) {
+            glFinish();
+        }
 
-    return GS_TRUE;
+        return GS_TRUE;
+    #endif
 }
 
-void gs_opengl_shutdown(GsBackend *backend) {
-    GS_ASSERT(backend != NULL);
+void gs_opengl_destroy_fence(void *fence) {
+    #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        if (fence != NULL) {
+            glDeleteSync((GLsync) fence);
+        }
+    #endif
 }
 
-void gs_opengl_cmd_clear(const GsCommandListItem item) {
-    const GsClearCommand *cmd = (GsClearCommand *) item.data;
-    int flags = 0;
-
-    if (cmd->flags & GS_CLEAR_COLOR) {
-        flags |= GL_COLOR_BUFFER_BIT;
+#if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+// Pack buffers of finished readbacks are kept for the next ones, so a steady stream of reads cycles through the same
+// few buffers instead of allocating storage for every read.
+static GsOpenGLReadbackHandle readback_pool[GS_OPENGL_READBACK_POOL_SIZE];
+static int readback_pool_count = 0;
+
+// Takes the smallest pooled buffer that fits, otherwise grows one.
+static void gs_opengl_acquire_pack_buffer(GsOpenGLReadbackHandle *handle, int size) {
+    int found = -1;
+    for (int i = 0; i < readback_pool_count; i++) {
+        if (readback_pool[i].capacity >= size && (found == -1 || readback_pool[i].capacity < readback_pool[found].capacity)) {
+            found = i;
+        }
     }
 
-    if (cmd->flags & GS_CLEAR_DEPTH) {
-        flags |= GL_DEPTH_BUFFER_BIT;
+    if (found == -1 && readback_pool_count > 0) {
+        found = readback_pool_count - 1;
     }
 
-    if (cmd->flags & GS_CLEAR_STENCIL) {
-        flags |= GL_STENCIL_BUFFER_BIT;
+    if (found != -1) {
+        *handle = readback_pool[found];
+        readback_pool_count -= 1;
+        readback_pool[found] = readback_pool[readback_pool_count];
     }
 
-    if (clear_color.r != cmd->r || clear_color.g != cmd->g || clear_color.b != cmd->b || clear_color.a != cmd->a) {
-        glClearColor(cmd->r, cmd->g, cmd->b, cmd->a);
-        clear_color.r = cmd->r;
-        clear_color.g = cmd->g;
-        clear_color.b = cmd->b;
-        clear_color.a = cmd->a;
+    if (handle->capacity >= size) {
+        return;
     }
 
-    glClear(flags);
-}
+    #if defined(GS_OPENGL_V460)
+        if (handle->handle == 0) {
+            glCreateBuffers(1, &handle->handle);
+        }
 
-void gs_opengl_cmd_set_viewport(const GsCommandListItem item) {
-    const GsViewportCommand *cmd = (GsViewportCommand *) item.data;
-    if (cmd->width <= 0 || cmd->height <= 0) {
-        return;
-    }
+        glNamedBufferData(handle->handle, size, NULL, GL_STREAM_READ);
+    #endif
+
+    #if defined(GS_OPENGL_V320ES)
+        if (handle->handle == 0) {
+            glGenBuffers(1, &handle->handle);
+        }
+
+        // the copy targets are not part of the cached state, nothing has to be restored
+        glBindBuffer(GL_COPY_WRITE_BUFFER, handle->handle);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_READ);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    #endif
+
+    handle->capacity = size;
+}
+
+static void gs_opengl_release_pack_buffer(GsOpenGLReadbackHandle *handle) {
+    if (handle->mapped) {
+        #if defined(GS_OPENGL_V460)
+            glUnmapNamedBuffer(handle->handle);
+        #endif
+
+        #if defined(GS_OPENGL_V320ES)
+            glBindBuffer(GL_COPY_WRITE_BUFFER, handle->handle);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        #endif
+
+        handle->mapped = GS_FALSE;
+    }
+
+    if (readback_pool_count < GS_OPENGL_READBACK_POOL_SIZE) {
+        readback_pool[readback_pool_count] = *handle;
+        readback_pool_count += 1;
+    } else {
+        glDeleteBuffers(1, &handle->handle);
+    }
+}
+#endif
+
+static GsOpenGLReadbackHandle *gs_opengl_create_readback_handle(GsReadback *readback) {
+    GsOpenGLReadbackHandle *handle = GS_ALLOC(GsOpenGLReadbackHandle);
+    handle->handle = 0;
+    handle->capacity = 0;
+    handle->mapped = GS_FALSE;
+    handle->shadow = NULL;
+
+    readback->handle = (void*)handle;
+    return handle;
+}
+
+void gs_opengl_create_readback(GsReadback *readback, GsBuffer *buffer, int offset) {
+    GS_ASSERT(readback != NULL);
+    GS_ASSERT(buffer != NULL);
+    GS_ASSERT(offset >= 0 && offset + readback->size <= buffer->size);
+
+    GsOpenGLBufferHandle *source = (GsOpenGLBufferHandle*)buffer->handle;
+    GsOpenGLReadbackHandle *handle = gs_opengl_create_readback_handle(readback);
+
+    #if defined(GS_OPENGL_V460)
+        gs_opengl_acquire_pack_buffer(handle, readback->size);
+        glCopyNamedBufferSubData(source->handle, handle->handle, offset, 0, readback->size);
+    #endif
+
+    #if defined(GS_OPENGL_V320ES)
+        if (buffer->type == GS_BUFFER_TYPE_INDIRECT) {
+            handle->shadow = (unsigned char*)GS_MALLOC(readback->size);
+            memcpy(handle->shadow, source->shadow + offset, readback->size);
+            return;
+        }
+
+        gs_opengl_acquire_pack_buffer(handle, readback->size);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, handle->handle);
+        glBindBuffer(GL_COPY_READ_BUFFER, source->handle);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, readback->size);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    #endif
+
+    #if defined(GS_OPENGL_V200ES)
+        // always fail because it is not supported
+        (void) source;
+        (void) handle;
+        GS_ASSERT(0);
+    #endif
+}
+
+static void gs_opengl_get_transfer_format(GsTextureFormat format, GLenum *gl_format, GLenum *gl_type) {
+    switch (format) {
+        case GS_TEXTURE_FORMAT_RGBA8:
+            *gl_format = GL_RGBA;
+            *gl_type = GL_UNSIGNED_BYTE;
+            break;
+        case GS_TEXTURE_FORMAT_RGB8:
+            *gl_format = GL_RGB;
+            *gl_type = GL_UNSIGNED_BYTE;
+            break;
+        #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+            case GS_TEXTURE_FORMAT_RGBA16F:
+                *gl_format = GL_RGBA;
+                *gl_type = GL_HALF_FLOAT;
+                break;
+            case GS_TEXTURE_FORMAT_RGB16F:
+                *gl_format = GL_RGB;
+                *gl_type = GL_HALF_FLOAT;
+                break;
+        #endif
+        default:
+            // color formats only, GLES has no depth transfers
+            GS_ASSERT(0);
+            break;
+    }
+}
+
+// The texture is attached to a framebuffer of its own for the read, the bound framebuffer stays untouched.
+void gs_opengl_create_texture_readback(GsReadback *readback, GsTexture *texture, int x, int y, int width, int height) {
+    GS_ASSERT(readback != NULL);
+    GS_ASSERT(texture != NULL);
+    GS_ASSERT(texture->type == GS_TEXTURE_TYPE_2D);
+
+    static GLuint readback_fbo = 0;
+    if (readback_fbo == 0) {
+        glGenFramebuffers(1, &readback_fbo);
+    }
+
+    GLenum format = GL_RGBA;
+    GLenum type = GL_UNSIGNED_BYTE;
+    gs_opengl_get_transfer_format(texture->format, &format, &type);
+
+    GsOpenGLReadbackHandle *handle = gs_opengl_create_readback_handle(readback);
+    const GLuint previous_fbo = bound_framebuffer != NULL ? *(GLuint*)bound_framebuffer->handle : 0;
+
+    #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        gs_opengl_acquire_pack_buffer(handle, readback->size);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, readback_fbo);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *(GLuint*)texture->handle, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, handle->handle);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+        glReadPixels(x, y, width, height, format, type, NULL);
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, previous_fbo);
+    #endif
+
+    #if defined(GS_OPENGL_V200ES)
+        // no pack buffers, the read completes right here
+        handle->shadow = (unsigned char*)GS_MALLOC(readback->size);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, readback_fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *(GLuint*)texture->handle, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+        glReadPixels(x, y, width, height, format, type, handle->shadow);
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, previous_fbo);
+    #endif
+}
+
+void *gs_opengl_map_readback(GsReadback *readback) {
+    GS_ASSERT(readback != NULL);
+
+    GsOpenGLReadbackHandle *handle = (GsOpenGLReadbackHandle*)readback->handle;
+    if (handle->shadow != NULL) {
+        return handle->shadow;
+    }
+
+    #if defined(GS_OPENGL_V460)
+        handle->mapped = GS_TRUE;
+        return glMapNamedBufferRange(handle->handle, 0, readback->size, GL_MAP_READ_BIT);
+    #endif
+
+    #if defined(GS_OPENGL_V320ES) && defined(__EMSCRIPTEN__)
+        // WebGL can't map buffers, the copy lands in the shadow instead
+        handle->shadow = (unsigned char*)GS_MALLOC(readback->size);
+        GS_ASSERT(handle->shadow != NULL);
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, handle->handle);
+        glGetBufferSubData(GL_COPY_WRITE_BUFFER, 0, readback->size, handle->shadow);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        return handle->shadow;
+    #elif defined(GS_OPENGL_V320ES)
+        // stays mapped after the unbind, until the buffer goes back to the pool
+        glBindBuffer(GL_COPY_WRITE_BUFFER, handle->handle);
+        void *data = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, readback->size, GL_MAP_READ_BIT);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        handle->mapped = GS_TRUE;
+        return data;
+    #endif
+
+    #if defined(GS_OPENGL_V200ES)
+        // always fail because it is not supported
+        GS_ASSERT(0);
+        return NULL;
+    #endif
+}
+
+void gs_opengl_destroy_readback(GsReadback *readback) {
+    GS_ASSERT(readback != NULL);
+
+    GsOpenGLReadbackHandle *handle = (GsOpenGLReadbackHandle*)readback->handle;
+
+    #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        if (handle->handle != 0) {
+            gs_opengl_release_pack_buffer(handle);
+        }
+    #endif
+
+    GS_FREE(handle->shadow);
+    GS_FREE(handle);
+    readback->handle = NULL;
+}
+
+#if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+// Texture uploads are staged in a single unpack buffer used as a ring. Every upload fences the range it wrote, which is
+// only written again after that fence passed. The ring holds a few frames of uploads, so it is seldom waited on.
+static GLuint upload_ring = 0;
+static unsigned char *upload_ring_data = NULL; // persistently mapped on desktop
+static int upload_ring_capacity = 0;
+static int upload_ring_head = 0;
+static GsOpenGLUploadRange upload_ranges[GS_OPENGL_UPLOAD_RING_RANGES];
+static int upload_range_first = 0;
+static int upload_range_count = 0;
+
+static void gs_opengl_wait_upload_range() {
+    GsOpenGLUploadRange *range = &upload_ranges[upload_range_first];
+    gs_opengl_wait_fence(range->fence, GS_FENCE_WAIT_FOREVER);
+    gs_opengl_destroy_fence(range->fence);
+
+    upload_range_first = (upload_range_first + 1) % GS_OPENGL_UPLOAD_RING_RANGES;
+    upload_range_count -= 1;
+}
+
+static GS_BOOL gs_opengl_upload_range_used(int offset, int size) {
+    for (int i = 0; i < upload_range_count; i++) {
+        const GsOpenGLUploadRange *range = &upload_ranges[(upload_range_first + i) % GS_OPENGL_UPLOAD_RING_RANGES];
+        if (offset < range->offset + range->size && range->offset < offset + size) {
+            return GS_TRUE;
+        }
+    }
+
+    return GS_FALSE;
+}
+
+static void gs_opengl_destroy_upload_ring() {
+    while (upload_range_count > 0) {
+        gs_opengl_wait_upload_range();
+    }
+
+    if (upload_ring != 0) {
+        glDeleteBuffers(1, &upload_ring); // unmaps as well
+    }
+
+    upload_ring = 0;
+    upload_ring_data = NULL;
+    upload_ring_capacity = 0;
+    upload_ring_head = 0;
+}
+
+// Returns the offset of size free bytes, the caller fences them once the upload was issued.
+static int gs_opengl_reserve_upload(int size) {
+    size = (size + GS_OPENGL_UPLOAD_ALIGNMENT - 1) & ~(GS_OPENGL_UPLOAD_ALIGNMENT - 1);
+
+    if (size > upload_ring_capacity) {
+        int capacity = upload_ring_capacity > 0 ? upload_ring_capacity : GS_OPENGL_UPLOAD_RING_SIZE;
+        while (capacity < size) {
+            capacity *= 2;
+        }
+
+        gs_opengl_destroy_upload_ring();
+
+        #if defined(GS_OPENGL_V460)
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glCreateBuffers(1, &upload_ring);
+            glNamedBufferStorage(upload_ring, capacity, NULL, flags);
+            upload_ring_data = glMapNamedBufferRange(upload_ring, 0, capacity, flags);
+        #endif
+
+        #if defined(GS_OPENGL_V320ES)
+            glGenBuffers(1, &upload_ring);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload_ring);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        #endif
+
+        upload_ring_capacity = capacity;
+    }
+
+    if (upload_ring_head + size > upload_ring_capacity) {
+        upload_ring_head = 0;
+    }
+
+    while (upload_range_count == GS_OPENGL_UPLOAD_RING_RANGES || gs_opengl_upload_range_used(upload_ring_head, size)) {
+        gs_opengl_wait_upload_range();
+    }
+
+    const int offset = upload_ring_head;
+    upload_ring_head += size;
+
+    GsOpenGLUploadRange *range = &upload_ranges[(upload_range_first + upload_range_count) % GS_OPENGL_UPLOAD_RING_RANGES];
+    range->offset = offset;
+    range->size = size;
+    range->fence = NULL;
+    upload_range_count += 1;
+
+    return offset;
+}
+#endif
+
+#ifdef GS_OPENGL_DEBUG
+void gs_opengl_debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar *message, const void *userParam) {
+    if (severity == GL_DEBUG_SEVERITY_NOTIFICATION) {
+        return;
+    }
+
+    GS_LOG("OpenGL Debug: %s\n", message);
+}
+#endif
+
+GS_BOOL gs_opengl_init(GsBackend *backend, GsConfig *config) {
+    // GS_ASSERT(config->window != NULL);
+    GS_ASSERT(backend != NULL);
+
+    #ifdef GS_OPENGL_USE_GLAD
+        const int res = gladLoadGL((GLADloadfunc) gs_opengl_getproc);
+
+        if (!res) {
+            GS_LOG("Failed to load OpenGL\n");
+            return GS_FALSE;
+        }
+    #endif
+
+    #ifdef GS_OPENGL_DEBUG
+        glEnable(GL_DEBUG_OUTPUT);
+        glDebugMessageCallback((GLDEBUGPROC) gs_opengl_debug_callback, NULL);
+    #endif
+
+    backend_stats = &backend->stats;
+
+    // caps
+    backend->capabilities = 0;
+    backend->capabilities |= GS_CAPABILITY_RENDERER;
+
+    #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        backend->capabilities |= GS_CAPABILITY_UNIFORM_BUFFERS;
+        backend->capabilities |= GS_CAPABILITY_INSTANCING;
+        backend->capabilities |= GS_CAPABILITY_PACKED_ATTRIBUTES;
+        backend->capabilities |= GS_CAPABILITY_READBACK;
+        backend->capabilities |= GS_CAPABILITY_TEXTURE_STREAMING;
+    #endif
+
+    #if defined(GS_OPENGL_V460)
+        backend->capabilities |= GS_CAPABILITY_MULTI_DRAW_INDIRECT;
+        backend->capabilities |= GS_CAPABILITY_BASE_VERTEX;
+        backend->capabilities |= GS_CAPABILITY_PERSISTENT_MAPPING;
+    #endif
+
+    return GS_TRUE;
+}
+
+void gs_opengl_shutdown(GsBackend *backend) {
+    GS_ASSERT(backend != NULL);
+
+    #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        for (int i = 0; i < readback_pool_count; i++) {
+            glDeleteBuffers(1, &readback_pool[i].handle);
+        }
+
+        readback_pool_count = 0;
+
+        gs_opengl_destroy_upload_ring();
+    #endif
+}
+
+void gs_opengl_cmd_clear(const GsCommandHeader *header) {
+    const GsClearCommand *cmd = GS_COMMAND_DATA(header, GsClearCommand);
+    int flags = 0;
+
+    if (cmd->flags & GS_CLEAR_COLOR) {
+        flags |= GL_COLOR_BUFFER_BIT;
+    }
+
+    if (cmd->flags & GS_CLEAR_DEPTH) {
+        flags |= GL_DEPTH_BUFFER_BIT;
+    }
+
+    if (cmd->flags & GS_CLEAR_STENCIL) {
+        flags |= GL_STENCIL_BUFFER_BIT;
+    }
+
+    if (clear_color.r != cmd->r || clear_color.g != cmd->g || clear_color.b != cmd->b || clear_color.a != cmd->a) {
+        glClearColor(cmd->r, cmd->g, cmd->b, cmd->a);
+        clear_color.r = cmd->r;
+        clear_color.g = cmd->g;
+        clear_color.b = cmd->b;
+        clear_color.a = cmd->a;
+    }
+
+    glClear(flags);
+}
+
+void gs_opengl_cmd_set_viewport(const GsCommandHeader *header) {
+    const GsViewportCommand *cmd = GS_COMMAND_DATA(header, GsViewportCommand);
+    if (cmd->width <= 0 || cmd->height <= 0) {
+        return;
+    }
 
     if (bound_framebuffer != requested_framebuffer) {
         if (requested_framebuffer != NULL) {
@@ -1065,52 +1927,241 @@ void gs_opengl_internal_bind_pipeline(GsPipeline *pipeline) {
     bound_pipeline = pipeline;
 }
 
-void gs_opengl_cmd_use_pipeline(GsCommandListItem item) {
-    const GsPipelineCommand *cmd = (GsPipelineCommand *) item.data;
-    GsPipeline *pipeline = cmd->pipeline;
+void gs_opengl_cmd_use_pipeline(const GsCommandHeader *header) {
+    const GsPipelineCommand *cmd = GS_COMMAND_DATA(header, GsPipelineCommand);
+    GsPipeline *pipeline = gs_get_resource(cmd->pipeline, GS_RESOURCE_TYPE_PIPELINE);
 
     gs_opengl_internal_bind_pipeline(pipeline);
 }
 
-void gs_opengl_cmd_use_texture(const GsCommandListItem item) {
-    const GsTextureCommand *cmd = (GsTextureCommand *) item.data;
-    gs_opengl_internal_bind_texture(cmd->texture, cmd->slot);
+void gs_opengl_cmd_use_texture(const GsCommandHeader *header) {
+    const GsTextureCommand *cmd = GS_COMMAND_DATA(header, GsTextureCommand);
+    gs_opengl_internal_bind_texture(gs_get_resource(cmd->texture, GS_RESOURCE_TYPE_TEXTURE), cmd->slot);
 }
 
-void gs_opengl_cmd_begin_render_pass(const GsCommandListItem item) {
-    const GsBeginRenderPassCommand *cmd = (GsBeginRenderPassCommand *) item.data;
-    GS_ASSERT(cmd->pass != NULL);
+void gs_opengl_cmd_begin_render_pass(const GsCommandHeader *header) {
+    const GsBeginRenderPassCommand *cmd = GS_COMMAND_DATA(header, GsBeginRenderPassCommand);
+    const GsRenderPass *pass = gs_get_resource(cmd->pass, GS_RESOURCE_TYPE_RENDER_PASS);
+    GS_ASSERT(pass != NULL);
 
     gs_opengl_push_state();
-    gs_opengl_internal_bind_framebuffer(cmd->pass->framebuffer);
+    gs_opengl_internal_bind_framebuffer(pass->framebuffer);
 }
 
-void gs_opengl_cmd_end_render_pass(const GsCommandListItem item) {
-    const GsEndRenderPassCommand *cmd = (GsEndRenderPassCommand *) item.data;
-
+void gs_opengl_cmd_end_render_pass(const GsCommandHeader *header) {
     gs_opengl_pop_state();
 }
 
-void gs_opengl_cmd_use_buffer(const GsCommandListItem item) {
-    const GsUseBufferCommand *cmd = (GsUseBufferCommand *) item.data;
-    gs_opengl_internal_bind_buffer(cmd->buffer);
+void gs_opengl_cmd_use_buffer(const GsCommandHeader *header) {
+    const GsUseBufferCommand *cmd = GS_COMMAND_DATA(header, GsUseBufferCommand);
+    gs_opengl_internal_bind_buffer(gs_get_resource(cmd->buffer, GS_RESOURCE_TYPE_BUFFER));
 }
 
-void gs_opengl_cmd_draw_arrays(const GsCommandListItem item) {
-    const GsDrawArraysCommand *cmd = (GsDrawArraysCommand *) item.data;
+// Binds the requested state for a draw. GLES has no base vertex draws, there the attribute pointers of the per-vertex
+// items are moved forward by base_vertex vertices instead, which costs a layout rebind whenever it changes.
+static void gs_opengl_bind_draw_state(const int base_vertex) {
+    #if defined(GS_OPENGL_V320ES) || defined(GS_OPENGL_V200ES)
+        GS_ASSERT(base_vertex >= 0);
+        requested_base_vertex = base_vertex;
+    #endif
+
+    #if defined(GS_OPENGL_V460)
+        (void) base_vertex;
+    #endif
+
     gs_opengl_internal_bind_state();
+}
+
+static GLenum gs_opengl_get_index_type(const GsBuffer *buffer) {
+    GS_ASSERT(buffer != NULL);
+
+    return buffer->index_type == GS_INDEX_TYPE_UINT16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+// byte offset of the first index inside the bound index buffer
+static const void *gs_opengl_get_index_offset(const GsBuffer *buffer, const int first_index) {
+    GS_ASSERT(buffer != NULL);
+
+    const int size = buffer->index_type == GS_INDEX_TYPE_UINT16 ? (int) sizeof(uint16_t) : (int) sizeof(uint32_t);
+    return (const void*)(uintptr_t)(first_index * size);
+}
+
+void gs_opengl_cmd_draw_arrays(const GsCommandHeader *header) {
+    const GsDrawArraysCommand *cmd = GS_COMMAND_DATA(header, GsDrawArraysCommand);
+    gs_opengl_bind_draw_state(0);
     glDrawArrays(gs_opengl_get_primitive_type(primitive_type), cmd->start, cmd->count);
 }
 
-void gs_opengl_cmd_draw_indexed(const GsCommandListItem item) {
-    const GsDrawIndexedCommand *cmd = (GsDrawIndexedCommand *) item.data;
+void gs_opengl_cmd_draw_indexed(const GsCommandHeader *header) {
+    const GsDrawIndexedCommand *cmd = GS_COMMAND_DATA(header, GsDrawIndexedCommand);
 
-    gs_opengl_internal_bind_state();
-    glDrawElements(gs_opengl_get_primitive_type(primitive_type), cmd->count, GL_UNSIGNED_INT, 0);
+    gs_opengl_bind_draw_state(cmd->base_vertex);
+
+    const GLenum mode = gs_opengl_get_primitive_type(primitive_type);
+    const GLenum type = gs_opengl_get_index_type(bound_index_buffer);
+    const void *indices = gs_opengl_get_index_offset(bound_index_buffer, cmd->first_index);
+
+    #if defined(GS_OPENGL_V460)
+        if (cmd->base_vertex != 0) {
+            glDrawElementsBaseVertex(mode, cmd->count, type, indices, cmd->base_vertex);
+            return;
+        }
+    #endif
+
+    glDrawElements(mode, cmd->count, type, indices);
+}
+
+void gs_opengl_cmd_use_instance_buffer(const GsCommandHeader *header) {
+    const GsUseBufferCommand *cmd = GS_COMMAND_DATA(header, GsUseBufferCommand);
+    requested_instance_buffer = gs_get_resource(cmd->buffer, GS_RESOURCE_TYPE_BUFFER);
+}
+
+void gs_opengl_cmd_use_vertex_stream(const GsCommandHeader *header) {
+    const GsUseVertexStreamCommand *cmd = GS_COMMAND_DATA(header, GsUseVertexStreamCommand);
+    requested_streams[cmd->stream] = gs_get_resource(cmd->buffer, GS_RESOURCE_TYPE_BUFFER);
+}
+
+void gs_opengl_cmd_draw_arrays_instanced(const GsCommandHeader *header) {
+    #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        const GsDrawArraysInstancedCommand *cmd = GS_COMMAND_DATA(header, GsDrawArraysInstancedCommand);
+        gs_opengl_bind_draw_state(0);
+        glDrawArraysInstanced(gs_opengl_get_primitive_type(primitive_type), cmd->start, cmd->count, cmd->instances);
+    #endif
+
+    #if defined(GS_OPENGL_V200ES)
+        // always fail because it is not supported
+        GS_ASSERT(0);
+    #endif
 }
 
-void gs_opengl_cmd_set_scissor(const GsCommandListItem item) {
-    const GsScissorCommand *cmd = (GsScissorCommand *) item.data;
+void gs_opengl_cmd_draw_indexed_instanced(const GsCommandHeader *header) {
+    #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        const GsDrawIndexedInstancedCommand *cmd = GS_COMMAND_DATA(header, GsDrawIndexedInstancedCommand);
+        gs_opengl_bind_draw_state(cmd->base_vertex);
+
+        const GLenum mode = gs_opengl_get_primitive_type(primitive_type);
+        const GLenum type = gs_opengl_get_index_type(bound_index_buffer);
+        const void *indices = gs_opengl_get_index_offset(bound_index_buffer, cmd->first_index);
+    #endif
+
+    #if defined(GS_OPENGL_V460)
+        glDrawElementsInstancedBaseVertex(mode, cmd->count, type, indices, cmd->instances, cmd->base_vertex);
+    #endif
+
+    #if defined(GS_OPENGL_V320ES)
+        glDrawElementsInstanced(mode, cmd->count, type, indices, cmd->instances);
+    #endif
+
+    #if defined(GS_OPENGL_V200ES)
+        // always fail because it is not supported
+        GS_ASSERT(0);
+    #endif
+}
+
+#if defined(GS_OPENGL_V460)
+static void gs_opengl_bind_indirect_buffer(GsBuffer *buffer) {
+    if (bound_indirect_buffer != buffer) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ((GsOpenGLBufferHandle*)buffer->handle)->handle);
+        bound_indirect_buffer = buffer;
+    }
+}
+#endif
+
+#if defined(GS_OPENGL_V320ES) || defined(GS_OPENGL_V200ES)
+// GLES 3.0 and WebGL 2 have no indirect draws, so the parameters come from the CPU copy of the buffer and are drawn
+// one by one. gl_DrawID is not available this way.
+static void gs_opengl_draw_indirect_emulated(const GsBuffer *buffer, const GsDrawIndirectCommand *cmd) {
+    const GsOpenGLBufferHandle *handle = (GsOpenGLBufferHandle*)buffer->handle;
+    const int size = cmd->indexed ? (int) sizeof(GsDrawIndexedIndirectArgs) : (int) sizeof(GsDrawArraysIndirectArgs);
+    const int stride = cmd->stride > 0 ? cmd->stride : size;
+    const GLenum mode = gs_opengl_get_primitive_type(primitive_type);
+
+    GS_ASSERT(cmd->draw_count == 0 || (handle->shadow != NULL && cmd->offset + stride * (cmd->draw_count - 1) + size <= buffer->size));
+
+    for (int i = 0; i < cmd->draw_count; i++) {
+        const unsigned char *args = handle->shadow + cmd->offset + stride * i;
+
+        if (cmd->indexed) {
+            GsDrawIndexedIndirectArgs draw;
+            memcpy(&draw, args, sizeof(draw));
+            GS_ASSERT(draw.base_instance == 0);
+
+            gs_opengl_bind_draw_state(draw.base_vertex);
+            const GLenum type = gs_opengl_get_index_type(bound_index_buffer);
+            const void *indices = gs_opengl_get_index_offset(bound_index_buffer, (int) draw.first_index);
+            #if defined(GS_OPENGL_V320ES)
+                glDrawElementsInstanced(mode, (GLsizei) draw.count, type, indices, (GLsizei) draw.instance_count);
+            #else
+                GS_ASSERT(draw.instance_count <= 1);
+                if (draw.instance_count == 1) {
+                    glDrawElements(mode, (GLsizei) draw.count, type, indices);
+                }
+            #endif
+        } else {
+            GsDrawArraysIndirectArgs draw;
+            memcpy(&draw, args, sizeof(draw));
+            GS_ASSERT(draw.base_instance == 0);
+
+            gs_opengl_bind_draw_state(0);
+            #if defined(GS_OPENGL_V320ES)
+                glDrawArraysInstanced(mode, (GLint) draw.first, (GLsizei) draw.count, (GLsizei) draw.instance_count);
+            #else
+                GS_ASSERT(draw.instance_count <= 1);
+                if (draw.instance_count == 1) {
+                    glDrawArrays(mode, (GLint) draw.first, (GLsizei) draw.count);
+                }
+            #endif
+        }
+    }
+}
+#endif
+
+void gs_opengl_cmd_draw_indirect(const GsCommandHeader *header) {
+    const GsDrawIndirectCommand *cmd = GS_COMMAND_DATA(header, GsDrawIndirectCommand);
+    GsBuffer *buffer = gs_get_resource(cmd->buffer, GS_RESOURCE_TYPE_BUFFER);
+
+    #if defined(GS_OPENGL_V460)
+        gs_opengl_bind_draw_state(0);
+
+        const void *offset = (const void*)(uintptr_t) cmd->offset;
+        gs_opengl_bind_indirect_buffer(buffer);
+
+        if (cmd->indexed) {
+            glDrawElementsIndirect(gs_opengl_get_primitive_type(primitive_type), gs_opengl_get_index_type(bound_index_buffer), offset);
+        } else {
+            glDrawArraysIndirect(gs_opengl_get_primitive_type(primitive_type), offset);
+        }
+    #endif
+
+    #if defined(GS_OPENGL_V320ES) || defined(GS_OPENGL_V200ES)
+        gs_opengl_draw_indirect_emulated(buffer, cmd);
+    #endif
+}
+
+void gs_opengl_cmd_multi_draw_indirect(const GsCommandHeader *header) {
+    const GsDrawIndirectCommand *cmd = GS_COMMAND_DATA(header, GsDrawIndirectCommand);
+    GsBuffer *buffer = gs_get_resource(cmd->buffer, GS_RESOURCE_TYPE_BUFFER);
+
+    #if defined(GS_OPENGL_V460)
+        gs_opengl_bind_draw_state(0);
+
+        const void *offset = (const void*)(uintptr_t) cmd->offset;
+        gs_opengl_bind_indirect_buffer(buffer);
+
+        if (cmd->indexed) {
+            glMultiDrawElementsIndirect(gs_opengl_get_primitive_type(primitive_type), gs_opengl_get_index_type(bound_index_buffer), offset, cmd->draw_count, cmd->stride);
+        } else {
+            glMultiDrawArraysIndirect(gs_opengl_get_primitive_type(primitive_type), offset, cmd->draw_count, cmd->stride);
+        }
+    #endif
+
+    #if defined(GS_OPENGL_V320ES) || defined(GS_OPENGL_V200ES)
+        gs_opengl_draw_indirect_emulated(buffer, cmd);
+    #endif
+}
+
+void gs_opengl_cmd_set_scissor(const GsCommandHeader *header) {
+    const GsScissorCommand *cmd = GS_COMMAND_DATA(header, GsScissorCommand);
 
     if (cmd->enable == GS_TRUE) {
         glScissor(cmd->x, cmd->y, cmd->width, cmd->height);
@@ -1120,48 +2171,54 @@ void gs_opengl_cmd_set_scissor(const GsCommandListItem item) {
     }
 }
 
-void gs_opengl_cmd_copy_texture(const GsCommandListItem item) {
-    const GsCopyTextureCommand *cmd = (GsCopyTextureCommand *) item.data;
+void gs_opengl_cmd_copy_texture(const GsCommandHeader *header) {
+    const GsCopyTextureCommand *cmd = GS_COMMAND_DATA(header, GsCopyTextureCommand);
+    const GsTexture *src = gs_get_resource(cmd->src, GS_RESOURCE_TYPE_TEXTURE);
+    const GsTexture *dst = gs_get_resource(cmd->dst, GS_RESOURCE_TYPE_TEXTURE);
 
     #if defined(GS_OPENGL_V460)
-        glCopyImageSubData(*(GLuint*)cmd->src->handle, GL_TEXTURE_2D, 0, 0, 0, 0, *(GLuint*)cmd->dst->handle, GL_TEXTURE_2D, 0, 0, 0, 0, cmd->src->width, cmd->src->height, 1);
+        glCopyImageSubData(*(GLuint*)src->handle, GL_TEXTURE_2D, 0, 0, 0, 0, *(GLuint*)dst->handle, GL_TEXTURE_2D, 0, 0, 0, 0, src->width, src->height, 1);
     #endif
 
     #if defined(GS_OPENGL_V200ES) || defined(GS_OPENGL_V320ES)
-        GS_OPENGL_GLES2_COPY_TEXTURE_FALLBACK(copy_fbo, cmd->src, cmd->dst);
+        GS_OPENGL_GLES2_COPY_TEXTURE_FALLBACK(copy_fbo, src, dst);
     #endif
 }
 
-void gs_opengl_cmd_resolve_texture(const GsCommandListItem item) {
-    const GsResolveTextureCommand *cmd = (GsResolveTextureCommand *) item.data;
+void gs_opengl_cmd_resolve_texture(const GsCommandHeader *header) {
+    const GsResolveTextureCommand *cmd = GS_COMMAND_DATA(header, GsResolveTextureCommand);
+    GsTexture *src = gs_get_resource(cmd->src, GS_RESOURCE_TYPE_TEXTURE);
+    GsTexture *dst = gs_get_resource(cmd->dst, GS_RESOURCE_TYPE_TEXTURE);
 
-    gs_opengl_internal_bind_texture(cmd->src, 0);
-    gs_opengl_internal_bind_texture(cmd->dst, 1);
+    gs_opengl_internal_bind_texture(src, 0);
+    gs_opengl_internal_bind_texture(dst, 1);
 
     #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
-        glBlitFramebuffer(0, 0, cmd->src->width, cmd->src->height, 0, 0, cmd->dst->width, cmd->dst->height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBlitFramebuffer(0, 0, src->width, src->height, 0, 0, dst->width, dst->height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
     #endif
 
     #if defined(GS_OPENGL_V200ES)
-        GS_OPENGL_GLES2_COPY_TEXTURE_FALLBACK(resolve_fbo, cmd->src, cmd->dst);
+        GS_OPENGL_GLES2_COPY_TEXTURE_FALLBACK(resolve_fbo, src, dst);
     #endif
 }
 
-void gs_opengl_cmd_generate_mipmaps(const GsCommandListItem item) {
-    const GsGenMipmapsCommand *cmd = (GsGenMipmapsCommand *) item.data;
+void gs_opengl_cmd_generate_mipmaps(const GsCommandHeader *header) {
+    const GsGenMipmapsCommand *cmd = GS_COMMAND_DATA(header, GsGenMipmapsCommand);
 
-    gs_opengl_internal_bind_texture(cmd->texture, 0);
+    gs_opengl_internal_bind_texture(gs_get_resource(cmd->texture, GS_RESOURCE_TYPE_TEXTURE), 0);
     glGenerateMipmap(GL_TEXTURE_2D);
 }
 
-void gs_opengl_cmd_copy_texture_partial(const GsCommandListItem item) {
-    const GsCopyTexturePartialCommand *cmd = (GsCopyTexturePartialCommand *) item.data;
+void gs_opengl_cmd_copy_texture_partial(const GsCommandHeader *header) {
+    const GsCopyTexturePartialCommand *cmd = GS_COMMAND_DATA(header, GsCopyTexturePartialCommand);
+    GsTexture *src = gs_get_resource(cmd->src, GS_RESOURCE_TYPE_TEXTURE);
+    GsTexture *dst = gs_get_resource(cmd->dst, GS_RESOURCE_TYPE_TEXTURE);
 
-    gs_opengl_internal_bind_texture(cmd->src, 0);
-    gs_opengl_internal_bind_texture(cmd->dst, 1);
+    gs_opengl_internal_bind_texture(src, 0);
+    gs_opengl_internal_bind_texture(dst, 1);
 
     #if defined(GS_OPENGL_V460)
-        glCopyImageSubData(*(GLuint*)cmd->src->handle, GL_TEXTURE_2D, 0, cmd->src_x, cmd->src_y, 0, *(GLuint*)cmd->dst->handle, GL_TEXTURE_2D, 0, cmd->dst_x, cmd->dst_y, 0, cmd->width, cmd->height, 1);
+        glCopyImageSubData(*(GLuint*)src->handle, GL_TEXTURE_2D, 0, cmd->src_x, cmd->src_y, 0, *(GLuint*)dst->handle, GL_TEXTURE_2D, 0, cmd->dst_x, cmd->dst_y, 0, cmd->width, cmd->height, 1);
     #endif
 
     #if defined(GS_OPENGL_V200ES) || defined(GS_OPENGL_V320ES)
@@ -1169,6 +2226,154 @@ void gs_opengl_cmd_copy_texture_partial(const GsCommandListItem item) {
     #endif
 }
 
+void gs_opengl_cmd_update_buffer(const GsCommandHeader *header) {
+    const GsUpdateBufferCommand *cmd = GS_COMMAND_DATA(header, GsUpdateBufferCommand);
+    GsBuffer *buffer = gs_get_resource(cmd->buffer, GS_RESOURCE_TYPE_BUFFER);
+
+    if (cmd->partial) {
+        gs_opengl_set_buffer_partial_data(buffer, gs_command_pointer_get(cmd->data), cmd->size, cmd->offset);
+    } else {
+        gs_opengl_set_buffer_data(buffer, gs_command_pointer_get(cmd->data), cmd->size);
+    }
+}
+
+void gs_opengl_cmd_update_texture(const GsCommandHeader *header) {
+    const GsUpdateTextureCommand *cmd = GS_COMMAND_DATA(header, GsUpdateTextureCommand);
+
+    // binds on unit 0 directly, the requested bindings are applied again on the next draw
+    gs_opengl_set_texture_data(gs_get_resource(cmd->texture, GS_RESOURCE_TYPE_TEXTURE), cmd->face, gs_command_pointer_get(cmd->data));
+}
+
+void gs_opengl_cmd_execute_bundle(const GsCommandHeader *header) {
+    const GsExecuteBundleCommand *cmd = GS_COMMAND_DATA(header, GsExecuteBundleCommand);
+    const GsCommandList *bundle = gs_get_resource(cmd->bundle, GS_RESOURCE_TYPE_BUNDLE);
+    const GsOpenGLBundle *baked = (const GsOpenGLBundle*)bundle->handle;
+
+    for (int i = 0; i < baked->count; i++) {
+        const GsOpenGLBundleOp *op = &baked->ops[i];
+
+        switch (op->type) {
+            case GS_COMMAND_USE_PIPELINE:
+                gs_opengl_internal_bind_pipeline(gs_get_resource(op->resource, GS_RESOURCE_TYPE_PIPELINE));
+                break;
+            case GS_COMMAND_USE_BUFFER:
+                gs_opengl_internal_bind_buffer(gs_get_resource(op->resource, GS_RESOURCE_TYPE_BUFFER));
+                break;
+            case GS_COMMAND_USE_TEXTURE:
+                gs_opengl_internal_bind_texture(gs_get_resource(op->resource, GS_RESOURCE_TYPE_TEXTURE), op->slot);
+                break;
+            default:
+                op->handler(op->header);
+                break;
+        }
+    }
+}
+
+void gs_opengl_create_bundle(GsCommandList *bundle) {
+    GS_ASSERT(bundle != NULL);
+
+    GsOpenGLBundle *baked = GS_ALLOC(GsOpenGLBundle);
+    baked->ops = bundle->count > 0 ? GS_ALLOC_MULTIPLE(GsOpenGLBundleOp, bundle->count) : NULL;
+    baked->count = 0;
+
+    // binds that repeat what the bundle already bound earlier are dropped while baking
+    GsResourceId pipeline = GS_INVALID_RESOURCE_ID;
+    GsResourceId vertex_buffer = GS_INVALID_RESOURCE_ID;
+    GsResourceId index_buffer = GS_INVALID_RESOURCE_ID;
+    GsResourceId textures[GS_MAX_TEXTURE_SLOTS];
+    for (int i = 0; i < GS_MAX_TEXTURE_SLOTS; i++) {
+        textures[i] = GS_INVALID_RESOURCE_ID;
+    }
+
+    GsCommandIterator iterator;
+    gs_command_list_iter_begin(bundle, &iterator);
+
+    const GsCommandHeader *header;
+    while ((header = gs_command_list_iter_next(&iterator)) != NULL) {
+        GS_ASSERT(header->type < GS_TABLE_SIZE(gs_opengl_commands));
+
+        GsOpenGLBundleOp op;
+        op.type = (GsCommandType) header->type;
+        op.handler = gs_opengl_commands[header->type];
+        op.header = header;
+        op.resource = GS_INVALID_RESOURCE_ID;
+        op.slot = 0;
+
+        switch (header->type) {
+            case GS_COMMAND_USE_PIPELINE: {
+                GsResourceId resource = GS_COMMAND_DATA(header, GsPipelineCommand)->pipeline;
+                if (resource == pipeline) {
+                    continue;
+                }
+
+                pipeline = resource;
+                op.resource = resource;
+                break;
+            }
+            case GS_COMMAND_USE_BUFFER: {
+                GsResourceId resource = GS_COMMAND_DATA(header, GsUseBufferCommand)->buffer;
+                const GsBuffer *buffer = gs_get_resource(resource, GS_RESOURCE_TYPE_BUFFER);
+                GsResourceId *bound = buffer->type == GS_BUFFER_TYPE_VERTEX ? &vertex_buffer : &index_buffer;
+                if (resource == *bound) {
+                    continue;
+                }
+
+                *bound = resource;
+                op.resource = resource;
+                break;
+            }
+            case GS_COMMAND_USE_TEXTURE: {
+                const GsTextureCommand *cmd = GS_COMMAND_DATA(header, GsTextureCommand);
+                GsResourceId resource = cmd->texture;
+                GS_ASSERT(cmd->slot >= 0 && cmd->slot < GS_MAX_TEXTURE_SLOTS);
+
+                if (resource == textures[cmd->slot]) {
+                    continue;
+                }
+
+                textures[cmd->slot] = resource;
+                op.resource = resource;
+                op.slot = cmd->slot;
+                break;
+            }
+            case GS_COMMAND_COPY_TEXTURE_PARTIAL:
+            case GS_COMMAND_RESOLVE_TEXTURE:
+            case GS_COMMAND_GEN_MIPMAPS:
+                // these rebind texture slots internally
+                for (int i = 0; i < GS_MAX_TEXTURE_SLOTS; i++) {
+                    textures[i] = GS_INVALID_RESOURCE_ID;
+                }
+                break;
+            case GS_COMMAND_EXECUTE_BUNDLE:
+                pipeline = GS_INVALID_RESOURCE_ID;
+                vertex_buffer = GS_INVALID_RESOURCE_ID;
+                index_buffer = GS_INVALID_RESOURCE_ID;
+                for (int i = 0; i < GS_MAX_TEXTURE_SLOTS; i++) {
+                    textures[i] = GS_INVALID_RESOURCE_ID;
+                }
+                break;
+            default:
+                break;
+        }
+
+        baked->ops[baked->count] = op;
+        baked->count += 1;
+    }
+
+    bundle->handle = baked;
+}
+
+void gs_opengl_destroy_bundle(GsCommandList *bundle) {
+    GS_ASSERT(bundle != NULL);
+    GS_ASSERT(bundle->handle != NULL);
+
+    GsOpenGLBundle *baked = (GsOpenGLBundle*)bundle->handle;
+    GS_FREE(baked->ops);
+    GS_FREE(baked);
+
+    bundle->handle = NULL;
+}
+
 const char *gs_opengl_command_names[] = {
     "GS_COMMAND_CLEAR",
     "GS_COMMAND_SET_VIEWPORT",
@@ -1189,21 +2394,38 @@ const char *gs_opengl_command_names[] = {
     "GS_COMMAND_COPY_TEXTURE",
     "GS_COMMAND_RESOLVE_TEXTURE",
     "GS_COMMAND_GEN_MIPMAPS",
-    "GS_COMMAND_COPY_TEXTURE_PARTIAL"
+    "GS_COMMAND_COPY_TEXTURE_PARTIAL",
+    "GS_COMMAND_EXECUTE_BUNDLE",
+    "GS_COMMAND_UPDATE_BUFFER",
+    "GS_COMMAND_UPDATE_TEXTURE",
+    "GS_COMMAND_SET_UNIFORM_FLOAT_ARRAY",
+    "GS_COMMAND_SET_UNIFORM_VEC2_ARRAY",
+    "GS_COMMAND_SET_UNIFORM_VEC3_ARRAY",
+    "GS_COMMAND_SET_UNIFORM_VEC4_ARRAY",
+    "GS_COMMAND_SET_UNIFORM_MAT3_ARRAY",
+    "GS_COMMAND_SET_UNIFORM_MAT4_ARRAY",
+    "GS_COMMAND_USE_UNIFORM_BLOCK",
+    "GS_COMMAND_USE_INSTANCE_BUFFER",
+    "GS_COMMAND_DRAW_ARRAYS_INSTANCED",
+    "GS_COMMAND_DRAW_INDEXED_INSTANCED",
+    "GS_COMMAND_DRAW_INDIRECT",
+    "GS_COMMAND_MULTI_DRAW_INDIRECT",
+    "GS_COMMAND_USE_VERTEX_STREAM"
 };
 
 void gs_opengl_submit(GsBackend *backend, GsCommandList *list) {
     GS_ASSERT(backend != NULL);
     GS_ASSERT(list != NULL);
 
-    for (int i = 0; i < list->count; i++) {
-        const GsCommandListItem item = list->items[i];
+    GsCommandIterator iterator;
+    gs_command_list_iter_begin(list, &iterator);
 
-        GS_ASSERT(item.type >= 0);
-        GS_ASSERT(item.type < GS_TABLE_SIZE(gs_opengl_commands));
+    const GsCommandHeader *header;
+    while ((header = gs_command_list_iter_next(&iterator)) != NULL) {
+        GS_ASSERT(header->type < GS_TABLE_SIZE(gs_opengl_commands));
 
-        const GsCommandHandler handler = gs_opengl_commands[item.type];
-        handler(item);
+        const GsCommandHandler handler = gs_opengl_commands[header->type];
+        handler(header);
     }
 
     #if defined(GS_OPENGL_LOG_ERRORS)
@@ -1259,46 +2481,312 @@ void gs_opengl_destroy_shader(GsShader *shader) {
     shader->handle = NULL;
 }
 
+// Bytes per element of the uniform types the shadow cache understands, 0 for types it leaves alone.
+static int gs_opengl_uniform_type_size(const GLenum type) {
+    switch (type) {
+        case GL_FLOAT:
+        case GL_INT:
+        case GL_BOOL:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_CUBE:
+        #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_CUBE_SHADOW:
+        #endif
+            return 4;
+        case GL_FLOAT_VEC2:
+        case GL_INT_VEC2:
+        case GL_BOOL_VEC2:
+            return 8;
+        case GL_FLOAT_VEC3:
+        case GL_INT_VEC3:
+        case GL_BOOL_VEC3:
+            return 12;
+        case GL_FLOAT_VEC4:
+        case GL_INT_VEC4:
+        case GL_BOOL_VEC4:
+        case GL_FLOAT_MAT2:
+            return 16;
+        case GL_FLOAT_MAT3:
+            return 36;
+        case GL_FLOAT_MAT4:
+            return 64;
+        default:
+            return 0;
+    }
+}
+
+static int gs_opengl_uniform_matrix_size(const GLenum type) {
+    switch (type) {
+        case GL_FLOAT_MAT2:
+            return 2;
+        case GL_FLOAT_MAT3:
+            return 3;
+        case GL_FLOAT_MAT4:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+static GS_BOOL gs_opengl_uniform_is_float(const GLenum type) {
+    return type == GL_FLOAT || type == GL_FLOAT_VEC2 || type == GL_FLOAT_VEC3 || type == GL_FLOAT_VEC4 || gs_opengl_uniform_matrix_size(type) > 0;
+}
+
+static GsVariableType gs_opengl_variable_type(const GLenum type) {
+    switch (type) {
+        case GL_FLOAT:
+            return GS_VARIABLE_TYPE_FLOAT;
+        case GL_FLOAT_VEC2:
+            return GS_VARIABLE_TYPE_VEC2;
+        case GL_FLOAT_VEC3:
+            return GS_VARIABLE_TYPE_VEC3;
+        case GL_FLOAT_VEC4:
+            return GS_VARIABLE_TYPE_VEC4;
+        case GL_INT:
+            return GS_VARIABLE_TYPE_INT;
+        case GL_INT_VEC2:
+            return GS_VARIABLE_TYPE_IVEC2;
+        case GL_INT_VEC3:
+            return GS_VARIABLE_TYPE_IVEC3;
+        case GL_INT_VEC4:
+            return GS_VARIABLE_TYPE_IVEC4;
+        case GL_BOOL:
+            return GS_VARIABLE_TYPE_BOOL;
+        case GL_BOOL_VEC2:
+            return GS_VARIABLE_TYPE_BVEC2;
+        case GL_BOOL_VEC3:
+            return GS_VARIABLE_TYPE_BVEC3;
+        case GL_BOOL_VEC4:
+            return GS_VARIABLE_TYPE_BVEC4;
+        case GL_FLOAT_MAT2:
+            return GS_VARIABLE_TYPE_MAT2;
+        case GL_FLOAT_MAT3:
+            return GS_VARIABLE_TYPE_MAT3;
+        case GL_FLOAT_MAT4:
+            return GS_VARIABLE_TYPE_MAT4;
+        case GL_SAMPLER_2D:
+            return GS_VARIABLE_TYPE_SAMPLER_2D;
+        case GL_SAMPLER_CUBE:
+            return GS_VARIABLE_TYPE_SAMPLER_CUBE;
+        #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        case GL_SAMPLER_3D:
+            return GS_VARIABLE_TYPE_SAMPLER_3D;
+        case GL_SAMPLER_2D_SHADOW:
+            return GS_VARIABLE_TYPE_SAMPLER_2D_SHADOW;
+        case GL_SAMPLER_2D_ARRAY:
+            return GS_VARIABLE_TYPE_SAMPLER_2D_ARRAY;
+        case GL_SAMPLER_CUBE_SHADOW:
+            return GS_VARIABLE_TYPE_SAMPLER_CUBE_SHADOW;
+        #endif
+        default:
+            return GS_VARIABLE_TYPE_UNKNOWN;
+    }
+}
+
+// Registers every active attribute with the program so it can be looked up by name hash.
+static void gs_opengl_reflect_attributes(GsProgram *program) {
+    const GLuint handle = ((GsOpenGLProgramHandle*)program->handle)->handle;
+
+    GLint active = 0;
+    GLint name_length = 0;
+    glGetProgramiv(handle, GL_ACTIVE_ATTRIBUTES, &active);
+    glGetProgramiv(handle, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &name_length);
+
+    if (active <= 0 || name_length <= 0) {
+        return;
+    }
+
+    char *name = (char*)GS_ALLOC_MULTIPLE(char, name_length);
+    for (GLint i = 0; i < active; i++) {
+        GLint count = 0;
+        GLenum type = 0;
+        glGetActiveAttrib(handle, i, name_length, NULL, &count, &type, name);
+
+        // built-ins like gl_VertexID have no location
+        const GLint location = glGetAttribLocation(handle, name);
+        if (location < 0) {
+            continue;
+        }
+
+        char *bracket = strchr(name, '[');
+        if (bracket != NULL && strcmp(bracket, "[0]") == 0) {
+            *bracket = '\0';
+        }
+
+        gs_program_add_attribute(program, name, location, gs_opengl_variable_type(type), count);
+    }
+
+    GS_FREE(name);
+}
+
+// Registers every active uniform with the program and fills its shadow with the value it has after linking, uniforms
+// inside blocks have no location and are skipped. Matrices are kept row-major, the layout the uniform commands upload
+// with.
+static void gs_opengl_reflect_uniforms(GsProgram *program) {
+    GsOpenGLProgramHandle *handle = (GsOpenGLProgramHandle*)program->handle;
+
+    GLint active = 0;
+    GLint name_length = 0;
+    glGetProgramiv(handle->handle, GL_ACTIVE_UNIFORMS, &active);
+    glGetProgramiv(handle->handle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &name_length);
+
+    if (active <= 0 || name_length <= 0) {
+        return;
+    }
+
+    // room for the element index appended to array names
+    char *name = (char*)GS_ALLOC_MULTIPLE(char, name_length + 16);
+    char *element = (char*)GS_ALLOC_MULTIPLE(char, name_length + 16);
+
+    int value_size = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (GLint i = 0; i < active; i++) {
+            GLint count = 0;
+            GLenum type = 0;
+            glGetActiveUniform(handle->handle, i, name_length, NULL, &count, &type, name);
+
+            const int size = gs_opengl_uniform_type_size(type);
+            if (size == 0) {
+                continue;
+            }
+
+            // array names are reported with a trailing [0]
+            char *bracket = strchr(name, '[');
+            const GS_BOOL array = bracket != NULL && strcmp(bracket, "[0]") == 0;
+            if (array) {
+                *bracket = '\0';
+            }
+
+            if (pass == 0) {
+                const GLint location = glGetUniformLocation(handle->handle, name);
+                if (location >= 0) {
+                    gs_program_add_uniform(program, name, location, gs_opengl_variable_type(type), count);
+                }
+            }
+
+            const int offset = value_size;
+            value_size += size * count;
+
+            for (int e = 0; e < count; e++) {
+                if (array) {
+                    snprintf(element, name_length + 16, "%s[%d]", name, e);
+                } else {
+                    snprintf(element, name_length + 16, "%s", name);
+                }
+
+                const GLint location = glGetUniformLocation(handle->handle, element);
+                if (location < 0 || location >= GS_OPENGL_MAX_UNIFORM_SHADOW_LOCATIONS) {
+                    continue;
+                }
+
+                if (pass == 0) {
+                    if (location >= handle->uniform_count) {
+                        handle->uniform_count = location + 1;
+                    }
+
+                    continue;
+                }
+
+                GsOpenGLUniformShadow *shadow = &handle->uniforms[location];
+                shadow->offset = offset + size * e;
+                shadow->size = size;
+                shadow->remaining = count - e;
+
+                void *value = handle->values + shadow->offset;
+                if (gs_opengl_uniform_is_float(type)) {
+                    glGetUniformfv(handle->handle, location, (GLfloat*) value);
+                } else {
+                    glGetUniformiv(handle->handle, location, (GLint*) value);
+                }
+
+                const int dimension = gs_opengl_uniform_matrix_size(type);
+                float *matrix = (float*) value;
+                for (int row = 0; row < dimension; row++) {
+                    for (int column = row + 1; column < dimension; column++) {
+                        const float swap = matrix[row * dimension + column];
+                        matrix[row * dimension + column] = matrix[column * dimension + row];
+                        matrix[column * dimension + row] = swap;
+                    }
+                }
+            }
+        }
+
+        if (pass == 0) {
+            if (handle->uniform_count == 0) {
+                break;
+            }
+
+            handle->uniforms = GS_ALLOC_MULTIPLE(GsOpenGLUniformShadow, handle->uniform_count);
+            handle->values = (unsigned char*)GS_MALLOC(value_size > 0 ? value_size : 1);
+
+            for (int l = 0; l < handle->uniform_count; l++) {
+                handle->uniforms[l].offset = -1;
+                handle->uniforms[l].size = 0;
+                handle->uniforms[l].remaining = 0;
+            }
+
+            value_size = 0;
+        }
+    }
+
+    GS_FREE(name);
+    GS_FREE(element);
+}
+
 void gs_opengl_create_program(GsProgram *program) {
     GS_ASSERT(program != NULL);
 
-    GLuint* handle = GS_ALLOC(GLuint);
-    *handle = glCreateProgram();
+    GsOpenGLProgramHandle *handle = GS_ALLOC(GsOpenGLProgramHandle);
+    handle->handle = glCreateProgram();
+    handle->uniforms = NULL;
+    handle->uniform_count = 0;
+    handle->values = NULL;
 
     program->handle = handle;
 
     if (program->vertex != NULL) {
-        glAttachShader(*(GLuint*)program->handle, *(GLuint*)program->vertex->handle);
+        glAttachShader(handle->handle, *(GLuint*)program->vertex->handle);
     }
 
     if (program->fragment != NULL) {
-        glAttachShader(*(GLuint*)program->handle, *(GLuint*)program->fragment->handle);
+        glAttachShader(handle->handle, *(GLuint*)program->fragment->handle);
     }
 
-    glLinkProgram(*(GLuint*)program->handle);
+    glLinkProgram(handle->handle);
 
     GLint linked = 0;
-    glGetProgramiv(*(GLuint*)program->handle, GL_LINK_STATUS, &linked);
+    glGetProgramiv(handle->handle, GL_LINK_STATUS, &linked);
 
     if (!linked) {
         GLint logLength = 0;
-        glGetProgramiv(*(GLuint*)program->handle, GL_INFO_LOG_LENGTH, &logLength);
+        glGetProgramiv(handle->handle, GL_INFO_LOG_LENGTH, &logLength);
         if (logLength > 1) {
             char *log = (char *)GS_ALLOC_MULTIPLE(char, logLength);
-            glGetProgramInfoLog(*(GLuint*)program->handle, logLength, NULL, log);
+            glGetProgramInfoLog(handle->handle, logLength, NULL, log);
             GS_LOG("Program link error: %s\n", log);
             GS_FREE(log);
         } else {
             GS_LOG("Program link failed with no log.\n");
         }
+
+        return;
     }
+
+    gs_opengl_reflect_uniforms(program);
+    gs_opengl_reflect_attributes(program);
 }
 
 void gs_opengl_destroy_program(GsProgram *program) {
     GS_ASSERT(program != NULL);
 
-    glDeleteProgram(*(GLuint*)program->handle);
+    GsOpenGLProgramHandle *handle = (GsOpenGLProgramHandle*)program->handle;
+    glDeleteProgram(handle->handle);
 
+    GS_FREE(handle->uniforms);
+    GS_FREE(handle->values);
     GS_FREE(program->handle);
     program->handle = NULL;
 }
@@ -1395,6 +2883,19 @@ int gs_opengl_get_primitive_type(GsPrimitiveType type) {
     return gs_opengl_primitive_types[type];
 }
 
+static int gs_opengl_get_texture_storage_bit(const GsTexture *texture, GsCubemapFace face, int level) {
+    if (texture->levels > 1) {
+        return 1 << level;
+    }
+
+    return 1 << (texture->type == GS_TEXTURE_TYPE_CUBEMAP ? face : GS_CUBEMAP_FACE_NONE);
+}
+
+static int gs_opengl_get_level_size(int size, int level) {
+    size >>= level;
+    return size > 0 ? size : 1;
+}
+
 void gs_opengl_create_texture(GsTexture *texture) {
     GS_ASSERT(texture != NULL);
 
@@ -1402,6 +2903,50 @@ void gs_opengl_create_texture(GsTexture *texture) {
     glGenTextures(1, handle);
 
     texture->handle = handle;
+
+    #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        if (texture->levels > 1) {
+            // streamed, no level is sampled until the smallest one arrived
+            gs_opengl_set_texture_levels(texture, texture->levels - 1, texture->levels);
+        }
+    #endif
+}
+
+// Levels below the base level don't take part in completeness, their storage can be released while the texture is
+// sampled from the coarser ones.
+void gs_opengl_set_texture_levels(GsTexture *texture, int base_level, int keep_level) {
+    GS_ASSERT(texture != NULL);
+    GS_ASSERT(texture->type == GS_TEXTURE_TYPE_2D);
+    GS_ASSERT(base_level >= 0 && base_level <= texture->levels);
+
+    #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        if (bound_textures[0] != texture) {
+            gs_opengl_internal_active_texture(0);
+            glBindTexture(GL_TEXTURE_2D, *(GLuint*)texture->handle);
+            bound_textures[0] = texture;
+        }
+
+        GLenum format;
+        GLenum type;
+        gs_opengl_get_transfer_format(texture->format, &format, &type);
+
+        for (int level = 0; level < keep_level && level < texture->levels; level++) {
+            if ((texture->storage & (1 << level)) != 0) {
+                glTexImage2D(GL_TEXTURE_2D, level, gs_opengl_get_texture_format(texture->format), 0, 0, 0, format, type, NULL);
+                texture->storage &= ~(1 << level);
+            }
+        }
+
+        // base_level == levels means no level is resident yet, it is clamped to levels - 1 and the texture stays
+        // incomplete until that level arrives
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture->levels - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, base_level < texture->levels ? base_level : texture->levels - 1);
+    #endif
+
+    #if defined(GS_OPENGL_V200ES)
+        // always fail because it is not supported
+        GS_ASSERT(0);
+    #endif
 }
 
 void gs_opengl_clear_texture(GsTexture *texture) {
@@ -1425,6 +2970,8 @@ void gs_opengl_clear_texture(GsTexture *texture) {
             }
             break;
     }
+
+    texture->storage |= texture->type == GS_TEXTURE_TYPE_CUBEMAP ? (1 << GS_CUBEMAP_FACE_NONE) - 1 : gs_opengl_get_texture_storage_bit(texture, GS_CUBEMAP_FACE_NONE, 0);
 }
 
 void gs_opengl_update_texture_state(GsTexture* texture) {
@@ -1470,17 +3017,120 @@ void gs_opengl_set_texture_data(GsTexture *texture, GsCubemapFace face, void *da
             glTexImage2D(gs_opengl_get_face_type(face), 0, gs_opengl_get_texture_format(texture->format), texture->width, texture->height, 0, gs_opengl_get_texture_format(texture->format), GL_UNSIGNED_BYTE, data);
             break;
     }
+
+    texture->storage |= gs_opengl_get_texture_storage_bit(texture, face, 0);
+}
+
+// The pixels are copied into the upload ring and the texture is filled from there, so the driver never has to copy
+// or wait on client memory. GLES2 has no unpack buffers and uploads from client memory.
+void gs_opengl_upload_texture(GsTexture *texture, GsCubemapFace face, int level, int x, int y, int width, int height, const void *data) {
+    GS_ASSERT(texture != NULL);
+    GS_ASSERT(data != NULL);
+
+    GLenum format;
+    GLenum type;
+    gs_opengl_get_transfer_format(texture->format, &format, &type);
+
+    if (bound_textures[0] != texture) {
+        gs_opengl_internal_active_texture(0);
+        glBindTexture(gs_opengl_get_texture_type(texture->type), *(GLuint*)texture->handle);
+        bound_textures[0] = texture;
+    }
+
+    const GLenum target = texture->type == GS_TEXTURE_TYPE_CUBEMAP ? gs_opengl_get_face_type(face) : GL_TEXTURE_2D;
+    const int storage = gs_opengl_get_texture_storage_bit(texture, face, level);
+
+    if ((texture->storage & storage) == 0) {
+        gs_opengl_update_texture_state(texture);
+        glTexImage2D(target, level, gs_opengl_get_texture_format(texture->format), gs_opengl_get_level_size(texture->width, level), gs_opengl_get_level_size(texture->height, level), 0, format, type, NULL);
+        texture->storage |= storage;
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        const int size = width * height * gs_get_texture_format_size(texture->format);
+        const int offset = gs_opengl_reserve_upload(size);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload_ring);
+
+        #if defined(GS_OPENGL_V460)
+            memcpy(upload_ring_data + offset, data, size);
+        #elif defined(__EMSCRIPTEN__)
+            // WebGL can't map buffers
+            glBufferSubData(GL_PIXEL_UNPACK_BUFFER, offset, size, data);
+        #else
+            // the range is fenced, nothing the GPU still reads is overwritten
+            void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            memcpy(dst, data, size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        #endif
+
+        glTexSubImage2D(target, level, x, y, width, height, format, type, (const void*)(uintptr_t) offset);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        upload_ranges[(upload_range_first + upload_range_count - 1) % GS_OPENGL_UPLOAD_RING_RANGES].fence = gs_opengl_create_fence();
+    #endif
+
+    #if defined(GS_OPENGL_V200ES)
+        glTexSubImage2D(target, level, x, y, width, height, format, type, data);
+    #endif
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 }
 
 GsUniformLocation gs_opengl_get_uniform_location(GsProgram *program, const char *name) {
     GS_ASSERT(program != NULL);
     GS_ASSERT(name != NULL);
 
-    GLuint loc = glGetUniformLocation(*(GLuint*)program->handle, name);
+    GLuint loc = glGetUniformLocation(((GsOpenGLProgramHandle*)program->handle)->handle, name);
 
     return loc; // -1 is an invalid location
 }
 
+void gs_opengl_set_uniform_block_binding(GsProgram *program, const char *name, int binding) {
+    GS_ASSERT(program != NULL);
+    GS_ASSERT(name != NULL);
+
+    #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        const GLuint index = glGetUniformBlockIndex(((GsOpenGLProgramHandle*)program->handle)->handle, name);
+        GS_ASSERT_WARN(index != GL_INVALID_INDEX, "Uniform block not found in program.");
+
+        if (index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(((GsOpenGLProgramHandle*)program->handle)->handle, index, binding);
+        }
+    #endif
+
+    #if defined(GS_OPENGL_V200ES)
+        // always fail because it is not supported
+        GS_ASSERT(0);
+    #endif
+}
+
+void gs_opengl_cmd_use_uniform_block(const GsCommandHeader *header) {
+    #if defined(GS_OPENGL_V460) || defined(GS_OPENGL_V320ES)
+        const GsUniformBlockCommand *cmd = GS_COMMAND_DATA(header, GsUniformBlockCommand);
+        GsBuffer *buffer = gs_get_resource(cmd->buffer, GS_RESOURCE_TYPE_BUFFER);
+
+        // binding points are not part of the pass state stack, so the last range stays valid until it is replaced
+        GsOpenGLUniformBlock *bound = &bound_uniform_blocks[cmd->binding];
+        if (bound->buffer == buffer && bound->offset == cmd->offset && bound->size == cmd->size) {
+            return;
+        }
+
+        glBindBufferRange(GL_UNIFORM_BUFFER, cmd->binding, ((GsOpenGLBufferHandle*)buffer->handle)->handle, cmd->offset, cmd->size);
+
+        bound->buffer = buffer;
+        bound->offset = cmd->offset;
+        bound->size = cmd->size;
+    #endif
+
+    #if defined(GS_OPENGL_V200ES)
+        // always fail because it is not supported
+        GS_ASSERT(0);
+    #endif
+}
+
 void gs_opengl_generate_mipmaps(GsTexture *texture) {
     GS_ASSERT(texture != NULL);
 
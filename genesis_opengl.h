@@ -8,14 +8,54 @@ extern "C"
 {
 #endif
 
-typedef void (*GsCommandHandler)(const GsCommandListItem);
+typedef void (*GsCommandHandler)(const GsCommandHeader *header);
 typedef struct GsOpenGLBufferHandle {
     unsigned int handle;
     unsigned int vaoHandle; // used if the buffer type is a vertex buffer
     GsBuffer* lastIndexBuffer; // to remove unnecessary calls to glBindBuffer
+    GsBuffer* lastInstanceBuffer; // per-instance items of lastLayout are read from this one
+    GsBuffer* lastStreams[GS_MAX_VERTEX_STREAMS]; // buffers of the other streams of lastLayout, index 0 is unused
+    int lastBaseVertex; // vertex the attribute pointers of lastLayout start at
+    unsigned char* shadow; // contents of indirect buffers on GLES, which draws them from the CPU
     GsVtxLayout* lastLayout; // be able to tell if layout has changed
 } GsOpenGLBufferHandle;
 
+typedef struct GsOpenGLReadbackHandle {
+    unsigned int handle; // pack buffer the copy went to
+    int capacity; // of the pack buffer, which is pooled and may be larger than the readback
+    GS_BOOL mapped;
+    unsigned char *shadow; // used instead on GLES for indirect buffers, and for every texture read on GLES2
+} GsOpenGLReadbackHandle;
+
+#define GS_OPENGL_READBACK_POOL_SIZE 8 // pack buffers kept around for reuse by later readbacks
+
+// range of the upload ring an issued texture upload reads from
+typedef struct GsOpenGLUploadRange {
+    int offset;
+    int size;
+    void *fence;
+} GsOpenGLUploadRange;
+
+#define GS_OPENGL_UPLOAD_RING_SIZE 8388608 // bytes of the unpack buffer texture uploads are staged in, grows for larger uploads
+#define GS_OPENGL_UPLOAD_RING_RANGES 64 // uploads in flight before the oldest is waited on
+#define GS_OPENGL_UPLOAD_ALIGNMENT 16
+
+#define GS_OPENGL_MAX_UNIFORM_SHADOW_LOCATIONS 4096 // uniforms at higher locations are always uploaded
+
+// last value a program holds at a uniform location
+typedef struct GsOpenGLUniformShadow {
+    int offset; // into the program's values, -1 when the location is not shadowed
+    int size; // bytes per element
+    int remaining; // elements from this location to the end of its array
+} GsOpenGLUniformShadow;
+
+typedef struct GsOpenGLProgramHandle {
+    unsigned int handle;
+    GsOpenGLUniformShadow *uniforms; // indexed by location
+    int uniform_count;
+    unsigned char *values;
+} GsOpenGLProgramHandle;
+
 typedef struct GsOpenGLViewport {
     int x;
     int y;
@@ -23,6 +63,12 @@ typedef struct GsOpenGLViewport {
     int height;
 } GsOpenGLViewport;
 
+typedef struct GsOpenGLUniformBlock {
+    GsBuffer *buffer;
+    int offset;
+    int size;
+} GsOpenGLUniformBlock;
+
 typedef struct GsOpenGLColor {
     float r;
     float g;
@@ -30,9 +76,26 @@ typedef struct GsOpenGLColor {
     float a;
 } GsOpenGLColor;
 
+// pre-resolved bundle command, binds carry the id of their resource so execution skips decoding the command, the
+// resource itself is looked up when the bundle executes because it may have been destroyed and recreated since baking
+typedef struct GsOpenGLBundleOp {
+    GsCommandType type;
+    GsCommandHandler handler;
+    const GsCommandHeader *header;
+    GsResourceId resource;
+    int slot;
+} GsOpenGLBundleOp;
+
+typedef struct GsOpenGLBundle {
+    GsOpenGLBundleOp *ops;
+    int count;
+} GsOpenGLBundle;
+
 typedef struct GsOpenGLStateStack {
     GsBuffer* vertex_buffer;
     GsBuffer* index_buffer;
+    GsBuffer* instance_buffer;
+    GsBuffer* streams[GS_MAX_VERTEX_STREAMS];
     GsPipeline* pipeline;
     GsFramebuffer* framebuffer;
     GsTexture** textures;
@@ -41,6 +104,7 @@ typedef struct GsOpenGLStateStack {
 
 // state stack
 #define GS_OPENGL_MAX_STATE_STACK 16
+#define GS_OPENGL_FENCE_WAIT_STEP 1000000 // nanoseconds a waiting fence sleeps between checks
 void gs_opengl_push_state();
 void gs_opengl_pop_state();
 
@@ -59,34 +123,55 @@ void gs_opengl_destroy_program(GsProgram *program);
 
 // uniforms
 GsUniformLocation gs_opengl_get_uniform_location(GsProgram *program, const char *name);
-void gs_opengl_cmd_set_uniform_int(const GsCommandListItem item);
-void gs_opengl_cmd_set_uniform_float(const GsCommandListItem item);
-void gs_opengl_cmd_set_uniform_vec2(const GsCommandListItem item);
-void gs_opengl_cmd_set_uniform_vec3(const GsCommandListItem item);
-void gs_opengl_cmd_set_uniform_vec4(const GsCommandListItem item);
-void gs_opengl_cmd_set_uniform_mat4(const GsCommandListItem item);
+void gs_opengl_set_uniform_block_binding(GsProgram *program, const char *name, int binding);
+void gs_opengl_cmd_use_uniform_block(const GsCommandHeader *header);
+void gs_opengl_cmd_set_uniform_int(const GsCommandHeader *header);
+void gs_opengl_cmd_set_uniform_float(const GsCommandHeader *header);
+void gs_opengl_cmd_set_uniform_vec2(const GsCommandHeader *header);
+void gs_opengl_cmd_set_uniform_vec3(const GsCommandHeader *header);
+void gs_opengl_cmd_set_uniform_vec4(const GsCommandHeader *header);
+void gs_opengl_cmd_set_uniform_mat4(const GsCommandHeader *header);
+void gs_opengl_cmd_set_uniform_float_array(const GsCommandHeader *header);
+void gs_opengl_cmd_set_uniform_vec2_array(const GsCommandHeader *header);
+void gs_opengl_cmd_set_uniform_vec3_array(const GsCommandHeader *header);
+void gs_opengl_cmd_set_uniform_vec4_array(const GsCommandHeader *header);
+void gs_opengl_cmd_set_uniform_mat3_array(const GsCommandHeader *header);
+void gs_opengl_cmd_set_uniform_mat4_array(const GsCommandHeader *header);
 
 // layout
 void gs_opengl_create_layout(GsVtxLayout *layout);
 void gs_opengl_destroy_layout(GsVtxLayout *layout);
 
 // commands
-void gs_opengl_cmd_clear(const GsCommandListItem item);
-void gs_opengl_cmd_set_viewport(GsCommandListItem item);
-void gs_opengl_cmd_use_pipeline(GsCommandListItem item);
-void gs_opengl_cmd_use_buffer(const GsCommandListItem item);
-void gs_opengl_cmd_use_texture(const GsCommandListItem item);
-void gs_opengl_cmd_begin_render_pass(const GsCommandListItem item);
-void gs_opengl_cmd_end_render_pass(const GsCommandListItem item);
-void gs_opengl_cmd_draw_arrays(const GsCommandListItem item);
-void gs_opengl_cmd_draw_indexed(const GsCommandListItem item);
-void gs_opengl_cmd_set_scissor(const GsCommandListItem item);
-void gs_opengl_cmd_copy_texture(const GsCommandListItem item);
-void gs_opengl_cmd_resolve_texture(const GsCommandListItem item);
-void gs_opengl_cmd_generate_mipmaps(const GsCommandListItem item);
-void gs_opengl_cmd_copy_texture_partial(const GsCommandListItem item);
+void gs_opengl_cmd_clear(const GsCommandHeader *header);
+void gs_opengl_cmd_set_viewport(const GsCommandHeader *header);
+void gs_opengl_cmd_use_pipeline(const GsCommandHeader *header);
+void gs_opengl_cmd_use_buffer(const GsCommandHeader *header);
+void gs_opengl_cmd_use_texture(const GsCommandHeader *header);
+void gs_opengl_cmd_begin_render_pass(const GsCommandHeader *header);
+void gs_opengl_cmd_end_render_pass(const GsCommandHeader *header);
+void gs_opengl_cmd_draw_arrays(const GsCommandHeader *header);
+void gs_opengl_cmd_draw_indexed(const GsCommandHeader *header);
+void gs_opengl_cmd_use_instance_buffer(const GsCommandHeader *header);
+void gs_opengl_cmd_use_vertex_stream(const GsCommandHeader *header);
+void gs_opengl_cmd_draw_arrays_instanced(const GsCommandHeader *header);
+void gs_opengl_cmd_draw_indexed_instanced(const GsCommandHeader *header);
+void gs_opengl_cmd_draw_indirect(const GsCommandHeader *header);
+void gs_opengl_cmd_multi_draw_indirect(const GsCommandHeader *header);
+void gs_opengl_cmd_set_scissor(const GsCommandHeader *header);
+void gs_opengl_cmd_copy_texture(const GsCommandHeader *header);
+void gs_opengl_cmd_resolve_texture(const GsCommandHeader *header);
+void gs_opengl_cmd_generate_mipmaps(const GsCommandHeader *header);
+void gs_opengl_cmd_copy_texture_partial(const GsCommandHeader *header);
+void gs_opengl_cmd_execute_bundle(const GsCommandHeader *header);
+void gs_opengl_cmd_update_buffer(const GsCommandHeader *header);
+void gs_opengl_cmd_update_texture(const GsCommandHeader *header);
 void gs_opengl_submit(GsBackend *backend, GsCommandList *list);
 
+// bundles
+void gs_opengl_create_bundle(GsCommandList *bundle);
+void gs_opengl_destroy_bundle(GsCommandList *bundle);
+
 // render pass
 void gs_opengl_create_render_pass(GsRenderPass *pass);
 void gs_opengl_destroy_render_pass(GsRenderPass *pass);
@@ -111,6 +196,8 @@ void gs_opengl_internal_restore_buffer(GsBuffer* temp_buffer);
 // textures
 void gs_opengl_create_texture(GsTexture *texture);
 void gs_opengl_set_texture_data(GsTexture *texture, GsCubemapFace face, void *data);
+void gs_opengl_upload_texture(GsTexture *texture, GsCubemapFace face, int level, int x, int y, int width, int height, const void *data);
+void gs_opengl_set_texture_levels(GsTexture *texture, int base_level, int keep_level);
 void gs_opengl_generate_mipmaps(GsTexture *texture);
 void gs_opengl_clear_texture(GsTexture *texture);
 void gs_opengl_update_texture_state(GsTexture *texture);
@@ -121,6 +208,18 @@ void gs_opengl_create_buffer(GsBuffer *buffer);
 void gs_opengl_set_buffer_data(GsBuffer *buffer, void *data, int size);
 void gs_opengl_set_buffer_partial_data(GsBuffer *buffer, void *data, int size, int offset);
 void gs_opengl_destroy_buffer(GsBuffer *buffer);
+void *gs_opengl_map_stream_buffer(GsBuffer *buffer, int capacity);
+
+// fences
+void *gs_opengl_create_fence();
+GS_BOOL gs_opengl_wait_fence(void *fence, uint64_t timeout);
+void gs_opengl_destroy_fence(void *fence);
+
+// readback
+void gs_opengl_create_readback(GsReadback *readback, GsBuffer *buffer, int offset);
+void gs_opengl_create_texture_readback(GsReadback *readback, GsTexture *texture, int x, int y, int width, int height);
+void *gs_opengl_map_readback(GsReadback *readback);
+void gs_opengl_destroy_readback(GsReadback *readback);
 
 // type conversions
 int gs_opengl_get_buffer_type(GsBufferType type);
@@ -0,0 +1,323 @@
+#include "genesis.h"
+#include "genesis_quantize.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define GS_QUANTIZE_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define GS_QUANTIZE_NEON
+#endif
+
+// Values are converted 4 lanes at a time. Every lane is clamped to [min, max], multiplied by scale and rounded, which
+// covers the normalized types (min/max of -1/0 and 1, scale of the largest integer) and the plain ones (min/max of the
+// integer range, scale 1) with the same code.
+typedef struct GsQuantizeRange {
+    float min[4];
+    float max[4];
+    float scale[4];
+} GsQuantizeRange;
+
+static void gs_quantize_range_fill(GsQuantizeRange *range, const float min, const float max, const float scale) {
+    for (int i = 0; i < 4; i++) {
+        range->min[i] = min;
+        range->max[i] = max;
+        range->scale[i] = scale;
+    }
+}
+
+static void gs_quantize_range_for(GsQuantizeRange *range, const GsVtxAttribType type, const GS_BOOL normalized) {
+    switch (type) {
+        case GS_ATTRIB_TYPE_INT8:
+            if (normalized) gs_quantize_range_fill(range, -1.0f, 1.0f, 127.0f);
+            else gs_quantize_range_fill(range, -128.0f, 127.0f, 1.0f);
+            break;
+        case GS_ATTRIB_TYPE_UINT8:
+            if (normalized) gs_quantize_range_fill(range, 0.0f, 1.0f, 255.0f);
+            else gs_quantize_range_fill(range, 0.0f, 255.0f, 1.0f);
+            break;
+        case GS_ATTRIB_TYPE_INT16:
+            if (normalized) gs_quantize_range_fill(range, -1.0f, 1.0f, 32767.0f);
+            else gs_quantize_range_fill(range, -32768.0f, 32767.0f, 1.0f);
+            break;
+        case GS_ATTRIB_TYPE_UINT16:
+            if (normalized) gs_quantize_range_fill(range, 0.0f, 1.0f, 65535.0f);
+            else gs_quantize_range_fill(range, 0.0f, 65535.0f, 1.0f);
+            break;
+        case GS_ATTRIB_TYPE_INT_2_10_10_10_REV:
+            if (normalized) {
+                gs_quantize_range_fill(range, -1.0f, 1.0f, 511.0f);
+                range->scale[3] = 1.0f;
+            } else {
+                gs_quantize_range_fill(range, -512.0f, 511.0f, 1.0f);
+                range->min[3] = -2.0f;
+                range->max[3] = 1.0f;
+            }
+            break;
+        default:
+            GS_ASSERT(0);
+            break;
+    }
+}
+
+static void gs_quantize_round4(const float *src, int32_t *dst, const GsQuantizeRange *range) {
+#if defined(GS_QUANTIZE_SSE2)
+    __m128 v = _mm_loadu_ps(src);
+    v = _mm_max_ps(v, _mm_loadu_ps(range->min)); // NaN becomes min
+    v = _mm_min_ps(v, _mm_loadu_ps(range->max));
+    v = _mm_mul_ps(v, _mm_loadu_ps(range->scale));
+    _mm_storeu_si128((__m128i*) dst, _mm_cvtps_epi32(v));
+#elif defined(GS_QUANTIZE_NEON)
+    float32x4_t v = vld1q_f32(src);
+    v = vmaxnmq_f32(v, vld1q_f32(range->min));
+    v = vminq_f32(v, vld1q_f32(range->max));
+    v = vmulq_f32(v, vld1q_f32(range->scale));
+    vst1q_s32(dst, vcvtnq_s32_f32(v));
+#else
+    for (int i = 0; i < 4; i++) {
+        float v = src[i];
+        if (!(v >= range->min[i])) v = range->min[i];
+        if (v > range->max[i]) v = range->max[i];
+        v *= range->scale[i];
+        dst[i] = (int32_t) lrintf(v); // nearest even, like the vector conversions
+    }
+#endif
+}
+
+// Round to nearest even, overflow becomes infinity and NaN stays a (quiet) NaN.
+uint16_t gs_float_to_half(const float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint16_t half;
+    if (bits >= 0x47800000u) {
+        half = bits > 0x7f800000u ? 0x7e00 : 0x7c00;
+    } else if (bits < 0x38800000u) {
+        // denormal, adding 0.5 lets the fpu do the shift and rounding
+        float f;
+        const uint32_t magic = 0x3f000000u;
+        memcpy(&f, &bits, sizeof(f));
+        float m;
+        memcpy(&m, &magic, sizeof(m));
+        f += m;
+        memcpy(&bits, &f, sizeof(bits));
+        half = (uint16_t) (bits - magic);
+    } else {
+        const uint32_t odd = (bits >> 13) & 1u;
+        bits += 0xc8000fffu + odd; // rebias the exponent and round
+        half = (uint16_t) (bits >> 13);
+    }
+
+    return (uint16_t) (half | (sign >> 16));
+}
+
+static void gs_quantize_half4(const float *src, uint16_t *dst) {
+#if defined(GS_QUANTIZE_SSE2)
+    // same steps as gs_float_to_half, with the branches turned into selects
+    const __m128i abs_mask = _mm_set1_epi32(0x7fffffff);
+    const __m128i bits_in = _mm_castps_si128(_mm_loadu_ps(src));
+    const __m128i bits = _mm_and_si128(bits_in, abs_mask);
+    const __m128i sign = _mm_srai_epi32(_mm_andnot_si128(abs_mask, bits_in), 16);
+
+    const __m128i is_big = _mm_cmpgt_epi32(bits, _mm_set1_epi32(0x47800000 - 1));
+    const __m128i is_nan = _mm_cmpgt_epi32(bits, _mm_set1_epi32(0x7f800000));
+    const __m128i is_small = _mm_cmplt_epi32(bits, _mm_set1_epi32(0x38800000));
+
+    const __m128i big = _mm_or_si128(_mm_and_si128(is_nan, _mm_set1_epi32(0x7e00)), _mm_andnot_si128(is_nan, _mm_set1_epi32(0x7c00)));
+
+    const __m128i magic = _mm_set1_epi32(0x3f000000);
+    const __m128i small = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), _mm_castsi128_ps(magic))), magic);
+
+    const __m128i odd = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+    const __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(bits, _mm_set1_epi32((int) 0xc8000fffu)), odd), 13);
+
+    __m128i half = _mm_or_si128(_mm_and_si128(is_small, small), _mm_andnot_si128(is_small, normal));
+    half = _mm_or_si128(_mm_and_si128(is_big, big), _mm_andnot_si128(is_big, half));
+    half = _mm_and_si128(half, _mm_set1_epi32(0x7fff));
+
+    // the sign is shifted so every lane stays in int16 range for the signed pack
+    half = _mm_or_si128(half, sign);
+    half = _mm_packs_epi32(half, half);
+    _mm_storel_epi64((__m128i*) dst, half);
+#elif defined(GS_QUANTIZE_NEON)
+    vst1_u16(dst, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src))));
+#else
+    for (int i = 0; i < 4; i++) {
+        dst[i] = gs_float_to_half(src[i]);
+    }
+#endif
+}
+
+uint32_t gs_pack_int_2_10_10_10_rev(const float x, const float y, const float z, const float w, const GS_BOOL normalized) {
+    GsQuantizeRange range;
+    gs_quantize_range_for(&range, GS_ATTRIB_TYPE_INT_2_10_10_10_REV, normalized);
+
+    const float src[4] = { x, y, z, w };
+    int32_t v[4];
+    gs_quantize_round4(src, v, &range);
+
+    return ((uint32_t) v[0] & 0x3ffu) | (((uint32_t) v[1] & 0x3ffu) << 10) | (((uint32_t) v[2] & 0x3ffu) << 20) | (((uint32_t) v[3] & 0x3u) << 30);
+}
+
+static int gs_quantize_type_size(const GsVtxAttribType type) {
+    switch (type) {
+        case GS_ATTRIB_TYPE_INT8:
+        case GS_ATTRIB_TYPE_UINT8:
+            return 1;
+        case GS_ATTRIB_TYPE_INT16:
+        case GS_ATTRIB_TYPE_UINT16:
+        case GS_ATTRIB_TYPE_HALF_FLOAT:
+            return 2;
+        case GS_ATTRIB_TYPE_INT32:
+        case GS_ATTRIB_TYPE_UINT32:
+        case GS_ATTRIB_TYPE_FLOAT:
+            return 4;
+        case GS_ATTRIB_TYPE_DOUBLE:
+            return 8;
+        default:
+            GS_ASSERT(0);
+            return 0;
+    }
+}
+
+// Converts count consecutive values, the lanes don't care where one element ends and the next begins.
+static void gs_quantize_run(void *dst, const float *src, const int count, const GsVtxAttribType type, const GsQuantizeRange *range) {
+    for (int i = 0; i < count; i += 4) {
+        const int lanes = count - i < 4 ? count - i : 4;
+
+        float tail[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        const float *chunk = src + i;
+        if (lanes < 4) {
+            memcpy(tail, chunk, lanes * sizeof(float));
+            chunk = tail;
+        }
+
+        if (type == GS_ATTRIB_TYPE_HALF_FLOAT) {
+            uint16_t half[4];
+            gs_quantize_half4(chunk, half);
+            memcpy((uint16_t*) dst + i, half, lanes * sizeof(uint16_t));
+            continue;
+        }
+
+        int32_t v[4];
+        gs_quantize_round4(chunk, v, range);
+        for (int k = 0; k < lanes; k++) {
+            switch (type) {
+                case GS_ATTRIB_TYPE_INT8: ((int8_t*) dst)[i + k] = (int8_t) v[k]; break;
+                case GS_ATTRIB_TYPE_UINT8: ((uint8_t*) dst)[i + k] = (uint8_t) v[k]; break;
+                case GS_ATTRIB_TYPE_INT16: ((int16_t*) dst)[i + k] = (int16_t) v[k]; break;
+                case GS_ATTRIB_TYPE_UINT16: ((uint16_t*) dst)[i + k] = (uint16_t) v[k]; break;
+                default: GS_ASSERT(0); break;
+            }
+        }
+    }
+}
+
+// 32-bit integers don't fit the float lanes, they are converted one by one.
+static void gs_quantize_wide(void *dst, const float *src, const int components, const GsVtxAttribType type) {
+    for (int i = 0; i < components; i++) {
+        float v = src[i];
+        switch (type) {
+            case GS_ATTRIB_TYPE_FLOAT:
+                ((float*) dst)[i] = v;
+                break;
+            case GS_ATTRIB_TYPE_DOUBLE:
+                ((double*) dst)[i] = (double) v;
+                break;
+            case GS_ATTRIB_TYPE_INT32:
+                if (!(v >= -2147483648.0f)) v = -2147483648.0f;
+                if (v > 2147483520.0f) v = 2147483520.0f; // largest float below 2^31
+                ((int32_t*) dst)[i] = (int32_t) (v < 0.0f ? v - 0.5f : v + 0.5f);
+                break;
+            case GS_ATTRIB_TYPE_UINT32:
+                if (!(v >= 0.0f)) v = 0.0f;
+                if (v > 4294967040.0f) v = 4294967040.0f; // largest float below 2^32
+                ((uint32_t*) dst)[i] = (uint32_t) (v + 0.5f);
+                break;
+            default:
+                GS_ASSERT(0);
+                break;
+        }
+    }
+}
+
+void gs_quantize_attribute(void *dst, int dst_stride, const float *src, int src_stride, const int count, const int components, const GsVtxAttribType type, const GS_BOOL normalized) {
+    GS_ASSERT(dst != NULL);
+    GS_ASSERT(src != NULL);
+    GS_ASSERT(count >= 0);
+    GS_ASSERT(components > 0 && components <= 4);
+    GS_ASSERT(!normalized || (type == GS_ATTRIB_TYPE_INT8 || type == GS_ATTRIB_TYPE_UINT8 || type == GS_ATTRIB_TYPE_INT16 || type == GS_ATTRIB_TYPE_UINT16 || type == GS_ATTRIB_TYPE_INT_2_10_10_10_REV));
+
+    const GS_BOOL packed = type == GS_ATTRIB_TYPE_INT_2_10_10_10_REV;
+    GS_ASSERT(!packed || components >= 3);
+
+    const int element_size = packed ? 4 : gs_quantize_type_size(type) * components;
+    const int src_size = components * (int) sizeof(float);
+    if (src_stride == 0) src_stride = src_size;
+    if (dst_stride == 0) dst_stride = element_size;
+
+    const uint8_t *src_bytes = (const uint8_t*) src;
+    uint8_t *dst_bytes = (uint8_t*) dst;
+
+    if (packed) {
+        for (int i = 0; i < count; i++) {
+            const float *v = (const float*) (src_bytes + i * src_stride);
+            const uint32_t value = gs_pack_int_2_10_10_10_rev(v[0], v[1], v[2], components == 4 ? v[3] : 0.0f, normalized);
+            memcpy(dst_bytes + i * dst_stride, &value, sizeof(value));
+        }
+
+        return;
+    }
+
+    if (type == GS_ATTRIB_TYPE_FLOAT || type == GS_ATTRIB_TYPE_DOUBLE || type == GS_ATTRIB_TYPE_INT32 || type == GS_ATTRIB_TYPE_UINT32) {
+        for (int i = 0; i < count; i++) {
+            float v[4];
+            memcpy(v, src_bytes + i * src_stride, src_size);
+
+            double out[4]; // aligned for every wide type
+            gs_quantize_wide(out, v, components, type);
+            memcpy(dst_bytes + i * dst_stride, out, element_size);
+        }
+
+        return;
+    }
+
+    GsQuantizeRange range;
+    if (type != GS_ATTRIB_TYPE_HALF_FLOAT) {
+        gs_quantize_range_for(&range, type, normalized);
+    }
+
+    // tightly packed on both sides, the whole attribute is one run
+    if (src_stride == src_size && dst_stride == element_size) {
+        gs_quantize_run(dst, src, count * components, type, &range);
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        float v[4];
+        memcpy(v, src_bytes + i * src_stride, src_size);
+
+        uint16_t out[4];
+        gs_quantize_run(out, v, components, type, &range);
+        memcpy(dst_bytes + i * dst_stride, out, element_size);
+    }
+}
+
+void gs_quantize_layout_item(const GsVtxLayout *layout, const int index, void *dst, const float *src, const int src_stride, const int count) {
+    GS_ASSERT(layout != NULL);
+    GS_ASSERT(layout->completed);
+
+    const GsVtxLayoutItem *item = gs_layout_find_item(layout, index);
+    GS_ASSERT(item != NULL);
+
+    const int stride = item->stream == GS_VERTEX_STREAM_INSTANCE ? layout->instance_stride : layout->stream_strides[item->stream];
+    gs_quantize_attribute((uint8_t*) dst + item->offset, stride, src, src_stride, count, item->components, item->type, item->normalized);
+}
@@ -0,0 +1,25 @@
+#ifndef GENESIS_QUANTIZE_H
+#define GENESIS_QUANTIZE_H
+
+#include "genesis.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Vertex quantization
+// Converts float vertex data into the compact attribute types before it is uploaded. count elements of components
+// floats are read every src_stride bytes and written every dst_stride bytes as type, a stride of 0 means tightly
+// packed. Normalized types are scaled from [-1, 1] (signed) or [0, 1] (unsigned), the others keep their value. Both are
+// rounded to the nearest representable value and clamped to the range of the type. GS_ATTRIB_TYPE_INT_2_10_10_10_REV
+// takes 3 or 4 components, w is 0 when there are only 3.
+uint16_t gs_float_to_half(float value);
+uint32_t gs_pack_int_2_10_10_10_rev(float x, float y, float z, float w, GS_BOOL normalized);
+void gs_quantize_attribute(void *dst, int dst_stride, const float *src, int src_stride, int count, int components, GsVtxAttribType type, GS_BOOL normalized);
+void gs_quantize_layout_item(const GsVtxLayout *layout, int index, void *dst, const float *src, int src_stride, int count); // dst points at the first vertex of the item's stream
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GENESIS_QUANTIZE_H
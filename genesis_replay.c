@@ -0,0 +1,212 @@
+#include "genesis.h"
+#include "genesis_capture.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__) && !defined(__ANDROID__) && !defined(__EMSCRIPTEN__)
+    #define GS_REPLAY_EGL
+    #include <EGL/egl.h>
+    #include <EGL/eglext.h>
+#endif
+
+// Replays a frame captured with gs_capture_next_frame and reports its timing. The noop backend measures the library
+// alone, the opengl backend replays into an offscreen context so driver cost is included.
+// Usage: GenesisReplay <capture> [frames] [--per-command] [--backend noop|opengl]
+
+static const char *command_names[] = {
+    [GS_COMMAND_NONE]                 = "NONE",
+    [GS_COMMAND_CLEAR]                = "CLEAR",
+    [GS_COMMAND_SET_VIEWPORT]         = "SET_VIEWPORT",
+    [GS_COMMAND_USE_PIPELINE]         = "USE_PIPELINE",
+    [GS_COMMAND_USE_BUFFER]           = "USE_BUFFER",
+    [GS_COMMAND_USE_TEXTURE]          = "USE_TEXTURE",
+    [GS_COMMAND_DRAW_ARRAYS]          = "DRAW_ARRAYS",
+    [GS_COMMAND_DRAW_INDEXED]         = "DRAW_INDEXED",
+    [GS_COMMAND_SET_SCISSOR]          = "SET_SCISSOR",
+    [GS_COMMAND_SET_UNIFORM_INT]      = "SET_UNIFORM_INT",
+    [GS_COMMAND_SET_UNIFORM_FLOAT]    = "SET_UNIFORM_FLOAT",
+    [GS_COMMAND_SET_UNIFORM_VEC2]     = "SET_UNIFORM_VEC2",
+    [GS_COMMAND_SET_UNIFORM_VEC3]     = "SET_UNIFORM_VEC3",
+    [GS_COMMAND_SET_UNIFORM_VEC4]     = "SET_UNIFORM_VEC4",
+    [GS_COMMAND_SET_UNIFORM_MAT4]     = "SET_UNIFORM_MAT4",
+    [GS_COMMAND_COPY_TEXTURE]         = "COPY_TEXTURE",
+    [GS_COMMAND_COPY_TEXTURE_PARTIAL] = "COPY_TEXTURE_PARTIAL",
+    [GS_COMMAND_RESOLVE_TEXTURE]      = "RESOLVE_TEXTURE",
+    [GS_COMMAND_GEN_MIPMAPS]          = "GEN_MIPMAPS",
+    [GS_COMMAND_BEGIN_PASS]           = "BEGIN_PASS",
+    [GS_COMMAND_END_PASS]             = "END_PASS",
+    [GS_COMMAND_EXECUTE_BUNDLE]       = "EXECUTE_BUNDLE",
+    [GS_COMMAND_UPDATE_BUFFER]        = "UPDATE_BUFFER",
+    [GS_COMMAND_UPDATE_TEXTURE]       = "UPDATE_TEXTURE",
+    [GS_COMMAND_SET_UNIFORM_FLOAT_ARRAY] = "SET_UNIFORM_FLOAT_ARRAY",
+    [GS_COMMAND_SET_UNIFORM_VEC2_ARRAY]  = "SET_UNIFORM_VEC2_ARRAY",
+    [GS_COMMAND_SET_UNIFORM_VEC3_ARRAY]  = "SET_UNIFORM_VEC3_ARRAY",
+    [GS_COMMAND_SET_UNIFORM_VEC4_ARRAY]  = "SET_UNIFORM_VEC4_ARRAY",
+    [GS_COMMAND_SET_UNIFORM_MAT3_ARRAY]  = "SET_UNIFORM_MAT3_ARRAY",
+    [GS_COMMAND_SET_UNIFORM_MAT4_ARRAY]  = "SET_UNIFORM_MAT4_ARRAY",
+    [GS_COMMAND_USE_UNIFORM_BLOCK]       = "USE_UNIFORM_BLOCK",
+    [GS_COMMAND_USE_INSTANCE_BUFFER]     = "USE_INSTANCE_BUFFER",
+    [GS_COMMAND_DRAW_ARRAYS_INSTANCED]   = "DRAW_ARRAYS_INSTANCED",
+    [GS_COMMAND_DRAW_INDEXED_INSTANCED]  = "DRAW_INDEXED_INSTANCED",
+    [GS_COMMAND_DRAW_INDIRECT]           = "DRAW_INDIRECT",
+    [GS_COMMAND_MULTI_DRAW_INDIRECT]     = "MULTI_DRAW_INDIRECT",
+    [GS_COMMAND_USE_VERTEX_STREAM]       = "USE_VERTEX_STREAM",
+};
+
+#if defined(GS_REPLAY_EGL)
+static EGLDisplay replay_display = EGL_NO_DISPLAY;
+static EGLSurface replay_surface = EGL_NO_SURFACE;
+static EGLContext replay_context = EGL_NO_CONTEXT;
+#endif
+
+// Makes an offscreen context current, the replay never presents so a 1x1 pbuffer is enough. Headless machines
+// without a display server use the surfaceless platform when the driver offers it.
+static GS_BOOL gs_replay_create_context() {
+    #if defined(GS_REPLAY_EGL)
+        PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+        #if defined(EGL_PLATFORM_SURFACELESS_MESA)
+            if (get_platform_display != NULL) {
+                replay_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+            }
+        #endif
+
+        if (replay_display == EGL_NO_DISPLAY) {
+            replay_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+
+        if (replay_display == EGL_NO_DISPLAY || !eglInitialize(replay_display, NULL, NULL) || !eglBindAPI(EGL_OPENGL_API)) {
+            return GS_FALSE;
+        }
+
+        const EGLint config_attributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLConfig egl_config = NULL;
+        EGLint config_count = 0;
+        eglChooseConfig(replay_display, config_attributes, &egl_config, 1, &config_count);
+
+        // no version requested, drivers hand out the newest compatibility context they support
+        replay_context = eglCreateContext(replay_display, config_count > 0 ? egl_config : NULL, EGL_NO_CONTEXT, NULL);
+        if (replay_context == EGL_NO_CONTEXT) {
+            return GS_FALSE;
+        }
+
+        // without a pbuffer config the context is made current without a surface (EGL_KHR_surfaceless_context)
+        if (config_count > 0) {
+            const EGLint surface_attributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+            replay_surface = eglCreatePbufferSurface(replay_display, egl_config, surface_attributes);
+        }
+
+        return eglMakeCurrent(replay_display, replay_surface, replay_surface, replay_context);
+    #else
+        // always fail because it is not supported
+        return GS_FALSE;
+    #endif
+}
+
+static void gs_replay_destroy_context() {
+    #if defined(GS_REPLAY_EGL)
+        if (replay_display == EGL_NO_DISPLAY) {
+            return;
+        }
+
+        eglMakeCurrent(replay_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+        if (replay_surface != EGL_NO_SURFACE) {
+            eglDestroySurface(replay_display, replay_surface);
+        }
+
+        if (replay_context != EGL_NO_CONTEXT) {
+            eglDestroyContext(replay_display, replay_context);
+        }
+
+        eglTerminate(replay_display);
+        replay_display = EGL_NO_DISPLAY;
+    #endif
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("Usage: %s <capture> [frames] [--per-command] [--backend noop|opengl]\n", argv[0]);
+        return 1;
+    }
+
+    int frames = 100;
+    GS_BOOL per_command = GS_FALSE;
+    GsBackendType backend = GS_BACKEND_NOOP;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--per-command") == 0) {
+            per_command = GS_TRUE;
+        } else if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            i += 1;
+
+            if (strcmp(argv[i], "noop") == 0) {
+                backend = GS_BACKEND_NOOP;
+            } else if (strcmp(argv[i], "opengl") == 0) {
+                backend = GS_BACKEND_OPENGL;
+            } else {
+                printf("Unknown backend: %s\n", argv[i]);
+                return 1;
+            }
+        } else {
+            frames = atoi(argv[i]);
+        }
+    }
+
+    GsCapture *capture = gs_open_capture(argv[1]);
+    if (capture == NULL) {
+        return 1;
+    }
+
+    if (backend == GS_BACKEND_OPENGL && !gs_replay_create_context()) {
+        printf("Failed to create an OpenGL context\n");
+        gs_replay_destroy_context();
+        gs_close_capture(capture);
+        return 1;
+    }
+
+    GsConfig *config = gs_create_config();
+    config->backend = gs_create_backend(backend);
+
+    if (!gs_init(config)) {
+        printf("Failed to initialize the backend\n");
+        return 1;
+    }
+
+    GsReplay *replay = gs_create_replay(capture);
+    for (int i = 0; i < frames; i++) {
+        gs_replay_frame(replay, per_command);
+    }
+
+    const GsReplayStats *stats = gs_replay_get_stats(replay);
+    if (stats->frames > 0) {
+        printf("frames: %d\n", stats->frames);
+        printf("frame avg: %.3f us, min: %.3f us, max: %.3f us\n",
+            (double) stats->frame_total_ns / stats->frames / 1000.0,
+            (double) stats->frame_min_ns / 1000.0,
+            (double) stats->frame_max_ns / 1000.0
+        );
+    }
+
+    if (per_command) {
+        printf("%-24s %10s %14s\n", "command", "count", "avg (ns)");
+        for (int i = 0; i < GS_COMMAND_COUNT; i++) {
+            if (stats->type_count[i] == 0) {
+                continue;
+            }
+
+            const char *name = i < GS_TABLE_SIZE(command_names) && command_names[i] != NULL ? command_names[i] : "UNKNOWN";
+            printf("%-24s %10llu %14.1f\n", name, (unsigned long long) stats->type_count[i], (double) stats->type_ns[i] / (double) stats->type_count[i]);
+        }
+    }
+
+    gs_destroy_replay(replay);
+    gs_shutdown();
+    gs_destroy_backend(config->backend);
+    gs_destroy_config(config);
+    gs_close_capture(capture);
+    gs_replay_destroy_context();
+
+    return 0;
+}
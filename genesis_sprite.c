@@ -0,0 +1,308 @@
+#include "genesis.h"
+#include "genesis_sprite.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define GS_SPRITE_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define GS_SPRITE_NEON
+#endif
+
+// The ring mirrors the vertex buffer on the CPU. Sprites are expanded at the cursor, a flush uploads the range written
+// since the previous one and draws it. Index buffer contents never change, quad i always uses vertices 4i to 4i + 3.
+struct GsSpriteBatch {
+    GsBuffer *vertex_buffer;
+    GsBuffer *index_buffer;
+    GsVtxLayout *layout;
+    GsSpriteVertex *vertices;
+    int capacity; // in sprites
+    int cursor; // next sprite in the ring
+    int first; // first sprite not flushed yet
+
+    // recording
+    GsCommandList *list;
+    GsPipeline *pipeline;
+    GsTexture *texture;
+    GS_BOOL scissor_enabled;
+    int scissor[4];
+
+    GsSpriteBatchStats stats;
+};
+
+static const float gs_sprite_identity[6] = {
+    1.0f, 0.0f, 0.0f,
+    0.0f, 1.0f, 0.0f
+};
+
+GsSpriteBatch *gs_create_sprite_batch(const int capacity) {
+    GS_ASSERT(capacity > 0 && capacity <= GS_SPRITE_BATCH_MAX_SPRITES);
+
+    GsSpriteBatch *batch = GS_ALLOC(GsSpriteBatch);
+    GS_ASSERT(batch != NULL);
+    GS_MEMSET(batch, 0, sizeof(GsSpriteBatch));
+
+    const int vertex_size = capacity * 4 * (int) sizeof(GsSpriteVertex);
+    batch->vertices = (GsSpriteVertex*) GS_MALLOC(vertex_size);
+    GS_ASSERT(batch->vertices != NULL);
+    GS_MEMSET(batch->vertices, 0, vertex_size);
+    batch->capacity = capacity;
+
+    batch->layout = gs_create_layout();
+    gs_layout_add(batch->layout, 0, GS_ATTRIB_TYPE_FLOAT, 2);
+    gs_layout_add(batch->layout, 1, GS_ATTRIB_TYPE_FLOAT, 2);
+    gs_layout_add(batch->layout, 2, GS_ATTRIB_TYPE_FLOAT, 4);
+    gs_layout_build(batch->layout);
+
+    batch->vertex_buffer = gs_create_buffer(GS_BUFFER_TYPE_VERTEX, GS_BUFFER_INTENT_DRAW_STREAM);
+    gs_buffer_set_data(batch->vertex_buffer, batch->vertices, vertex_size);
+
+    const int index_count = capacity * 6;
+    uint16_t *indices = GS_ALLOC_MULTIPLE(uint16_t, index_count);
+    GS_ASSERT(indices != NULL);
+
+    for (int i = 0; i < capacity; i++) {
+        const uint16_t base = (uint16_t) (i * 4);
+        uint16_t *quad = indices + i * 6;
+        quad[0] = base;
+        quad[1] = base + 1;
+        quad[2] = base + 2;
+        quad[3] = base;
+        quad[4] = base + 2;
+        quad[5] = base + 3;
+    }
+
+    batch->index_buffer = gs_create_buffer(GS_BUFFER_TYPE_INDEX, GS_BUFFER_INTENT_DRAW_STATIC);
+    gs_buffer_set_index_type(batch->index_buffer, GS_INDEX_TYPE_UINT16);
+    gs_buffer_set_data(batch->index_buffer, indices, index_count * (int) sizeof(uint16_t));
+    GS_FREE(indices);
+
+    return batch;
+}
+
+void gs_destroy_sprite_batch(GsSpriteBatch *batch) {
+    GS_ASSERT(batch != NULL);
+    GS_ASSERT(batch->list == NULL);
+
+    gs_destroy_buffer(batch->vertex_buffer);
+    gs_destroy_buffer(batch->index_buffer);
+    gs_destroy_layout(batch->layout);
+    GS_FREE(batch->vertices);
+    GS_FREE(batch);
+}
+
+GsVtxLayout *gs_sprite_batch_get_layout(GsSpriteBatch *batch) {
+    GS_ASSERT(batch != NULL);
+
+    return batch->layout;
+}
+
+GsSpriteBatchStats gs_sprite_batch_get_stats(const GsSpriteBatch *batch) {
+    GS_ASSERT(batch != NULL);
+
+    return batch->stats;
+}
+
+void gs_sprite_batch_begin(GsSpriteBatch *batch, GsCommandList *list) {
+    GS_ASSERT(batch != NULL);
+    GS_ASSERT(list != NULL);
+    GS_ASSERT(batch->list == NULL);
+
+    batch->list = list;
+    batch->pipeline = NULL;
+    batch->texture = NULL;
+    batch->scissor_enabled = GS_FALSE;
+    batch->first = batch->cursor;
+
+    GS_MEMSET(&batch->stats, 0, sizeof(GsSpriteBatchStats));
+}
+
+// Binds are recorded with every draw, so commands recorded into the list between sprites cannot leave the batch with
+// the wrong state. The ones that turn out redundant are dropped again by gs_command_list_end.
+static void gs_sprite_batch_submit(GsSpriteBatch *batch, const GsSpriteFlushReason reason) {
+    const int count = batch->cursor - batch->first;
+    if (count == 0) {
+        return;
+    }
+
+    GS_ASSERT(batch->pipeline != NULL);
+
+    GsCommandList *list = batch->list;
+    const int vertex_size = 4 * (int) sizeof(GsSpriteVertex);
+
+    gs_update_buffer_partial(list, batch->vertex_buffer, batch->vertices + batch->first * 4, count * vertex_size, batch->first * vertex_size);
+    gs_use_pipeline(list, batch->pipeline);
+    gs_use_buffer(list, batch->vertex_buffer);
+    gs_use_buffer(list, batch->index_buffer);
+    gs_use_texture(list, batch->texture, 0);
+    gs_draw_indexed_base_vertex(list, count * 6, batch->first * 6, 0);
+
+    batch->first = batch->cursor;
+    batch->stats.draws += 1;
+    batch->stats.flushes[reason] += 1;
+    batch->stats.last_flush_reason = reason;
+}
+
+void gs_sprite_batch_set_pipeline(GsSpriteBatch *batch, GsPipeline *pipeline) {
+    GS_ASSERT(batch != NULL);
+    GS_ASSERT(batch->list != NULL);
+    GS_ASSERT(pipeline != NULL);
+    GS_ASSERT(pipeline->layout != NULL && pipeline->layout->stride == (int) sizeof(GsSpriteVertex));
+
+    if (pipeline == batch->pipeline) {
+        return;
+    }
+
+    gs_sprite_batch_submit(batch, GS_SPRITE_FLUSH_PIPELINE);
+    batch->pipeline = pipeline;
+}
+
+void gs_sprite_batch_set_scissor(GsSpriteBatch *batch, const int x, const int y, const int width, const int height) {
+    GS_ASSERT(batch != NULL);
+    GS_ASSERT(batch->list != NULL);
+
+    if (batch->scissor_enabled && batch->scissor[0] == x && batch->scissor[1] == y && batch->scissor[2] == width && batch->scissor[3] == height) {
+        return;
+    }
+
+    gs_sprite_batch_submit(batch, GS_SPRITE_FLUSH_SCISSOR);
+    gs_set_scissor(batch->list, x, y, width, height);
+
+    batch->scissor_enabled = GS_TRUE;
+    batch->scissor[0] = x;
+    batch->scissor[1] = y;
+    batch->scissor[2] = width;
+    batch->scissor[3] = height;
+}
+
+void gs_sprite_batch_disable_scissor(GsSpriteBatch *batch) {
+    GS_ASSERT(batch != NULL);
+    GS_ASSERT(batch->list != NULL);
+
+    if (!batch->scissor_enabled) {
+        return;
+    }
+
+    gs_sprite_batch_submit(batch, GS_SPRITE_FLUSH_SCISSOR);
+    gs_disable_scissor(batch->list);
+
+    batch->scissor_enabled = GS_FALSE;
+}
+
+// Writes the corners (x, y), (x + w, y), (x + w, y + h) and (x, y + h) in that order. All four corners go through the
+// transform at once, the transposed position and uv columns then form the first half of each vertex.
+static void gs_sprite_expand(GsSpriteVertex *out, const GsSprite *sprite, const float *m) {
+    const float x0 = sprite->x;
+    const float y0 = sprite->y;
+    const float x1 = sprite->x + sprite->width;
+    const float y1 = sprite->y + sprite->height;
+
+#if defined(GS_SPRITE_SSE)
+    const __m128 lx = _mm_setr_ps(x0, x1, x1, x0);
+    const __m128 ly = _mm_setr_ps(y0, y0, y1, y1);
+
+    __m128 px = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx, _mm_set1_ps(m[0])), _mm_mul_ps(ly, _mm_set1_ps(m[1]))), _mm_set1_ps(m[2]));
+    __m128 py = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx, _mm_set1_ps(m[3])), _mm_mul_ps(ly, _mm_set1_ps(m[4]))), _mm_set1_ps(m[5]));
+    __m128 u = _mm_setr_ps(sprite->u0, sprite->u1, sprite->u1, sprite->u0);
+    __m128 v = _mm_setr_ps(sprite->v0, sprite->v0, sprite->v1, sprite->v1);
+    _MM_TRANSPOSE4_PS(px, py, u, v);
+
+    const __m128 color = _mm_loadu_ps(&sprite->r);
+    float *dst = (float*) out;
+    _mm_storeu_ps(dst, px);
+    _mm_storeu_ps(dst + 4, color);
+    _mm_storeu_ps(dst + 8, py);
+    _mm_storeu_ps(dst + 12, color);
+    _mm_storeu_ps(dst + 16, u);
+    _mm_storeu_ps(dst + 20, color);
+    _mm_storeu_ps(dst + 24, v);
+    _mm_storeu_ps(dst + 28, color);
+#elif defined(GS_SPRITE_NEON)
+    const float corners_x[4] = { x0, x1, x1, x0 };
+    const float corners_y[4] = { y0, y0, y1, y1 };
+    const float corners_u[4] = { sprite->u0, sprite->u1, sprite->u1, sprite->u0 };
+    const float corners_v[4] = { sprite->v0, sprite->v0, sprite->v1, sprite->v1 };
+    const float32x4_t lx = vld1q_f32(corners_x);
+    const float32x4_t ly = vld1q_f32(corners_y);
+
+    const float32x4_t px = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(m[2]), lx, m[0]), ly, m[1]);
+    const float32x4_t py = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(m[5]), lx, m[3]), ly, m[4]);
+    const float32x4x2_t xy = vzipq_f32(px, py);
+    const float32x4x2_t uv = vzipq_f32(vld1q_f32(corners_u), vld1q_f32(corners_v));
+
+    const float32x4_t color = vld1q_f32(&sprite->r);
+    float *dst = (float*) out;
+    vst1q_f32(dst, vcombine_f32(vget_low_f32(xy.val[0]), vget_low_f32(uv.val[0])));
+    vst1q_f32(dst + 4, color);
+    vst1q_f32(dst + 8, vcombine_f32(vget_high_f32(xy.val[0]), vget_high_f32(uv.val[0])));
+    vst1q_f32(dst + 12, color);
+    vst1q_f32(dst + 16, vcombine_f32(vget_low_f32(xy.val[1]), vget_low_f32(uv.val[1])));
+    vst1q_f32(dst + 20, color);
+    vst1q_f32(dst + 24, vcombine_f32(vget_high_f32(xy.val[1]), vget_high_f32(uv.val[1])));
+    vst1q_f32(dst + 28, color);
+#else
+    const float corners_x[4] = { x0, x1, x1, x0 };
+    const float corners_y[4] = { y0, y0, y1, y1 };
+    const float corners_u[4] = { sprite->u0, sprite->u1, sprite->u1, sprite->u0 };
+    const float corners_v[4] = { sprite->v0, sprite->v0, sprite->v1, sprite->v1 };
+
+    for (int i = 0; i < 4; i++) {
+        GsSpriteVertex *vertex = &out[i];
+        vertex->x = m[0] * corners_x[i] + m[1] * corners_y[i] + m[2];
+        vertex->y = m[3] * corners_x[i] + m[4] * corners_y[i] + m[5];
+        vertex->u = corners_u[i];
+        vertex->v = corners_v[i];
+        vertex->r = sprite->r;
+        vertex->g = sprite->g;
+        vertex->b = sprite->b;
+        vertex->a = sprite->a;
+    }
+#endif
+}
+
+void gs_sprite_batch_draw(GsSpriteBatch *batch, const GsSprite *sprite, const float *transform) {
+    GS_ASSERT(batch != NULL);
+    GS_ASSERT(batch->list != NULL);
+    GS_ASSERT(sprite != NULL);
+    GS_ASSERT(sprite->texture != NULL);
+
+    if (sprite->texture != batch->texture) {
+        gs_sprite_batch_submit(batch, GS_SPRITE_FLUSH_TEXTURE);
+        batch->texture = sprite->texture;
+    }
+
+    if (batch->cursor == batch->capacity) {
+        gs_sprite_batch_submit(batch, GS_SPRITE_FLUSH_RING_FULL);
+        batch->cursor = 0;
+        batch->first = 0;
+    }
+
+    gs_sprite_expand(batch->vertices + batch->cursor * 4, sprite, transform != NULL ? transform : gs_sprite_identity);
+    batch->cursor += 1;
+    batch->stats.sprites += 1;
+}
+
+void gs_sprite_batch_flush(GsSpriteBatch *batch) {
+    GS_ASSERT(batch != NULL);
+    GS_ASSERT(batch->list != NULL);
+
+    gs_sprite_batch_submit(batch, GS_SPRITE_FLUSH_MANUAL);
+}
+
+void gs_sprite_batch_end(GsSpriteBatch *batch) {
+    GS_ASSERT(batch != NULL);
+    GS_ASSERT(batch->list != NULL);
+
+    gs_sprite_batch_submit(batch, GS_SPRITE_FLUSH_END);
+
+    if (batch->scissor_enabled) {
+        gs_disable_scissor(batch->list);
+        batch->scissor_enabled = GS_FALSE;
+    }
+
+    batch->list = NULL;
+}
@@ -0,0 +1,67 @@
+#ifndef GENESIS_SPRITE_H
+#define GENESIS_SPRITE_H
+
+#include "genesis.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GS_SPRITE_BATCH_MAX_SPRITES 16384 // 4 vertices each, so every vertex of the ring fits a uint16 index
+
+typedef struct GsSpriteBatch GsSpriteBatch;
+
+typedef enum GsSpriteFlushReason {
+    GS_SPRITE_FLUSH_TEXTURE, // a sprite used another texture
+    GS_SPRITE_FLUSH_PIPELINE, // gs_sprite_batch_set_pipeline changed the pipeline
+    GS_SPRITE_FLUSH_SCISSOR, // the scissor rect changed or was disabled
+    GS_SPRITE_FLUSH_RING_FULL, // the vertex ring ran out and wrapped to its start
+    GS_SPRITE_FLUSH_MANUAL, // gs_sprite_batch_flush
+    GS_SPRITE_FLUSH_END, // gs_sprite_batch_end
+    GS_SPRITE_FLUSH_REASON_COUNT
+} GsSpriteFlushReason;
+
+// Layout of the vertices written into the ring, see gs_sprite_batch_get_layout.
+typedef struct GsSpriteVertex {
+    float x, y; // attribute 0
+    float u, v; // attribute 1
+    float r, g, b, a; // attribute 2
+} GsSpriteVertex;
+
+typedef struct GsSprite {
+    GsTexture *texture;
+    float x, y, width, height; // destination rect, before the transform
+    float u0, v0, u1, v1; // uv of the (x, y) and (x + width, y + height) corners
+    float r, g, b, a;
+} GsSprite;
+
+// Counted from the last gs_sprite_batch_begin, every flush issues exactly one draw.
+typedef struct GsSpriteBatchStats {
+    int sprites;
+    int draws;
+    int flushes[GS_SPRITE_FLUSH_REASON_COUNT]; // draws issued per reason
+    GsSpriteFlushReason last_flush_reason;
+} GsSpriteBatchStats;
+
+// Sprite batch
+// Sprites are expanded into quads on the CPU and collected in a vertex ring, one indexed draw covers every sprite
+// since the last flush. A flush only happens when the texture, pipeline or scissor changes, when the ring is full,
+// and at gs_sprite_batch_end. The pipeline has to use gs_sprite_batch_get_layout, the texture is bound to slot 0.
+// Between begin and end the batch records into the list, so a batch is used by one thread at a time.
+GsSpriteBatch *gs_create_sprite_batch(int capacity); // capacity in sprites, up to GS_SPRITE_BATCH_MAX_SPRITES
+void gs_destroy_sprite_batch(GsSpriteBatch *batch);
+GsVtxLayout *gs_sprite_batch_get_layout(GsSpriteBatch *batch);
+void gs_sprite_batch_begin(GsSpriteBatch *batch, GsCommandList *list);
+void gs_sprite_batch_set_pipeline(GsSpriteBatch *batch, GsPipeline *pipeline);
+void gs_sprite_batch_set_scissor(GsSpriteBatch *batch, int x, int y, int width, int height);
+void gs_sprite_batch_disable_scissor(GsSpriteBatch *batch);
+void gs_sprite_batch_draw(GsSpriteBatch *batch, const GsSprite *sprite, const float *transform); // 2x3 row-major affine transform, NULL for none
+void gs_sprite_batch_flush(GsSpriteBatch *batch);
+void gs_sprite_batch_end(GsSpriteBatch *batch); // also disables a scissor the batch enabled
+GsSpriteBatchStats gs_sprite_batch_get_stats(const GsSpriteBatch *batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GENESIS_SPRITE_H